@@ -0,0 +1,153 @@
+#include "BlowdownMemo.hpp"
+#include <algorithm>
+
+#include "Tensor.h"
+#include "Theory_enhanced.h"
+
+// ===== Summaries =====
+BlowdownMemo& BlowdownMemo::shared() {
+    static BlowdownMemo memo;
+    return memo;
+}
+
+const BlowdownSummary& BlowdownMemo::get(int param, int port) {
+    const uint64_t key = ((uint64_t)(uint32_t)param << 32) | (uint32_t)port;
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = table_.find(key);
+    if (it != table_.end()) return it->second;
+
+    const Eigen::MatrixXi C = build_tensor(Spec{Kind::SideLink, param}).GetIntersectionForm();
+    return table_.emplace(key, compute(C, port)).first->second;
+}
+
+BlowdownSummary BlowdownMemo::compute(const Eigen::MatrixXi& C, int port) {
+    BlowdownSummary S;
+    S.component = C;
+    const int k = (int)C.rows();
+    if (k == 0 || port < 0 || port >= k) return S;
+
+    // Proxy first, like the blocks that precede decorations in the glued form
+    const int n = k + 1;
+    Eigen::MatrixXi M = Eigen::MatrixXi::Zero(n, n);
+    M(0, 0) = kProxySelf;
+    M.block(1, 1, k, k) = C;
+    M(0, 1 + port) = M(1 + port, 0) = 1;
+
+    std::vector<int> b0(n);
+    for (int i = 0; i < n; ++i) b0[i] = M(i, i) + 2;
+
+    Tensor t;
+    t.SetIF(M);
+    t.Setb0Q(b0);
+
+    // Same scan as Tensor::ForcedBlowdown, keeping track of which curves survive
+    std::vector<int> ids(n);
+    for (int i = 0; i < n; ++i) ids[i] = i - 1;   // -1 = proxy
+    for (int i = 0; i < t.GetT(); ++i) {
+        const Eigen::MatrixXi cur = t.GetIntersectionForm();
+        const std::vector<int> cb0 = t.Getb0Q();
+        if (cur(i, i) == -1 && cb0[i] == 1 && t.Blowdown5(i + 1)) {
+            ids.erase(ids.begin() + i);
+            i = -1;
+            if (t.GetT() == 1) break;
+        }
+    }
+
+    if (ids.empty() || ids[0] != -1) return S;   // proxy must survive
+
+    const Eigen::MatrixXi F = t.GetIntersectionForm();
+    const std::vector<int> fb0 = t.Getb0Q();
+    const int r = (int)ids.size() - 1;
+    S.residual.assign(ids.begin() + 1, ids.end());
+    S.residual_if = F.block(1, 1, r, r);
+    for (int a = 0; a < r; ++a) {
+        S.residual_nb.push_back(F(0, 1 + a));
+        S.residual_b0.push_back(fb0[1 + a]);
+    }
+    S.nb_self_shift = F(0, 0) - kProxySelf;
+    S.nb_b0_delta = fb0[0] - (kProxySelf + 2);
+    S.valid = true;
+    return S;
+}
+
+// ===== Application to a glued form =====
+struct AppliedSpan {
+    const DecorationSpan* span;
+    const BlowdownSummary* summary;
+    int nb;
+};
+
+bool reduceDecorations(const Eigen::MatrixXi& IF, const std::vector<DecorationSpan>& spans,
+                       Eigen::MatrixXi& out, std::vector<int>& b0) {
+    const int N = (int)IF.rows();
+    if (spans.empty() || N == 0) return false;
+
+    std::vector<char> in_span(N, 0);
+    for (const auto& sp : spans)
+        for (int c = sp.offset; c < sp.offset + sp.size && c < N; ++c) in_span[c] = 1;
+
+    // 1) Decorations that touch the rest of the form through exactly one unit edge
+    std::vector<AppliedSpan> cand;
+    for (const auto& sp : spans) {
+        if (sp.offset < 0 || sp.offset + sp.size > N) continue;
+        int port = -1, nb = -1, edges = 0;
+        for (int c = sp.offset; c < sp.offset + sp.size; ++c)
+            for (int j = 0; j < N; ++j) {
+                if (j >= sp.offset && j < sp.offset + sp.size) continue;
+                if (IF(c, j) == 0) continue;
+                ++edges;
+                if (IF(c, j) == 1) { port = c - sp.offset; nb = j; }
+            }
+        if (edges != 1 || port < 0 || in_span[nb]) continue;
+
+        const BlowdownSummary& S = BlowdownMemo::shared().get(sp.param, port);
+        if (!S.valid || S.component.rows() != sp.size) continue;
+        if (S.component != IF.block(sp.offset, sp.offset, sp.size, sp.size)) continue;
+        cand.push_back({&sp, &S, nb});
+    }
+
+    // 2) The neighbour must stay well away from becoming blowdown-relevant itself
+    std::vector<int> shift(N, 0);
+    for (const auto& a : cand) shift[a.nb] += a.summary->nb_self_shift;
+    cand.erase(std::remove_if(cand.begin(), cand.end(),
+                              [&](const AppliedSpan& a){ return IF(a.nb, a.nb) + shift[a.nb] > -2; }),
+               cand.end());
+    if (cand.empty()) return false;
+
+    // 3) Surviving curves keep their relative order
+    std::vector<char> keep(N, 1);
+    for (const auto& a : cand) {
+        for (int c = 0; c < a.span->size; ++c) keep[a.span->offset + c] = 0;
+        for (int c : a.summary->residual) keep[a.span->offset + c] = 1;
+    }
+    std::vector<int> map(N, -1);
+    int M = 0;
+    for (int i = 0; i < N; ++i)
+        if (keep[i]) map[i] = M++;
+
+    out = Eigen::MatrixXi::Zero(M, M);
+    b0.assign(M, 0);
+    for (int i = 0; i < N; ++i) {
+        if (map[i] < 0) continue;
+        b0[map[i]] = IF(i, i) + 2;
+        for (int j = 0; j < N; ++j)
+            if (map[j] >= 0) out(map[i], map[j]) = IF(i, j);
+    }
+
+    for (const auto& a : cand) {
+        const auto& S = *a.summary;
+        const int nb = map[a.nb];
+        out(nb, nb) += S.nb_self_shift;
+        b0[nb] += S.nb_b0_delta;
+
+        const int r = (int)S.residual.size();
+        for (int x = 0; x < r; ++x) {
+            const int gx = map[a.span->offset + S.residual[x]];
+            for (int y = 0; y < r; ++y)
+                out(gx, map[a.span->offset + S.residual[y]]) = S.residual_if(x, y);
+            out(gx, nb) = out(nb, gx) = S.residual_nb[x];
+            b0[gx] = S.residual_b0[x];
+        }
+    }
+    return true;
+}
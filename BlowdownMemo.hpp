@@ -0,0 +1,62 @@
+#pragma once
+#include <Eigen/Dense>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Memoized blowdown of decoration components (side links / instantons).
+//
+// A decoration glued to the rest of the graph through one curve only ever changes
+// itself and its attachment neighbour while ForcedBlowdown collapses its -1 curves.
+// The outcome therefore depends only on (param, attached curve) and is computed once,
+// against a proxy neighbour of self-intersection kProxySelf:
+//   - the residual curves with their intersection form and b0_comp,
+//   - the residual curves' intersections with the neighbour,
+//   - the neighbour's self-intersection shift and b0_comp delta.
+// reduceDecorations applies these summaries to a glued form; ForcedBlowdown then only
+// has to run on what is left.
+
+struct BlowdownSummary {
+    bool valid = false;
+    Eigen::MatrixXi component;         // build_tensor IF the summary was computed for
+    std::vector<int> residual;         // surviving component curves (local indices, increasing)
+    Eigen::MatrixXi residual_if;       // intersection form among the residual curves
+    std::vector<int> residual_nb;      // intersection of every residual curve with the neighbour
+    std::vector<int> residual_b0;      // b0_comp of the residual curves
+    int nb_self_shift = 0;
+    int nb_b0_delta = 0;
+};
+
+class BlowdownMemo {
+public:
+    static constexpr int kProxySelf = -100;
+
+    static BlowdownMemo& shared();
+
+    // Summary for build_tensor(Spec{SideLink, param}) attached through curve `port`
+    const BlowdownSummary& get(int param, int port);
+
+    // ForcedBlowdown of component C glued to a proxy neighbour at curve `port`
+    static BlowdownSummary compute(const Eigen::MatrixXi& C, int port);
+
+private:
+    std::mutex mtx_;
+    std::unordered_map<uint64_t, BlowdownSummary> table_;
+};
+
+// Curves [offset, offset+size) of the glued form belonging to decoration `param`
+struct DecorationSpan {
+    int offset;
+    int size;
+    int param;
+};
+
+// Collapse every applicable decoration of IF with its summary. A decoration is used
+// only if it touches the rest of the form through a single curve with intersection 1
+// (so nothing external is attached to it), its neighbour is not itself a decoration
+// curve, and the neighbour stays at self-intersection <= -2 after all shifts.
+// Returns false (out/b0 untouched) if no decoration was reduced; otherwise out is the
+// reduced form in the original curve order and b0 its b0_comp.
+bool reduceDecorations(const Eigen::MatrixXi& IF, const std::vector<DecorationSpan>& spans,
+                       Eigen::MatrixXi& out, std::vector<int>& b0);
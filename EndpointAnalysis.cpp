@@ -0,0 +1,311 @@
+#include "EndpointAnalysis.hpp"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "Tensor.h"
+#include "TopoLineCompact_enhanced.hpp"
+#include "BlowdownMemo.hpp"
+
+// ===== Build TheoryGraph from Topology =====
+static inline void ensure_linear_chain(const Topology_enhanced& T,
+                                       std::vector<InteriorStructure>& out_chain){
+    if (!T.l_connection.empty()) { out_chain = T.l_connection; return; }
+    const int n = (int)T.block.size();
+    if (n <= 1) return;
+    out_chain.reserve(n-1);
+    for (int i=1; i<n; ++i) out_chain.push_back({i-1, i});
+}
+
+GraphBuildResult build_graph_from_topology(const Topology_enhanced& T){
+    GraphBuildResult R;
+
+    // 1) Main block nodes
+    std::vector<int> nodeIdx_block(T.block.size(), -1);
+    for (size_t i=0; i<T.block.size(); ++i){
+        const auto& b = T.block[i];
+        Spec sp;
+        switch (b.kind){
+            case LKind::g: sp = Spec{Kind::Node,         b.param}; break;
+            case LKind::L: sp = Spec{Kind::InteriorLink, b.param}; break;
+            case LKind::S: sp = Spec{Kind::SideLink,     b.param}; break;
+            case LKind::I: sp = Spec{Kind::SideLink,     b.param}; break;
+            case LKind::E: sp = Spec{Kind::External,     b.param}; break;
+        }
+        nodeIdx_block[i] = R.G.add(sp).id;
+    }
+
+    // 2) Decoration nodes (SideLinks)
+    std::vector<int> nodeIdx_S(T.side_links.size(), -1);
+    for (size_t i=0; i<T.side_links.size(); ++i)
+        nodeIdx_S[i] = R.G.add(Spec{Kind::SideLink, T.side_links[i].param}).id;
+
+    // 3) Decoration nodes (Instantons)
+    std::vector<int> nodeIdx_I(T.instantons.size(), -1);
+    for (size_t i=0; i<T.instantons.size(); ++i)
+        nodeIdx_I[i] = R.G.add(Spec{Kind::SideLink, T.instantons[i].param}).id;
+
+    // 4) External curve nodes
+    std::vector<int> nodeIdx_E(T.externals.size(), -1);
+    for (size_t i=0; i<T.externals.size(); ++i)
+        nodeIdx_E[i] = R.G.add(Spec{Kind::External, T.externals[i].param}).id;
+
+    // 5) Interior connections
+    std::vector<InteriorStructure> chain;
+    ensure_linear_chain(T, chain);
+    for (auto e : chain)
+        R.G.connect(NodeRef{nodeIdx_block.at(e.u)}, NodeRef{nodeIdx_block.at(e.v)});
+
+    // 6) SideLink connections
+    for (auto e : T.s_connection)
+        R.G.connect(NodeRef{nodeIdx_S.at(e.v)}, NodeRef{nodeIdx_block.at(e.u)});
+
+    // 7) Instanton connections
+    for (auto e : T.i_connection)
+        R.G.connect(NodeRef{nodeIdx_I.at(e.v)}, NodeRef{nodeIdx_block.at(e.u)});
+
+    // 8) External connections with AttachmentPoint support
+    for (const auto& conn : T.e_connection) {
+        if (conn.external_id < 0 || conn.external_id >= (int)nodeIdx_E.size()) continue;
+
+        int parent_node_id = -1;
+        switch (conn.parent_type) {
+            case 0:  // Block
+                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_block.size())
+                    parent_node_id = nodeIdx_block[conn.parent_id];
+                break;
+            case 1:  // SideLink
+                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_S.size())
+                    parent_node_id = nodeIdx_S[conn.parent_id];
+                break;
+            case 2:  // Instanton
+                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_I.size())
+                    parent_node_id = nodeIdx_I[conn.parent_id];
+                break;
+            default:
+                break;
+        }
+
+        if (parent_node_id >= 0) {
+            // External.Left -> Parent.port_idx with AttachmentPoint
+            AttachmentPoint ap(conn.port_idx);
+            try {
+                R.G.connect(NodeRef{nodeIdx_E[conn.external_id]}, AttachmentPoint(-1),
+                            NodeRef{parent_node_id}, ap);
+            } catch (const std::exception&) {
+            }
+        }
+    }
+
+    return R;
+}
+
+// ===== EndpointReport =====
+bool EndpointReport::isPTypeOnly() const {
+    if (!ok || endpoint_self.empty()) return false;
+    return std::all_of(endpoint_self.begin(), endpoint_self.end(), [](int v){ return v == 0; });
+}
+
+std::vector<int> EndpointReport::histogramKey() const {
+    std::vector<int> key = endpoint_self;
+    std::sort(key.begin(), key.end());
+    return key;
+}
+
+EndpointReport EndpointReport::fromReduced(const Eigen::MatrixXi& reduced) {
+    EndpointReport rep;
+    rep.reduced = reduced;
+    const int n = (int)reduced.rows();
+    if (n == 0 || reduced.cols() != n) return rep;
+    rep.ok = true;
+
+    if (n == 1) {
+        rep.endpoints.push_back(0);
+        rep.endpoint_self.push_back(reduced(0, 0));
+        return rep;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        int degree = 0;
+        for (int j = 0; j < n; ++j)
+            if (i != j && reduced(i, j) != 0) ++degree;
+        if (degree == 1) {
+            rep.endpoints.push_back(i);
+            rep.endpoint_self.push_back(reduced(i, i));
+        }
+    }
+    return rep;
+}
+
+// Curve ranges of the side-link and instanton nodes; nodes are added block, S, I, E
+static std::vector<DecorationSpan> decoration_spans(const Topology_enhanced& T, const TheoryGraph& G) {
+    std::vector<DecorationSpan> spans;
+    const int nB = (int)T.block.size();
+    const int nS = (int)T.side_links.size();
+    const int nI = (int)T.instantons.size();
+    int off = 0;
+    for (int id = 0; id < nB + nS + nI; ++id) {
+        const int sz = (int)G.IF(id).rows();
+        if (id >= nB + nS)  spans.push_back({off, sz, T.instantons[id - nB - nS].param});
+        else if (id >= nB)  spans.push_back({off, sz, T.side_links[id - nB].param});
+        off += sz;
+    }
+    return spans;
+}
+
+EndpointReport analyzeEndpoints(const Topology_enhanced& T, bool use_memo) {
+    try {
+        auto R = build_graph_from_topology(T);
+        Eigen::MatrixXi IF = R.G.ComposeIF_Gluing();
+        if (IF.rows() == 0 || IF.rows() != IF.cols()) return EndpointReport{};
+
+        // b0_comp starts at self-intersection + 2 (what Setb0Q() computes; its global
+        // entry needs an eigen solve and is never read by ForcedBlowdown)
+        Eigen::MatrixXi work;
+        std::vector<int> b0;
+        if (!use_memo || !reduceDecorations(IF, decoration_spans(T, R.G), work, b0)) {
+            work = IF;
+            b0.resize(IF.rows());
+            for (int i = 0; i < (int)IF.rows(); ++i) b0[i] = IF(i, i) + 2;
+        }
+
+        Tensor tensor;
+        tensor.SetIF(work);
+        tensor.Setb0Q(b0);
+        if (tensor.GetT() <= 0) return EndpointReport{};
+
+        tensor.ForcedBlowdown();
+        return EndpointReport::fromReduced(tensor.GetIntersectionForm());
+    } catch (const std::exception& e) {
+        EndpointReport rep;
+        rep.error = e.what();
+        return rep;
+    } catch (...) {
+        EndpointReport rep;
+        rep.error = "unknown exception";
+        return rep;
+    }
+}
+
+// ===== EndpointCache =====
+bool EndpointCache::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::vector<std::pair<std::string, Eigen::MatrixXi>> loaded;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t t1 = line.find('\t');
+        if (t1 == std::string::npos) continue;
+        const size_t t2 = line.find('\t', t1 + 1);
+        const char* p   = line.data() + t1 + 1;
+        const char* end = line.data() + (t2 == std::string::npos ? line.size() : t2);
+
+        int n = 0;
+        if (std::from_chars(p, end, n).ec != std::errc()) continue;
+        if (n < 0) { loaded.emplace_back(line.substr(0, t1), Eigen::MatrixXi()); continue; }
+        if (t2 == std::string::npos) continue;
+
+        Eigen::MatrixXi M(n, n);
+        p = line.data() + t2 + 1;
+        end = line.data() + line.size();
+        bool good = true;
+        for (int i = 0; i < n && good; ++i) {
+            for (int j = i; j < n; ++j) {
+                while (p < end && *p == ' ') ++p;
+                int v;
+                auto r = std::from_chars(p, end, v);
+                if (r.ec != std::errc()) { good = false; break; }
+                p = r.ptr;
+                M(i, j) = M(j, i) = v;
+            }
+        }
+        if (good) loaded.emplace_back(line.substr(0, t1), std::move(M));
+    }
+
+    // Keys come from the lines; an unparsable line is dropped
+    Topology_enhanced T;
+    std::vector<TopologyKey> keys(loaded.size());
+    std::vector<char> parsed(loaded.size(), 0);
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        parsed[i] = (bool)TopoLineCompact_enhanced::parse(loaded[i].first, T);
+        if (parsed[i]) keys[i] = TopologyKey::of(T);
+    }
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        if (parsed[i]) map_.emplace(keys[i], Entry{std::move(loaded[i].first), std::move(loaded[i].second)});
+    }
+    return true;
+}
+
+bool EndpointCache::save(const std::string& path) const {
+    std::string buf;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        char tmp[16];
+        for (const auto& [key, entry] : map_) {
+            const Eigen::MatrixXi& M = entry.reduced;
+            buf += entry.line;
+            buf.push_back('\t');
+            const int n = (int)M.rows();
+            if (n == 0) { buf += "-1\n"; continue; }
+            buf += std::to_string(n);
+            buf.push_back('\t');
+            for (int i = 0; i < n; ++i)
+                for (int j = i; j < n; ++j) {
+                    if (i || j) buf.push_back(' ');
+                    auto r = std::to_chars(tmp, tmp + sizeof(tmp), M(i, j));
+                    buf.append(tmp, r.ptr);
+                }
+            buf.push_back('\n');
+        }
+    }
+
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(buf.data(), (std::streamsize)buf.size());
+        if (!out.good()) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    return !ec;
+}
+
+bool EndpointCache::lookup(const TopologyKey& key, EndpointReport& out) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = map_.find(key);
+    if (it == map_.end()) return false;
+    out = EndpointReport::fromReduced(it->second.reduced);
+    ++hits_;
+    return true;
+}
+
+void EndpointCache::insert(const Topology_enhanced& T, const EndpointReport& rep) {
+    const TopologyKey key = TopologyKey::of(T);
+    Entry entry{TopoLineCompact_enhanced::serialize(T), rep.ok ? rep.reduced : Eigen::MatrixXi()};
+    std::lock_guard<std::mutex> lk(mtx_);
+    map_[key] = std::move(entry);
+}
+
+EndpointReport EndpointCache::get(const Topology_enhanced& T, bool use_memo) {
+    EndpointReport rep;
+    if (lookup(TopologyKey::of(T), rep)) return rep;
+
+    rep = analyzeEndpoints(T, use_memo);
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++misses_;
+    }
+    insert(T, rep);
+    return rep;
+}
+
+size_t EndpointCache::size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return map_.size();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <Eigen/Dense>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Topology_enhanced.h"
+#include "Theory_enhanced.h"
+#include "TopologyKey.hpp"
+
+// ===== Build TheoryGraph from Topology =====
+struct GraphBuildResult {
+    TheoryGraph G;
+};
+
+GraphBuildResult build_graph_from_topology(const Topology_enhanced& T);
+
+// ===== Endpoint analysis =====
+// One pass of graph build -> ComposeIF_Gluing -> ForcedBlowdown per topology.
+// Endpoints of the reduced form are the curves of degree 1; a single remaining curve
+// counts as the (only) endpoint.
+struct EndpointReport {
+    bool ok = false;                  // blowdown completed and left a non-empty square form
+    Eigen::MatrixXi reduced;          // intersection form after full blowdown
+    std::vector<int> endpoints;       // curve indices in `reduced`
+    std::vector<int> endpoint_self;   // self-intersection of every endpoint
+    std::string error;                // exception text when analysis threw
+
+    // P-type endpoint = self-intersection 0 after full blowdown
+    bool isPTypeOnly() const;
+
+    // Sorted endpoint self-intersections (the histogram key); empty if !ok
+    std::vector<int> histogramKey() const;
+
+    // Fill endpoints/endpoint_self from an already reduced form
+    static EndpointReport fromReduced(const Eigen::MatrixXi& reduced);
+};
+
+// use_memo: collapse side links / instantons with memoized summaries (BlowdownMemo.hpp)
+// before the generic blowdown; false runs ForcedBlowdown on the whole glued form.
+EndpointReport analyzeEndpoints(const Topology_enhanced& T, bool use_memo = true);
+
+// Reports keyed by TopologyKey (the topology without its name); each entry keeps its
+// line-compact line for the file. File format: one entry per line,
+// "<line>\t<n>\t<upper triangle, space separated>"; n = -1 records a topology whose
+// analysis failed. Thread-safe.
+class EndpointCache {
+public:
+    bool load(const std::string& path);        // false if the file cannot be opened
+    bool save(const std::string& path) const;  // atomic (temp file + rename)
+
+    bool lookup(const TopologyKey& key, EndpointReport& out) const;
+    void insert(const Topology_enhanced& T, const EndpointReport& rep);
+
+    // lookup, or analyze and insert
+    EndpointReport get(const Topology_enhanced& T, bool use_memo = true);
+
+    size_t size() const;
+    size_t hits() const   { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    mutable std::mutex mtx_;
+    struct Entry {
+        std::string line;
+        Eigen::MatrixXi reduced;   // empty = failed
+    };
+    std::unordered_map<TopologyKey, Entry> map_;
+    mutable size_t hits_ = 0;
+    size_t misses_ = 0;
+};
@@ -0,0 +1,329 @@
+#include "IFBinary.hpp"
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===== Little-endian helpers =====
+static inline void put_u16(std::string& b, uint16_t v) {
+    b.push_back(static_cast<char>(v & 0xff));
+    b.push_back(static_cast<char>(v >> 8));
+}
+
+static inline void put_u32(std::string& b, uint32_t v) {
+    for (int k = 0; k < 4; ++k) b.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+static inline void put_u64(std::string& b, uint64_t v) {
+    for (int k = 0; k < 8; ++k) b.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+static inline uint16_t get_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int k = 3; k >= 0; --k) v = (v << 8) | p[k];
+    return v;
+}
+
+static inline uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int k = 7; k >= 0; --k) v = (v << 8) | p[k];
+    return v;
+}
+
+struct IFBHeader {
+    uint64_t count = 0;
+    uint64_t index_offset = 0;
+    uint64_t records_end = 0;
+};
+
+static bool parse_header(const uint8_t* p, size_t n, IFBHeader& h) {
+    if (n < IFBinary::kHeaderSize) return false;
+    if (std::memcmp(p, IFBinary::kMagic, 4) != 0) return false;
+    if (get_u32(p + 4) != IFBinary::kVersion) return false;
+    h.count = get_u64(p + 8);
+    h.index_offset = get_u64(p + 16);
+    h.records_end = get_u64(p + 24);
+    return true;
+}
+
+// Walk records from kHeaderSize up to limit; stops at the first truncated record
+static uint64_t scan_records(const uint8_t* base, uint64_t limit, std::vector<uint64_t>& offsets) {
+    offsets.clear();
+    uint64_t off = IFBinary::kHeaderSize;
+    while (off < limit) {
+        const size_t n = IFBinary::recordSize(base + off, base + limit);
+        if (n == 0) break;
+        offsets.push_back(off);
+        off += n;
+    }
+    return off;
+}
+
+// ===== Encoding =====
+size_t IFBinary::appendRecord(std::string& buf, const Eigen::MatrixXi& M) {
+    const int n = static_cast<int>(M.rows());
+    if (M.cols() != n) throw std::invalid_argument("IFBinary: matrix is not square");
+    if (n > 0xffff) throw std::invalid_argument("IFBinary: matrix too large");
+
+    const size_t start = buf.size();
+    put_u16(buf, static_cast<uint16_t>(n));
+    for (int i = 0; i < n; ++i) {
+        for (int j = i; j < n; ++j) {
+            const int v = M(i, j);
+            if (M(j, i) != v) throw std::invalid_argument("IFBinary: matrix is not symmetric");
+            if (v >= -127 && v <= 127) {
+                buf.push_back(static_cast<char>(static_cast<int8_t>(v)));
+            } else if (v >= -32768 && v <= 32767) {
+                buf.push_back(static_cast<char>(kEscape));
+                put_u16(buf, static_cast<uint16_t>(static_cast<int16_t>(v)));
+            } else {
+                throw std::invalid_argument("IFBinary: entry out of int16 range");
+            }
+        }
+    }
+    return buf.size() - start;
+}
+
+size_t IFBinary::recordSize(const uint8_t* p, const uint8_t* end) {
+    if (end - p < 2) return 0;
+    const size_t n = get_u16(p);
+    const uint8_t* q = p + 2;
+    const size_t m = n * (n + 1) / 2;
+    if (m > static_cast<size_t>(end - q)) return 0;   // every entry takes at least a byte
+    for (size_t k = 0; k < m; ++k) {
+        if (q >= end) return 0;
+        if (*q == kEscape) {
+            if (end - q < 3) return 0;
+            q += 3;
+        } else {
+            ++q;
+        }
+    }
+    return static_cast<size_t>(q - p);
+}
+
+size_t IFBinary::decodeRecord(const uint8_t* p, const uint8_t* end, Eigen::MatrixXi& out) {
+    if (end - p < 2) return 0;
+    const int n = get_u16(p);
+    const uint8_t* q = p + 2;
+    // Checked before resizing, so a corrupt n cannot ask for a huge matrix
+    if (static_cast<size_t>(n) * (n + 1) / 2 > static_cast<size_t>(end - q)) return 0;
+    out.resize(n, n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = i; j < n; ++j) {
+            if (q >= end) return 0;
+            int v;
+            if (*q == kEscape) {
+                if (end - q < 3) return 0;
+                v = static_cast<int16_t>(get_u16(q + 1));
+                q += 3;
+            } else {
+                v = static_cast<int8_t>(*q);
+                ++q;
+            }
+            out(i, j) = v;
+            out(j, i) = v;
+        }
+    }
+    return static_cast<size_t>(q - p);
+}
+
+void IFBinary::appendMatrixText(std::string& buf, const Eigen::MatrixXi& M) {
+    const int R = M.rows(), C = M.cols();
+    char tmp[16];
+    for (int i = 0; i < R; ++i) {
+        for (int j = 0; j < C; ++j) {
+            if (j) buf.push_back(' ');
+            auto res = std::to_chars(tmp, tmp + sizeof(tmp), M(i, j));
+            buf.append(tmp, res.ptr);
+        }
+        buf.push_back('\n');
+    }
+    buf.push_back('\n');
+}
+
+// ===== Writer =====
+IFBinaryWriter::~IFBinaryWriter() {
+    close();
+}
+
+bool IFBinaryWriter::writeHeader(uint64_t index_offset, uint64_t records_end) {
+    std::string h;
+    h.append(IFBinary::kMagic, 4);
+    put_u32(h, IFBinary::kVersion);
+    put_u64(h, offsets_.size());
+    put_u64(h, index_offset);
+    put_u64(h, records_end);
+    if (std::fseek(fp_, 0, SEEK_SET) != 0) return false;
+    return std::fwrite(h.data(), 1, h.size(), fp_) == h.size();
+}
+
+bool IFBinaryWriter::open(const std::string& path) {
+    close();
+    path_ = path;
+    offsets_.clear();
+
+    const auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+
+    std::error_code ec;
+    const bool exists = std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > 0;
+
+    if (!exists) {
+        fp_ = std::fopen(path.c_str(), "w+b");
+        if (!fp_) return false;
+        end_ = IFBinary::kHeaderSize;
+        return writeHeader(0, 0);
+    }
+
+    // Existing file: recover the record list, then drop the old index
+    IFBinaryReader rd;
+    if (!rd.open(path)) return false;
+    for (size_t i = 0; i < rd.size(); ++i) offsets_.push_back(rd.recordOffset(i));
+    end_ = offsets_.empty() ? IFBinary::kHeaderSize
+                            : offsets_.back() + rd.recordBytes(rd.size() - 1);
+    rd.close();
+
+    fp_ = std::fopen(path.c_str(), "r+b");
+    if (!fp_) return false;
+    // Mark unfinalized before touching the tail so a crash leaves a scannable file
+    if (!writeHeader(0, 0)) return false;
+    std::fflush(fp_);
+    std::filesystem::resize_file(path, end_, ec);
+    return !ec;
+}
+
+bool IFBinaryWriter::appendEncoded(const std::string& bytes, const std::vector<uint32_t>& lengths) {
+    if (!fp_) return false;
+    if (bytes.empty()) return true;
+    if (std::fseek(fp_, static_cast<long>(end_), SEEK_SET) != 0) return false;
+    if (std::fwrite(bytes.data(), 1, bytes.size(), fp_) != bytes.size()) return false;
+    uint64_t off = end_;
+    for (uint32_t len : lengths) {
+        offsets_.push_back(off);
+        off += len;
+    }
+    end_ += bytes.size();
+    return off == end_;
+}
+
+bool IFBinaryWriter::append(const Eigen::MatrixXi& M) {
+    std::string rec;
+    const uint32_t len = static_cast<uint32_t>(IFBinary::appendRecord(rec, M));
+    return appendEncoded(rec, {len});
+}
+
+bool IFBinaryWriter::close() {
+    if (!fp_) return true;
+    std::string idx;
+    idx.reserve(offsets_.size() * 8);
+    for (uint64_t o : offsets_) put_u64(idx, o);
+
+    // records_end first: a crash while the index is written leaves it unread
+    bool ok = writeHeader(0, end_) && std::fflush(fp_) == 0 &&
+              std::fseek(fp_, static_cast<long>(end_), SEEK_SET) == 0 &&
+              std::fwrite(idx.data(), 1, idx.size(), fp_) == idx.size() &&
+              std::fflush(fp_) == 0 &&
+              writeHeader(end_, end_);
+    ok = (std::fclose(fp_) == 0) && ok;
+    fp_ = nullptr;
+    return ok;
+}
+
+// ===== Reader =====
+IFBinaryReader::~IFBinaryReader() {
+    close();
+}
+
+void IFBinaryReader::close() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    offsets_.clear();
+    records_end_ = 0;
+}
+
+bool IFBinaryReader::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(IFBinary::kHeaderSize)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* m = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) { size_ = 0; return false; }
+    data_ = static_cast<const uint8_t*>(m);
+
+    IFBHeader h;
+    if (!parse_header(data_, size_, h)) { close(); return false; }
+
+    if (h.records_end != 0 && (h.records_end < IFBinary::kHeaderSize || h.records_end > size_)) {
+        close();
+        return false;
+    }
+    if (h.index_offset == 0) {
+        records_end_ = scan_records(data_, h.records_end ? h.records_end : size_, offsets_);
+        return true;
+    }
+
+    // Every offset is checked here, so dim() / get() / recordData() stay in the mapping
+    const uint64_t idx = h.index_offset;
+    bool ok = idx >= IFBinary::kHeaderSize && idx <= size_ &&
+              (h.records_end == 0 || h.records_end == idx) &&
+              h.count <= (size_ - idx) / 8;
+    if (ok) {
+        offsets_.resize(h.count);
+        const uint8_t* p = data_ + idx;
+        uint64_t min_off = IFBinary::kHeaderSize;   // each record is at least its u16 n
+        for (uint64_t i = 0; i < h.count && ok; ++i) {
+            offsets_[i] = get_u64(p + 8 * i);
+            ok = offsets_[i] >= min_off && offsets_[i] <= idx - 2;
+            min_off = offsets_[i] + 2;
+        }
+    }
+    if (!ok) {
+        close();
+        return false;
+    }
+    records_end_ = idx;
+    return true;
+}
+
+int IFBinaryReader::dim(size_t i) const {
+    if (i >= offsets_.size()) return -1;
+    return get_u16(data_ + offsets_[i]);
+}
+
+uint64_t IFBinaryReader::recordOffset(size_t i) const {
+    return i < offsets_.size() ? offsets_[i] : 0;
+}
+
+const uint8_t* IFBinaryReader::recordData(size_t i) const {
+    return i < offsets_.size() ? data_ + offsets_[i] : nullptr;
+}
+
+size_t IFBinaryReader::recordBytes(size_t i) const {
+    if (i >= offsets_.size()) return 0;
+    const uint64_t next = (i + 1 < offsets_.size()) ? offsets_[i + 1] : records_end_;
+    return static_cast<size_t>(next - offsets_[i]);
+}
+
+bool IFBinaryReader::get(size_t i, Eigen::MatrixXi& out) const {
+    if (i >= offsets_.size()) return false;
+    // Bounded by the record's own end: a record must decode to exactly its bytes
+    const size_t bytes = recordBytes(i);
+    return IFBinary::decodeRecord(data_ + offsets_[i], data_ + offsets_[i] + bytes, out) == bytes;
+}
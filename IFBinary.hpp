@@ -0,0 +1,103 @@
+#pragma once
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Compact binary container for intersection forms (.ifb)
+//
+// Layout (little-endian):
+//   header   : "IFB1" | u32 version | u64 count | u64 index_offset | u64 records_end (32 bytes)
+//   records  : u16 n | n(n+1)/2 upper-triangular entries, row-major (i <= j)
+//              entry = int8, or 0x80 escape followed by int16 for |v| > 127
+//   index    : count x u64 absolute record offsets, located at index_offset
+//
+// index_offset == 0 marks a file that was not closed cleanly; readers then rebuild
+// the index by scanning the records, and writers reopening it do the same. close()
+// stores records_end before it appends the index, so a scan after a crash during
+// close stops there instead of reading the index as records; records_end == 0 (still
+// being written, or files from before the field) scans to the end of the file. A
+// file whose index does not fit it (offsets not ascending, past records_end) fails
+// to open.
+//
+// The text layout produced by appendMatrixText is the original classifier format:
+// space-separated rows, one blank line after every matrix.
+
+class IFBinary {
+public:
+    static constexpr char     kMagic[4]   = {'I','F','B','1'};
+    static constexpr uint32_t kVersion    = 1;
+    static constexpr size_t   kHeaderSize = 32;
+    static constexpr uint8_t  kEscape     = 0x80;
+
+    // Append one encoded record to buf, returns the number of bytes written.
+    // Throws std::invalid_argument for non-square/non-symmetric input or |v| > 32767.
+    static size_t appendRecord(std::string& buf, const Eigen::MatrixXi& M);
+
+    // Decode the record starting at p. Returns bytes consumed, 0 on truncated input
+    // (checked against n before out is resized).
+    static size_t decodeRecord(const uint8_t* p, const uint8_t* end, Eigen::MatrixXi& out);
+
+    // Size of the record starting at p without materializing it, 0 on truncated input.
+    static size_t recordSize(const uint8_t* p, const uint8_t* end);
+
+    // Original text format (rows of space-separated ints + blank line)
+    static void appendMatrixText(std::string& buf, const Eigen::MatrixXi& M);
+};
+
+// Appending writer. Reopening an existing file continues after its last record.
+class IFBinaryWriter {
+public:
+    IFBinaryWriter() = default;
+    ~IFBinaryWriter();
+    IFBinaryWriter(const IFBinaryWriter&) = delete;
+    IFBinaryWriter& operator=(const IFBinaryWriter&) = delete;
+
+    bool open(const std::string& path);
+
+    // Append already-encoded records; lengths[i] is the byte size of record i in bytes.
+    bool appendEncoded(const std::string& bytes, const std::vector<uint32_t>& lengths);
+    bool append(const Eigen::MatrixXi& M);
+
+    // Writes the offset index and finalizes the header
+    bool close();
+
+    bool isOpen() const { return fp_ != nullptr; }
+    uint64_t count() const { return offsets_.size(); }
+
+private:
+    std::FILE* fp_ = nullptr;
+    std::string path_;
+    uint64_t end_ = 0;                 // offset one past the last record
+    std::vector<uint64_t> offsets_;
+
+    bool writeHeader(uint64_t index_offset, uint64_t records_end);
+};
+
+// Read-only, memory-mapped view with O(1) access by record number.
+class IFBinaryReader {
+public:
+    IFBinaryReader() = default;
+    ~IFBinaryReader();
+    IFBinaryReader(const IFBinaryReader&) = delete;
+    IFBinaryReader& operator=(const IFBinaryReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return offsets_.size(); }
+    int    dim(size_t i) const;                       // matrix size of record i, -1 if out of range
+    bool   get(size_t i, Eigen::MatrixXi& out) const;   // false if record i is corrupt
+
+    // Raw access for tools that copy records verbatim
+    uint64_t       recordOffset(size_t i) const;
+    const uint8_t* recordData(size_t i) const;
+    size_t         recordBytes(size_t i) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<uint64_t> offsets_;
+    uint64_t records_end_ = 0;
+};
@@ -0,0 +1,262 @@
+#include "IFCanonical.hpp"
+#include <algorithm>
+#include <numeric>
+
+// ===== Invariants =====
+static constexpr uint64_t kPrime = (1ULL << 61) - 1;
+
+static inline uint64_t mulmod(uint64_t a, uint64_t b) {
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    uint64_t lo = (uint64_t)(r & kPrime) + (uint64_t)(r >> 61);
+    if (lo >= kPrime) lo -= kPrime;
+    return lo;
+}
+
+static uint64_t powmod(uint64_t a, uint64_t e) {
+    uint64_t r = 1;
+    while (e) {
+        if (e & 1) r = mulmod(r, a);
+        a = mulmod(a, a);
+        e >>= 1;
+    }
+    return r;
+}
+
+static uint64_t det_mod_p(const Eigen::MatrixXi& M) {
+    const int n = (int)M.rows();
+    std::vector<uint64_t> A((size_t)n * n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
+            const long long v = M(i, j);
+            A[(size_t)i * n + j] = v >= 0 ? (uint64_t)v % kPrime : kPrime - ((uint64_t)(-v) % kPrime);
+        }
+
+    uint64_t det = 1;
+    for (int c = 0; c < n; ++c) {
+        int piv = c;
+        while (piv < n && A[(size_t)piv * n + c] == 0) ++piv;
+        if (piv == n) return 0;
+        if (piv != c) {
+            for (int j = 0; j < n; ++j) std::swap(A[(size_t)piv * n + j], A[(size_t)c * n + j]);
+            det = det ? kPrime - det : 0;
+        }
+        const uint64_t p = A[(size_t)c * n + c];
+        det = mulmod(det, p);
+        const uint64_t inv = powmod(p, kPrime - 2);
+        for (int r = c + 1; r < n; ++r) {
+            const uint64_t f = mulmod(A[(size_t)r * n + c], inv);
+            if (!f) continue;
+            for (int j = c; j < n; ++j) {
+                const uint64_t sub = mulmod(f, A[(size_t)c * n + j]);
+                uint64_t& x = A[(size_t)r * n + j];
+                x = x >= sub ? x - sub : x + kPrime - sub;
+            }
+        }
+    }
+    return det;
+}
+
+IFCanonical::Invariants IFCanonical::invariants(const Eigen::MatrixXi& M) {
+    Invariants inv;
+    inv.n = (int)M.rows();
+    inv.degrees.resize(inv.n);
+    inv.diagonal.resize(inv.n);
+    for (int i = 0; i < inv.n; ++i) {
+        int d = 0;
+        for (int j = 0; j < inv.n; ++j)
+            if (i != j && M(i, j) != 0) ++d;
+        inv.degrees[i] = d;
+        inv.diagonal[i] = M(i, i);
+    }
+    std::sort(inv.degrees.begin(), inv.degrees.end());
+    std::sort(inv.diagonal.begin(), inv.diagonal.end());
+    inv.det_mod_p = det_mod_p(M);
+    return inv;
+}
+
+std::string IFCanonical::Invariants::key() const {
+    std::string k;
+    k.reserve(12 + 8 * (size_t)n);
+    auto put = [&](uint64_t v, int bytes) {
+        for (int b = 0; b < bytes; ++b) k.push_back((char)((v >> (8 * b)) & 0xff));
+    };
+    put((uint64_t)n, 4);
+    for (int d : degrees)  put((uint32_t)d, 4);
+    for (int d : diagonal) put((uint32_t)d, 4);
+    put(det_mod_p, 8);
+    return k;
+}
+
+// ===== Canonical labelling =====
+namespace {
+
+struct Graph {
+    int n;
+    std::vector<std::vector<std::pair<int,int>>> adj;  // (neighbour, weight)
+    const Eigen::MatrixXi* M;
+};
+
+// Refine colours until stable. Colours are ranks 0..k-1 and new ranks are assigned by
+// sorting label-independent signatures, so the result commutes with relabelling.
+void refine(const Graph& g, std::vector<int>& colour) {
+    const int n = g.n;
+    int classes = colour.empty() ? 0 : *std::max_element(colour.begin(), colour.end()) + 1;
+    std::vector<std::vector<long long>> sig(n);
+    std::vector<int> order(n);
+    for (;;) {
+        for (int v = 0; v < n; ++v) {
+            auto& s = sig[v];
+            s.clear();
+            s.push_back(colour[v]);
+            const size_t head = s.size();
+            for (auto [u, w] : g.adj[v]) s.push_back(((long long)colour[u] << 32) | (uint32_t)w);
+            std::sort(s.begin() + head, s.end());
+        }
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return sig[a] < sig[b]; });
+        std::vector<int> next(n);
+        int k = 0;
+        for (int i = 0; i < n; ++i) {
+            if (i > 0 && sig[order[i]] != sig[order[i - 1]]) ++k;
+            next[order[i]] = k;
+        }
+        const int nclasses = n ? k + 1 : 0;
+        colour.swap(next);
+        if (nclasses == classes) return;
+        classes = nclasses;
+    }
+}
+
+// Upper-triangular encoding of M relabelled so that position colour[v] holds curve v
+std::vector<int> encode(const Graph& g, const std::vector<int>& colour) {
+    std::vector<int> at(g.n);
+    for (int v = 0; v < g.n; ++v) at[colour[v]] = v;
+    std::vector<int> code;
+    code.reserve((size_t)g.n * (g.n + 1) / 2);
+    for (int i = 0; i < g.n; ++i)
+        for (int j = i; j < g.n; ++j) code.push_back((*g.M)(at[i], at[j]));
+    return code;
+}
+
+void search(const Graph& g, std::vector<int> colour,
+            std::vector<int>& best_code, std::vector<int>& best_colour, bool& have_best) {
+    refine(g, colour);
+
+    // Target cell: the smallest colour shared by more than one curve
+    std::vector<int> count(g.n, 0);
+    for (int c : colour) ++count[c];
+    int target = -1;
+    for (int c = 0; c < g.n; ++c)
+        if (count[c] > 1) { target = c; break; }
+
+    if (target < 0) {
+        auto code = encode(g, colour);
+        if (!have_best || code < best_code) {
+            best_code.swap(code);
+            best_colour = colour;
+            have_best = true;
+        }
+        return;
+    }
+
+    // Swapping two twins (same row outside their own pair) is an automorphism that fixes
+    // the colouring, so their subtrees yield the same leaves: explore one per twin class.
+    const Eigen::MatrixXi& M = *g.M;
+    auto twins = [&](int a, int b) {
+        for (int k = 0; k < g.n; ++k)
+            if (k != a && k != b && M(a, k) != M(b, k)) return false;
+        return true;
+    };
+
+    std::vector<int> explored;
+    for (int v = 0; v < g.n; ++v) {
+        if (colour[v] != target) continue;
+        if (std::any_of(explored.begin(), explored.end(), [&](int u) { return twins(u, v); })) continue;
+        explored.push_back(v);
+        // Individualize v: it keeps the cell's colour, every other colour >= target shifts up
+        std::vector<int> c2(colour);
+        for (int u = 0; u < g.n; ++u)
+            if (u != v && c2[u] >= target) ++c2[u];
+        search(g, std::move(c2), best_code, best_colour, have_best);
+    }
+}
+
+} // namespace
+
+std::vector<int> IFCanonical::canonicalPermutation(const Eigen::MatrixXi& M) {
+    Graph g;
+    g.n = (int)M.rows();
+    g.M = &M;
+    g.adj.resize(g.n);
+    for (int i = 0; i < g.n; ++i)
+        for (int j = 0; j < g.n; ++j)
+            if (i != j && M(i, j) != 0) g.adj[i].push_back({j, M(i, j)});
+
+    // Initial colours: rank of the self-intersection
+    std::vector<int> diag(g.n);
+    for (int i = 0; i < g.n; ++i) diag[i] = M(i, i);
+    std::vector<int> uniq(diag);
+    std::sort(uniq.begin(), uniq.end());
+    uniq.erase(std::unique(uniq.begin(), uniq.end()), uniq.end());
+    std::vector<int> colour(g.n);
+    for (int i = 0; i < g.n; ++i)
+        colour[i] = (int)(std::lower_bound(uniq.begin(), uniq.end(), diag[i]) - uniq.begin());
+
+    std::vector<int> best_code, best_colour;
+    bool have_best = false;
+    search(g, std::move(colour), best_code, best_colour, have_best);
+
+    std::vector<int> perm(g.n);
+    for (int v = 0; v < g.n; ++v) perm[best_colour[v]] = v;
+    return perm;
+}
+
+Eigen::MatrixXi IFCanonical::canonicalForm(const Eigen::MatrixXi& M) {
+    const auto perm = canonicalPermutation(M);
+    const int n = (int)perm.size();
+    Eigen::MatrixXi C(n, n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) C(i, j) = M(perm[i], perm[j]);
+    return C;
+}
+
+std::string IFCanonical::canonicalKey(const Eigen::MatrixXi& M) {
+    const auto perm = canonicalPermutation(M);
+    const int n = (int)perm.size();
+    std::string k;
+    k.reserve(4 + 4 * (size_t)n * (n + 1) / 2);
+    auto put = [&](uint32_t v) {
+        for (int b = 0; b < 4; ++b) k.push_back((char)((v >> (8 * b)) & 0xff));
+    };
+    put((uint32_t)n);
+    for (int i = 0; i < n; ++i)
+        for (int j = i; j < n; ++j) put((uint32_t)M(perm[i], perm[j]));
+    return k;
+}
+
+// ===== Deduplication =====
+bool IFDedup::insert(const Eigen::MatrixXi& M, size_t& rep) {
+    auto& bucket = buckets_[IFCanonical::invariants(M).key()];
+
+    if (!bucket.empty()) {
+        const std::string canon = IFCanonical::canonicalKey(M);
+        ++n_canon_;
+        for (auto& e : bucket) {
+            if (e.canon.empty()) {
+                e.canon = IFCanonical::canonicalKey(e.M);
+                ++n_canon_;
+            }
+            if (e.canon == canon) {
+                rep = e.rep;
+                return false;
+            }
+        }
+        rep = n_classes_++;
+        bucket.push_back(Entry{Eigen::MatrixXi(), canon, rep});
+        return true;
+    }
+
+    rep = n_classes_++;
+    bucket.push_back(Entry{M, std::string(), rep});
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <Eigen/Dense>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Isomorphism-canonical labelling of intersection forms.
+//
+// An intersection form is read as a graph on its curves: the diagonal (self-
+// intersection) is the vertex colour and every non-zero off-diagonal entry is a
+// weighted edge. Two forms that differ only by a relabelling of the curves (mirror
+// chains, decorations attached in a different index order, ...) get the same
+// canonical form.
+//
+// Canonization is colour refinement plus individualization over the remaining
+// ties, keeping the lexicographically smallest relabelled matrix.
+
+class IFCanonical {
+public:
+    // Relabelling-invariant summary used as a cheap prefilter
+    struct Invariants {
+        int n = 0;
+        std::vector<int> degrees;     // sorted number of neighbours per curve
+        std::vector<int> diagonal;    // sorted self-intersections
+        uint64_t det_mod_p = 0;       // determinant modulo 2^61-1 (exact, overflow-free)
+
+        std::string key() const;      // byte string, equal iff invariants are equal
+    };
+
+    static Invariants invariants(const Eigen::MatrixXi& M);
+
+    // perm[k] = original index of the curve placed at position k
+    static std::vector<int> canonicalPermutation(const Eigen::MatrixXi& M);
+    static Eigen::MatrixXi canonicalForm(const Eigen::MatrixXi& M);
+
+    // Compact encoding of the canonical form (equal iff the forms are isomorphic)
+    static std::string canonicalKey(const Eigen::MatrixXi& M);
+};
+
+// Keeps the first representative of every isomorphism class. Canonical forms are only
+// computed once two forms share all cheap invariants.
+class IFDedup {
+public:
+    // Returns true if M opens a new class; rep receives the class index (0, 1, ...)
+    bool insert(const Eigen::MatrixXi& M, size_t& rep);
+
+    size_t classes() const { return n_classes_; }
+    size_t canonizations() const { return n_canon_; }
+
+private:
+    struct Entry {
+        Eigen::MatrixXi M;
+        std::string canon;      // empty until needed
+        size_t rep;
+    };
+    std::unordered_map<std::string, std::vector<Entry>> buckets_;  // by Invariants::key()
+    size_t n_classes_ = 0;
+    size_t n_canon_ = 0;
+};
@@ -0,0 +1,280 @@
+#include "LineIngest.hpp"
+#include "TopoDelta.hpp"
+#include "Txtz.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===== Mapping =====
+LineIngest::~LineIngest() { close(); }
+
+void LineIngest::close() {
+    if (mapped_ && data_) munmap(const_cast<char*>(data_), (size_t)size_);
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = mapped_ = delta_ = txtz_ = false;
+    fallback_.clear();
+    fallback_.shrink_to_fit();
+    chunks_.clear();
+}
+
+bool LineIngest::open(const std::string& path, std::uintmax_t chunk_bytes, int threads) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+            size_ = (std::uintmax_t)st.st_size;
+            mapped_ = true;
+        }
+    }
+    ::close(fd);
+
+    if (!mapped_) {
+        // Pipes, special files, or mmap failure: read it all
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        fallback_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+    }
+    opened_ = true;
+    if (TopoDelta::isDelta(std::string_view(data_, (size_t)size_))) return splitDelta(chunk_bytes);
+    if (Txtz::isTxtz(std::string_view(data_, (size_t)size_))) return splitTxtz(chunk_bytes);
+
+    // Newline-aligned split
+    std::uintmax_t begin = 0;
+    do {
+        std::uintmax_t end = size_;
+        if (chunk_bytes > 0 && size_ - begin > chunk_bytes) {
+            const char* nl = static_cast<const char*>(
+                std::memchr(data_ + begin + chunk_bytes, '\n', (size_t)(size_ - begin - chunk_bytes)));
+            end = nl ? (std::uintmax_t)(nl - data_) + 1 : size_;
+        }
+        chunks_.push_back({begin, end, 1});
+        begin = end;
+    } while (begin < size_);
+
+    // Newlines per chunk, in parallel; a prefix sum gives every chunk's first line
+    std::vector<int> newlines(chunks_.size(), 0);
+    auto count = [&](size_t from, size_t step) {
+        for (size_t i = from; i < chunks_.size(); i += step) {
+            const auto v = text(chunks_[i]);
+            newlines[i] = (int)std::count(v.begin(), v.end(), '\n');
+        }
+    };
+    const size_t nthreads = std::min<size_t>(std::max(1, threads), chunks_.size());
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < nthreads; ++t) pool.emplace_back(count, t, nthreads);
+    count(0, nthreads);
+    for (auto& th : pool) th.join();
+
+    int line = 1;
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        chunks_[i].first_line = line;
+        line += newlines[i];
+    }
+    return true;
+}
+
+// Group-aligned split of a base+delta file; first_line counts records
+bool LineIngest::splitDelta(std::uintmax_t chunk_bytes) {
+    delta_ = true;
+    const std::string_view all(data_, (size_t)size_);
+    IngestChunk c{TopoDelta::kHeaderSize, TopoDelta::kHeaderSize, 1};
+    int record = 1;
+    TopoDelta::Group g;
+    while (TopoDelta::readGroup(all, (size_t)c.end, g)) {
+        c.end = g.end;
+        record += (int)g.variants;
+        if (chunk_bytes > 0 && c.end - c.begin >= chunk_bytes && c.end < size_) {
+            chunks_.push_back(c);
+            c = IngestChunk{c.end, c.end, record};
+        }
+    }
+    // A malformed tail stays in the last chunk, where parsing reports it
+    c.end = size_;
+    chunks_.push_back(c);
+    return true;
+}
+
+// Block-aligned split of a compressed file; line numbers come from the block headers
+bool LineIngest::splitTxtz(std::uintmax_t chunk_bytes) {
+    txtz_ = true;
+    const std::string_view all(data_, (size_t)size_);
+    IngestChunk c{Txtz::kHeaderSize, Txtz::kHeaderSize, 1};
+    std::uintmax_t raw = 0;
+    int line = 1;
+    Txtz::Block b;
+    while (Txtz::readBlock(all, c.end, b)) {
+        c.end = b.end();
+        raw += b.raw;
+        line += (int)b.lines;
+        if (chunk_bytes > 0 && raw >= chunk_bytes && c.end < size_) {
+            chunks_.push_back(c);
+            c = IngestChunk{c.end, c.end, line};
+            raw = 0;
+        }
+    }
+    // A truncated tail stays in the last chunk, where parsing reports it
+    c.end = size_;
+    chunks_.push_back(c);
+    return true;
+}
+
+// ===== Parsing =====
+// Records of a base+delta chunk: the base is parsed once per group
+void LineIngest::parseDeltaChunk(const IngestChunk& c, IngestBatch& out, uint32_t fields) const {
+    const std::string_view all = text(c);
+    int record = c.first_line;
+    size_t pos = 0;
+    Topology_enhanced base;
+    TopoDelta::Group g;
+    while (pos < all.size()) {
+        if (!TopoDelta::readGroup(all, pos, g)) {
+            IngestRecord& r = out.next();
+            r.line = record;
+            r.status = {TopoLineCompact_enhanced::ParseError::BadDelta, pos};
+            return;
+        }
+        const auto base_status = TopoLineCompact_enhanced::parse(g.base, base, fields);
+        size_t at = 0;
+        for (uint64_t v = 0; v < g.variants; ++v) {
+            IngestRecord& r = out.next();
+            r.line = record++;
+            r.status = base_status;
+            if (!r.status) continue;
+            r.topo = base;
+            if (!TopoDelta::applyVariant(g.body, at, r.topo, fields)) {
+                r.status = {TopoLineCompact_enhanced::ParseError::BadDelta, at};
+                return;
+            }
+            r.topo.name = "line_" + std::to_string(r.line);
+        }
+        pos = g.end;
+    }
+}
+
+// Blocks of a compressed chunk, each decompressed and parsed in turn; a corrupt block
+// is one error record at its first line
+void LineIngest::parseTxtzChunk(const IngestChunk& c, IngestBatch& out, uint32_t fields) const {
+    thread_local std::string raw;
+    const std::string_view all(data_, (size_t)c.end);
+    int line = c.first_line;
+    Txtz::Block b;
+    for (uint64_t pos = c.begin; pos < c.end; pos = b.end()) {
+        const bool framed = Txtz::readBlock(all, pos, b);
+        if (!framed || !Txtz::decodeBlock(all, b, raw)) {
+            IngestRecord& r = out.next();
+            r.line = line;
+            r.status = {TopoLineCompact_enhanced::ParseError::BadBlock, 0};
+            if (!framed) return;   // truncated: nothing follows
+        } else {
+            parseLines(raw, line, out, fields);
+        }
+        line += (int)b.lines;
+    }
+}
+
+void LineIngest::parseChunk(size_t idx, IngestBatch& out, uint32_t fields) const {
+    out.reset();
+    out.chunk = idx;
+    const IngestChunk& c = chunks_.at(idx);
+    if (delta_) parseDeltaChunk(c, out, fields);
+    else if (txtz_) parseTxtzChunk(c, out, fields);
+    else parseLines(text(c), c.first_line, out, fields);
+}
+
+void LineIngest::parseLines(std::string_view all, int first_line, IngestBatch& out, uint32_t fields) {
+    int line_num = first_line;
+    size_t pos = 0;
+    while (pos < all.size()) {
+        size_t nl = all.find('\n', pos);
+        if (nl == std::string_view::npos) nl = all.size();
+        const std::string_view line = all.substr(pos, nl - pos);
+        pos = nl + 1;
+
+        if (!line.empty()) {
+            IngestRecord& r = out.next();
+            r.line = line_num;
+            r.status = TopoLineCompact_enhanced::parse(line, r.topo, fields);
+            if (r.status) r.topo.name = "line_" + std::to_string(line_num);
+        }
+        ++line_num;
+    }
+}
+
+void LineIngest::run(int threads, const Sink& sink, uint32_t fields) const {
+    const size_t n = chunks_.size();
+    const size_t nthreads = std::min<size_t>(std::max(1, threads), n);
+    if (nthreads <= 1) {
+        IngestBatch batch;
+        for (size_t i = 0; i < n; ++i) {
+            parseChunk(i, batch, fields);
+            sink(batch);
+        }
+        return;
+    }
+
+    // Chunk i is parsed into slot i % window once chunk i - window has been delivered
+    const size_t window = 2 * nthreads;
+    std::vector<IngestBatch> slots(window);
+    std::vector<char> ready(window, 0);
+    std::mutex mtx;
+    std::condition_variable ready_cv, free_cv;
+    size_t next = 0, delivered = 0;
+    bool stop = false;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                free_cv.wait(lk, [&]{ return stop || next >= n || next - delivered < window; });
+                if (stop || next >= n) return;
+                i = next++;
+            }
+            parseChunk(i, slots[i % window], fields);
+            std::lock_guard<std::mutex> lk(mtx);
+            ready[i % window] = 1;
+            ready_cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < nthreads; ++t) pool.emplace_back(worker);
+
+    std::exception_ptr failure;
+    for (size_t d = 0; d < n && !failure; ++d) {
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            ready_cv.wait(lk, [&]{ return ready[d % window] != 0; });
+        }
+        try {
+            sink(slots[d % window]);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lk(mtx);
+        ready[d % window] = 0;
+        ++delivered;
+        if (failure) stop = true;
+        free_cv.notify_all();
+    }
+    for (auto& th : pool) th.join();
+    if (failure) std::rethrow_exception(failure);
+}
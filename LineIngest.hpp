@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Topology_enhanced.h"
+#include "TopoLineCompact_enhanced.hpp"
+
+// Parallel ingest of line-compact files.
+//
+// The file is memory-mapped (read into memory if mapping is not possible) and cut into
+// newline-aligned chunks of about chunk_bytes. Newlines are counted per chunk in
+// parallel, so every chunk knows the number of its first line before anything is
+// parsed; chunks can then be parsed independently and in any order. Line numbers and
+// names match a std::getline loop over the file: numbering starts at 1, empty lines
+// are skipped but counted, and every parsed topology is named "line_<N>".
+//
+// Base+delta files (TopoDelta.hpp) are recognized by their magic and read the same way:
+// chunks are cut at group boundaries, and "lines" are record numbers, so records are
+// numbered and named as in the expanded line-compact file.
+//
+// Block-compressed files (Txtz.hpp) are cut at block boundaries; the block headers carry
+// the line counts, so nothing is decompressed before parsing, and every chunk is
+// decompressed by the worker that parses it.
+
+// Bytes [begin, end) of the file; end is just past a '\n' (or the end of the file)
+struct IngestChunk {
+    std::uintmax_t begin = 0;
+    std::uintmax_t end = 0;
+    int first_line = 1;
+};
+
+struct IngestRecord {
+    int line = 0;
+    TopoLineCompact_enhanced::ParseStatus status;   // topo is only valid if status is ok
+    Topology_enhanced topo;
+};
+
+// Records of one chunk in line order. Reusing a batch keeps the capacity of every
+// topology's vectors, so steady-state parsing does not allocate.
+class IngestBatch {
+public:
+    size_t chunk = 0;
+
+    size_t size() const { return n_; }
+    IngestRecord* begin() { return records_.data(); }
+    IngestRecord* end()   { return records_.data() + n_; }
+    const IngestRecord* begin() const { return records_.data(); }
+    const IngestRecord* end() const   { return records_.data() + n_; }
+
+private:
+    friend class LineIngest;
+    std::vector<IngestRecord> records_;
+    size_t n_ = 0;
+
+    void reset() { n_ = 0; }
+    IngestRecord& next() {
+        if (n_ == records_.size()) records_.emplace_back();
+        return records_[n_++];
+    }
+};
+
+class LineIngest {
+public:
+    static constexpr std::uintmax_t kDefaultChunkBytes = 1u << 20;
+
+    LineIngest() = default;
+    ~LineIngest();
+    LineIngest(const LineIngest&) = delete;
+    LineIngest& operator=(const LineIngest&) = delete;
+
+    // Map `path` and split it; `threads` workers count the newlines. chunk_bytes = 0
+    // keeps the file in one chunk; an empty file is a single empty chunk.
+    bool open(const std::string& path, std::uintmax_t chunk_bytes = kDefaultChunkBytes,
+              int threads = 1);
+    void close();
+
+    bool isOpen() const { return opened_; }
+    std::uintmax_t size() const { return size_; }
+    const std::vector<IngestChunk>& chunks() const { return chunks_; }
+    std::string_view text(const IngestChunk& c) const {
+        return std::string_view(data_ + c.begin, (size_t)(c.end - c.begin));
+    }
+
+    // Parse chunk `idx` into `out` (refilled). Safe to call concurrently.
+    void parseChunk(size_t idx, IngestBatch& out,
+                    uint32_t fields = TopoLineCompact_enhanced::AllFields) const;
+
+    // Parse every chunk on `threads` workers; sink runs on the calling thread, once per
+    // chunk, in file order. At most 2 x threads parsed batches are held at a time.
+    using Sink = std::function<void(IngestBatch&)>;
+    void run(int threads, const Sink& sink,
+             uint32_t fields = TopoLineCompact_enhanced::AllFields) const;
+
+private:
+    const char* data_ = nullptr;
+    std::uintmax_t size_ = 0;
+    bool opened_ = false;
+    bool mapped_ = false;          // data_ is an mmap (else it points into fallback_)
+    bool delta_ = false;           // base+delta file
+    bool txtz_ = false;            // block-compressed file
+    std::string fallback_;
+    std::vector<IngestChunk> chunks_;
+
+    bool splitDelta(std::uintmax_t chunk_bytes);
+    bool splitTxtz(std::uintmax_t chunk_bytes);
+    void parseDeltaChunk(const IngestChunk& c, IngestBatch& out, uint32_t fields) const;
+    void parseTxtzChunk(const IngestChunk& c, IngestBatch& out, uint32_t fields) const;
+    static void parseLines(std::string_view all, int first_line, IngestBatch& out, uint32_t fields);
+};
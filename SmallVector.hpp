@@ -0,0 +1,254 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// std::vector-like sequence keeping its first N elements inside the object
+//
+// Topology_enhanced's lists are short (a handful of blocks, side links, externals), so
+// with N fitted to them a typical topology makes no heap allocation and copying one is
+// a few memcpy's. Past N the elements move to the heap and grow geometrically, as in
+// std::vector. Elements must be trivially copyable: storage is moved with memcpy and
+// slots beyond size() are left uninitialized.
+//
+// Iterators are plain pointers. As with std::vector, growth invalidates them; unlike
+// std::vector, so does moving or swapping a vector whose elements are still inline.
+// Conversions to and from std::vector<T> keep code written against std::vector compiling.
+template <class T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector elements must be trivially copyable");
+    static_assert(N > 0, "SmallVector needs an inline capacity");
+
+public:
+    using value_type             = T;
+    using size_type              = size_t;
+    using difference_type        = std::ptrdiff_t;
+    using reference              = T&;
+    using const_reference        = const T&;
+    using pointer                = T*;
+    using const_pointer          = const T*;
+    using iterator               = T*;
+    using const_iterator         = const T*;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_t kInline = N;
+
+    SmallVector() noexcept : data_(inlineData()), size_(0), cap_(N) {}
+    explicit SmallVector(size_t n, const T& v = T()) : SmallVector() { assign(n, v); }
+    SmallVector(std::initializer_list<T> il) : SmallVector() { assign(il.begin(), il.end()); }
+    template <class It, class = typename std::iterator_traits<It>::iterator_category>
+    SmallVector(It first, It last) : SmallVector() { assign(first, last); }
+    SmallVector(const std::vector<T>& v) : SmallVector() { assign(v.begin(), v.end()); }
+
+    SmallVector(const SmallVector& o) : SmallVector() { copyFrom(o); }
+    SmallVector(SmallVector&& o) noexcept : SmallVector() { moveFrom(o); }
+    ~SmallVector() { release(); }
+
+    SmallVector& operator=(const SmallVector& o) {
+        if (this != &o) copyFrom(o);
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& o) noexcept {
+        if (this != &o) {
+            release();
+            data_ = inlineData();
+            cap_ = N;
+            moveFrom(o);
+        }
+        return *this;
+    }
+    SmallVector& operator=(const std::vector<T>& v) {
+        assign(v.begin(), v.end());
+        return *this;
+    }
+    SmallVector& operator=(std::initializer_list<T> il) {
+        assign(il.begin(), il.end());
+        return *this;
+    }
+
+    operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+    // ===== Access =====
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    T& at(size_t i) {
+        if (i >= size_) throw std::out_of_range("SmallVector::at");
+        return data_[i];
+    }
+    const T& at(size_t i) const {
+        if (i >= size_) throw std::out_of_range("SmallVector::at");
+        return data_[i];
+    }
+    T& front() { return data_[0]; }
+    const T& front() const { return data_[0]; }
+    T& back() { return data_[size_ - 1]; }
+    const T& back() const { return data_[size_ - 1]; }
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+    const_iterator cbegin() const noexcept { return data_; }
+    const_iterator cend() const noexcept { return data_ + size_; }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    // ===== Capacity =====
+    bool empty() const noexcept { return size_ == 0; }
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return cap_; }
+    bool isInline() const noexcept { return data_ == inlineData(); }
+    void reserve(size_t n) {
+        if (n > cap_) grow(n);
+    }
+    void shrink_to_fit() {}
+
+    // ===== Modifiers =====
+    void clear() noexcept { size_ = 0; }
+
+    void push_back(const T& v) {
+        if (size_ == cap_) {
+            const T copy = v;   // v may live in this vector
+            grow(size_ + 1);
+            data_[size_++] = copy;
+            return;
+        }
+        data_[size_++] = v;
+    }
+    template <class... Args>
+    T& emplace_back(Args&&... args) {
+        T v{std::forward<Args>(args)...};
+        push_back(v);
+        return back();
+    }
+    void pop_back() { --size_; }
+
+    void resize(size_t n, const T& v = T()) {
+        if (n > size_) {
+            const T copy = v;
+            reserve(n);
+            std::fill(data_ + size_, data_ + n, copy);
+        }
+        size_ = static_cast<uint32_t>(n);
+    }
+
+    void assign(size_t n, const T& v) {
+        const T copy = v;
+        clear();
+        reserve(n);
+        std::fill(data_, data_ + n, copy);
+        size_ = static_cast<uint32_t>(n);
+    }
+    template <class It, class = typename std::iterator_traits<It>::iterator_category>
+    void assign(It first, It last) {
+        clear();
+        for (; first != last; ++first) push_back(*first);
+    }
+    void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+    iterator insert(const_iterator pos, const T& v) {
+        const size_t i = static_cast<size_t>(pos - data_);
+        const T copy = v;
+        reserve(size_ + 1);
+        std::memmove(data_ + i + 1, data_ + i, (size_ - i) * sizeof(T));
+        data_[i] = copy;
+        ++size_;
+        return data_ + i;
+    }
+    template <class It, class = typename std::iterator_traits<It>::iterator_category>
+    iterator insert(const_iterator pos, It first, It last) {
+        const size_t i = static_cast<size_t>(pos - data_);
+        const SmallVector ins(first, last);   // [first, last) may lie in *this
+        reserve(size_ + ins.size_);
+        std::memmove(data_ + i + ins.size_, data_ + i, (size_ - i) * sizeof(T));
+        std::memcpy(data_ + i, ins.data_, ins.size_ * sizeof(T));
+        size_ += ins.size_;
+        return data_ + i;
+    }
+    iterator insert(const_iterator pos, std::initializer_list<T> il) { return insert(pos, il.begin(), il.end()); }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last) {
+        const size_t i = static_cast<size_t>(first - data_);
+        const size_t j = static_cast<size_t>(last - data_);
+        std::memmove(data_ + i, data_ + j, (size_ - j) * sizeof(T));
+        size_ -= static_cast<uint32_t>(j - i);
+        return data_ + i;
+    }
+
+    void swap(SmallVector& o) noexcept {
+        SmallVector tmp(std::move(o));
+        o = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+private:
+    T* data_;
+    uint32_t size_, cap_;
+    alignas(T) unsigned char inline_[N * sizeof(T)];
+
+    T* inlineData() noexcept { return reinterpret_cast<T*>(inline_); }
+    const T* inlineData() const noexcept { return reinterpret_cast<const T*>(inline_); }
+
+    void grow(size_t need) {
+        size_t cap = std::max<size_t>(need, 2 * size_t(cap_));
+        T* p = static_cast<T*>(std::malloc(cap * sizeof(T)));
+        if (!p) throw std::bad_alloc();
+        std::memcpy(p, data_, size_ * sizeof(T));
+        release();
+        data_ = p;
+        cap_ = static_cast<uint32_t>(cap);
+    }
+    void release() noexcept {
+        if (!isInline()) std::free(data_);
+    }
+    void copyFrom(const SmallVector& o) {
+        if (o.isInline() && isInline()) {   // fixed size: a few register moves
+            std::memcpy(inline_, o.inline_, sizeof(inline_));
+        } else {
+            clear();
+            reserve(o.size_);
+            std::memcpy(data_, o.data_, o.size_ * sizeof(T));
+        }
+        size_ = o.size_;
+    }
+    // *this is empty and inline
+    void moveFrom(SmallVector& o) noexcept {
+        if (o.isInline()) {
+            std::memcpy(data_, o.data_, o.size_ * sizeof(T));
+        } else {
+            data_ = o.data_;
+            cap_ = o.cap_;
+            o.data_ = o.inlineData();
+            o.cap_ = N;
+        }
+        size_ = o.size_;
+        o.size_ = 0;
+    }
+};
+
+template <class T, size_t N>
+bool operator==(const SmallVector<T, N>& a, const SmallVector<T, N>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+template <class T, size_t N>
+bool operator!=(const SmallVector<T, N>& a, const SmallVector<T, N>& b) {
+    return !(a == b);
+}
+template <class T, size_t N>
+void swap(SmallVector<T, N>& a, SmallVector<T, N>& b) noexcept {
+    a.swap(b);
+}
@@ -45,6 +45,7 @@ class Tensor {
 		void ForcedBlowdown();
 		void SetElement(int n, int m, int k);
 		void Setb0Q();
+		void Setb0Q(const std::vector<int>& b0);
 		std::vector<int> Getb0Q();
 		Eigen::MatrixXi GetIFb0Q();
 		// Methods for adding link, node, side link, extra tensor and minimal lst
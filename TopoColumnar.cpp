@@ -0,0 +1,275 @@
+#include "TopoColumnar.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Columns are used in place, so the host must share the file's byte order
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "TopoColumnar needs a little-endian host");
+
+// ===== Helper functions for LKind conversion =====
+static inline uint8_t kindToCode(LKind k) {
+    switch (k) {
+        case LKind::g: return 0;
+        case LKind::L: return 1;
+        case LKind::S: return 2;
+        case LKind::I: return 3;
+        case LKind::E: return 4;
+    }
+    return 0;
+}
+
+static inline LKind codeToKind(uint8_t k) {
+    switch (k) {
+        case 0: return LKind::g;
+        case 1: return LKind::L;
+        case 2: return LKind::S;
+        case 3: return LKind::I;
+        case 4: return LKind::E;
+    }
+    return LKind::g;
+}
+
+static inline void put_u32(std::string& b, uint32_t v) {
+    for (int k = 0; k < 4; ++k) b.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+static inline void put_u64(std::string& b, uint64_t v) {
+    for (int k = 0; k < 8; ++k) b.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+static inline uint64_t get_u64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+bool TopoColumnar::isColumnarFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char m[4];
+    return in.read(m, 4) && std::memcmp(m, kMagic, 4) == 0;
+}
+
+// ===== Writer =====
+TopoColumnarWriter::TopoColumnarWriter()
+    : names_off_{0}, block_off_{0}, side_off_{0}, inst_off_{0}, ext_off_{0},
+      l_off_{0}, s_off_{0}, i_off_{0}, e_off_{0} {}
+
+void TopoColumnarWriter::add(const Topology_enhanced& T) {
+    names_ += T.name;
+    names_off_.push_back(names_.size());
+
+    for (const auto& b : T.block) {
+        kinds_.push_back(kindToCode(b.kind));
+        bparams_.push_back(b.param);
+    }
+    block_off_.push_back(kinds_.size());
+
+    for (const auto& s : T.side_links) sparams_.push_back(s.param);
+    side_off_.push_back(sparams_.size());
+    for (const auto& s : T.instantons) iparams_.push_back(s.param);
+    inst_off_.push_back(iparams_.size());
+    for (const auto& e : T.externals) eparams_.push_back(e.param);
+    ext_off_.push_back(eparams_.size());
+
+    for (const auto& e : T.l_connection) { lconn_.push_back(e.u); lconn_.push_back(e.v); }
+    l_off_.push_back(lconn_.size() / 2);
+    for (const auto& e : T.s_connection) { sconn_.push_back(e.u); sconn_.push_back(e.v); }
+    s_off_.push_back(sconn_.size() / 2);
+    for (const auto& e : T.i_connection) { iconn_.push_back(e.u); iconn_.push_back(e.v); }
+    i_off_.push_back(iconn_.size() / 2);
+    for (const auto& e : T.e_connection) {
+        econn_.push_back(e.parent_id);
+        econn_.push_back(e.parent_type);
+        econn_.push_back(e.port_idx);
+        econn_.push_back(e.external_id);
+    }
+    e_off_.push_back(econn_.size() / 4);
+}
+
+bool TopoColumnarWriter::write(const std::string& path) const {
+    struct Part { const void* p; size_t bytes; };
+    auto vec = [](const auto& v) { return Part{v.data(), v.size() * sizeof(v[0])}; };
+    const Part parts[TopoColumnar::kSections] = {
+        vec(names_off_), Part{names_.data(), names_.size()},
+        vec(block_off_), vec(kinds_), vec(bparams_),
+        vec(side_off_), vec(sparams_),
+        vec(inst_off_), vec(iparams_),
+        vec(ext_off_), vec(eparams_),
+        vec(l_off_), vec(lconn_),
+        vec(s_off_), vec(sconn_),
+        vec(i_off_), vec(iconn_),
+        vec(e_off_), vec(econn_),
+    };
+
+    std::string header;
+    header.append(TopoColumnar::kMagic, 4);
+    put_u32(header, TopoColumnar::kVersion);
+    put_u64(header, size());
+    uint64_t off = TopoColumnar::kHeaderSize;
+    for (const auto& part : parts) {
+        off = (off + 7) & ~uint64_t(7);
+        put_u64(header, off);
+        put_u64(header, part.bytes);
+        off += part.bytes;
+    }
+
+    const auto p = std::filesystem::path(path);
+    if (!p.parent_path().empty()) std::filesystem::create_directories(p.parent_path());
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(header.data(), (std::streamsize)header.size());
+        uint64_t pos = header.size();
+        static const char zeros[8] = {};
+        for (const auto& part : parts) {
+            const uint64_t aligned = (pos + 7) & ~uint64_t(7);
+            out.write(zeros, (std::streamsize)(aligned - pos));
+            if (part.bytes) out.write(static_cast<const char*>(part.p), (std::streamsize)part.bytes);
+            pos = aligned + part.bytes;
+        }
+        if (!out.good()) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// ===== Reader =====
+TopoColumnarReader::~TopoColumnarReader() {
+    close();
+}
+
+void TopoColumnarReader::close() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = count_ = 0;
+}
+
+bool TopoColumnarReader::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < TopoColumnar::kHeaderSize) { ::close(fd); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<const uint8_t*>(p);
+    size_ = (size_t)st.st_size;
+
+    auto fail = [&]() { close(); return false; };
+    if (std::memcmp(data_, TopoColumnar::kMagic, 4) != 0) return fail();
+    uint32_t version;
+    std::memcpy(&version, data_ + 4, 4);
+    if (version != TopoColumnar::kVersion) return fail();
+    const uint64_t count = get_u64(data_ + 8);
+    // Each offset column holds count + 1 u64s, so count < size / 8; checked before
+    // (count + 1) * 8 below can overflow
+    if (count >= size_ / 8) return fail();
+
+    const uint8_t* sec[TopoColumnar::kSections];
+    uint64_t bytes[TopoColumnar::kSections];
+    for (uint32_t s = 0; s < TopoColumnar::kSections; ++s) {
+        const uint64_t off = get_u64(data_ + 16 + 16 * s);
+        bytes[s] = get_u64(data_ + 24 + 16 * s);
+        if (off % 8 != 0 || off > size_ || bytes[s] > size_ - off) return fail();
+        sec[s] = data_ + off;
+    }
+
+    // Offset columns: count+1 non-decreasing entries from 0, ending at the element count
+    struct Col { OffCol col; TopoColumnar::Section off, elems; size_t elem_bytes; };
+    const Col cols[kOffCols] = {
+        {NameOffCol,  TopoColumnar::NameOff,  TopoColumnar::NameBytes,  1},
+        {BlockOffCol, TopoColumnar::BlockOff, TopoColumnar::BParams,    4},
+        {SideOffCol,  TopoColumnar::SideOff,  TopoColumnar::SideParams, 4},
+        {InstOffCol,  TopoColumnar::InstOff,  TopoColumnar::InstParams, 4},
+        {ExtOffCol,   TopoColumnar::ExtOff,   TopoColumnar::ExtParams,  4},
+        {LOffCol,     TopoColumnar::LOff,     TopoColumnar::LConn,      8},
+        {SOffCol,     TopoColumnar::SOff,     TopoColumnar::SConn,      8},
+        {IOffCol,     TopoColumnar::IOff,     TopoColumnar::IConn,      8},
+        {EOffCol,     TopoColumnar::EOff,     TopoColumnar::EConn,      16},
+    };
+    for (const auto& c : cols) {
+        if (bytes[c.off] != (count + 1) * sizeof(uint64_t)) return fail();
+        const uint64_t* o = reinterpret_cast<const uint64_t*>(sec[c.off]);
+        if (bytes[c.elems] % c.elem_bytes != 0) return fail();
+        if (o[0] != 0 || o[count] != bytes[c.elems] / c.elem_bytes) return fail();
+        for (uint64_t i = 0; i < count; ++i)
+            if (o[i + 1] < o[i]) return fail();
+        off_[c.col] = o;
+    }
+    if (bytes[TopoColumnar::Kinds] != bytes[TopoColumnar::BParams] / 4) return fail();
+
+    count_   = (size_t)count;
+    names_   = reinterpret_cast<const char*>(sec[TopoColumnar::NameBytes]);
+    kinds_   = sec[TopoColumnar::Kinds];
+    bparams_ = reinterpret_cast<const int32_t*>(sec[TopoColumnar::BParams]);
+    sparams_ = reinterpret_cast<const int32_t*>(sec[TopoColumnar::SideParams]);
+    iparams_ = reinterpret_cast<const int32_t*>(sec[TopoColumnar::InstParams]);
+    eparams_ = reinterpret_cast<const int32_t*>(sec[TopoColumnar::ExtParams]);
+    lconn_   = reinterpret_cast<const int32_t*>(sec[TopoColumnar::LConn]);
+    sconn_   = reinterpret_cast<const int32_t*>(sec[TopoColumnar::SConn]);
+    iconn_   = reinterpret_cast<const int32_t*>(sec[TopoColumnar::IConn]);
+    econn_   = reinterpret_cast<const int32_t*>(sec[TopoColumnar::EConn]);
+    return true;
+}
+
+std::string_view TopoColumnarReader::name(size_t i) const {
+    if (i >= count_) return {};
+    return std::string_view(names_ + off_[NameOffCol][i], span(NameOffCol, i));
+}
+
+const uint8_t* TopoColumnarReader::kinds(size_t i) const {
+    return i < count_ ? kinds_ + off_[BlockOffCol][i] : nullptr;
+}
+
+const int32_t* TopoColumnarReader::blockParams(size_t i) const {
+    return i < count_ ? bparams_ + off_[BlockOffCol][i] : nullptr;
+}
+
+const int32_t* TopoColumnarReader::externalParams(size_t i) const {
+    return i < count_ ? eparams_ + off_[ExtOffCol][i] : nullptr;
+}
+
+const int32_t* TopoColumnarReader::eConn(size_t i) const {
+    return i < count_ ? econn_ + 4 * off_[EOffCol][i] : nullptr;
+}
+
+bool TopoColumnarReader::get(size_t i, Topology_enhanced& T) const {
+    if (i >= count_) return false;
+    T.Initialize();
+    T.name.assign(name(i));
+
+    const size_t nb = blockCount(i);
+    const uint8_t* k = kinds(i);
+    const int32_t* bp = blockParams(i);
+    for (size_t j = 0; j < nb; ++j) T.block.push_back(Block{codeToKind(k[j]), bp[j]});
+
+    for (uint64_t j = off_[SideOffCol][i]; j < off_[SideOffCol][i + 1]; ++j)
+        T.side_links.push_back(SideLinks{sparams_[j]});
+    for (uint64_t j = off_[InstOffCol][i]; j < off_[InstOffCol][i + 1]; ++j)
+        T.instantons.push_back(Instantons{iparams_[j]});
+    for (uint64_t j = off_[ExtOffCol][i]; j < off_[ExtOffCol][i + 1]; ++j)
+        T.externals.push_back(External{eparams_[j]});
+
+    for (uint64_t j = off_[LOffCol][i]; j < off_[LOffCol][i + 1]; ++j)
+        T.l_connection.push_back(InteriorStructure{lconn_[2*j], lconn_[2*j + 1]});
+    for (uint64_t j = off_[SOffCol][i]; j < off_[SOffCol][i + 1]; ++j)
+        T.s_connection.push_back(SideLinkStructure{sconn_[2*j], sconn_[2*j + 1]});
+    for (uint64_t j = off_[IOffCol][i]; j < off_[IOffCol][i + 1]; ++j)
+        T.i_connection.push_back(InstantonStructure{iconn_[2*j], iconn_[2*j + 1]});
+    for (uint64_t j = off_[EOffCol][i]; j < off_[EOffCol][i + 1]; ++j)
+        T.e_connection.push_back(ExternalStructure{econn_[4*j], econn_[4*j + 1],
+                                                   econn_[4*j + 2], econn_[4*j + 3]});
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Topology_enhanced.h"
+
+// Columnar (structure-of-arrays) topology store (.tcol)
+//
+// Layout (little-endian, every section 8-byte aligned):
+//   header   : "TCL1" | u32 version | u64 count | kSections x (u64 offset, u64 bytes)
+//   sections : one array per field of Topology_enhanced, all records back to back.
+//              Variable-length fields are CSR: a u64 offset column with count+1
+//              entries (in elements) plus the packed element array, so record i of a
+//              field is elements [off[i], off[i+1]).
+//
+//   names        NameOff u64[count+1]  NameBytes char[]
+//   blocks       BlockOff              Kinds u8[] (TopoLineCompact kind codes), BParams i32[]
+//   side links   SideOff               SideParams i32[]
+//   instantons   InstOff               InstParams i32[]
+//   externals    ExtOff                ExtParams i32[]
+//   l/s/i conn   LOff / SOff / IOff    LConn / SConn / IConn i32[2] per edge (u, v)
+//   e conn       EOff                  EConn i32[4] per edge (parent_id, parent_type, port_idx, external_id)
+//
+// The file is written in one go (temp file + rename) and is read-only afterwards;
+// readers map it and reach any field of any record in O(1) without parsing.
+
+class TopoColumnar {
+public:
+    static constexpr char     kMagic[4]   = {'T','C','L','1'};
+    static constexpr uint32_t kVersion    = 1;
+
+    enum Section : uint32_t {
+        NameOff, NameBytes,
+        BlockOff, Kinds, BParams,
+        SideOff, SideParams,
+        InstOff, InstParams,
+        ExtOff, ExtParams,
+        LOff, LConn,
+        SOff, SConn,
+        IOff, IConn,
+        EOff, EConn,
+        kSections
+    };
+
+    static constexpr size_t kHeaderSize = 16 + 16 * kSections;
+
+    // True if the file starts with the .tcol magic
+    static bool isColumnarFile(const std::string& path);
+};
+
+// Collects records in memory, then writes the whole file
+class TopoColumnarWriter {
+public:
+    TopoColumnarWriter();
+
+    void add(const Topology_enhanced& T);
+    size_t size() const { return names_off_.size() - 1; }
+
+    // Atomic: temp file + rename
+    bool write(const std::string& path) const;
+
+private:
+    std::vector<uint64_t> names_off_, block_off_, side_off_, inst_off_, ext_off_;
+    std::vector<uint64_t> l_off_, s_off_, i_off_, e_off_;
+    std::string names_;
+    std::vector<uint8_t> kinds_;
+    std::vector<int32_t> bparams_, sparams_, iparams_, eparams_;
+    std::vector<int32_t> lconn_, sconn_, iconn_, econn_;
+};
+
+// Read-only, memory-mapped view with O(1) access by record number.
+class TopoColumnarReader {
+public:
+    TopoColumnarReader() = default;
+    ~TopoColumnarReader();
+    TopoColumnarReader(const TopoColumnarReader&) = delete;
+    TopoColumnarReader& operator=(const TopoColumnarReader&) = delete;
+
+    // Validates the header and every offset column; false on any inconsistency
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return count_; }
+
+    // Materialize record i into out (refilled, capacity kept)
+    bool get(size_t i, Topology_enhanced& out) const;
+
+    // Column access for scans and filters that do not need a full topology
+    std::string_view name(size_t i) const;
+    size_t blockCount(size_t i) const     { return span(BlockOffCol, i); }
+    size_t sideLinkCount(size_t i) const  { return span(SideOffCol, i); }
+    size_t instantonCount(size_t i) const { return span(InstOffCol, i); }
+    size_t externalCount(size_t i) const  { return span(ExtOffCol, i); }
+    size_t eConnCount(size_t i) const     { return span(EOffCol, i); }
+    const uint8_t* kinds(size_t i) const;         // blockCount(i) kind codes
+    const int32_t* blockParams(size_t i) const;   // blockCount(i) params
+    const int32_t* externalParams(size_t i) const;
+    const int32_t* eConn(size_t i) const;         // eConnCount(i) x 4 ints
+
+private:
+    // Indices into off_ for the offset columns
+    enum OffCol { NameOffCol, BlockOffCol, SideOffCol, InstOffCol, ExtOffCol,
+                  LOffCol, SOffCol, IOffCol, EOffCol, kOffCols };
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t count_ = 0;
+    const uint64_t* off_[kOffCols] = {};
+    const char*    names_ = nullptr;
+    const uint8_t* kinds_ = nullptr;
+    const int32_t* bparams_ = nullptr;
+    const int32_t* sparams_ = nullptr;
+    const int32_t* iparams_ = nullptr;
+    const int32_t* eparams_ = nullptr;
+    const int32_t* lconn_ = nullptr;
+    const int32_t* sconn_ = nullptr;
+    const int32_t* iconn_ = nullptr;
+    const int32_t* econn_ = nullptr;
+
+    size_t span(OffCol c, size_t i) const {
+        return i < count_ ? (size_t)(off_[c][i + 1] - off_[c][i]) : 0;
+    }
+};
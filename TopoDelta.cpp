@@ -0,0 +1,195 @@
+#include "TopoDelta.hpp"
+#include "TopoLineCompact_enhanced.hpp"
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// ===== Varints =====
+static inline void put_varint(std::string& b, uint64_t v) {
+    while (v >= 0x80) {
+        b.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    b.push_back(static_cast<char>(v));
+}
+
+// Zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static constexpr uint64_t zigzag(int v) {
+    return (static_cast<uint64_t>(static_cast<int64_t>(v)) << 1) ^
+           static_cast<uint64_t>(static_cast<int64_t>(v) >> 63);
+}
+
+static constexpr int64_t unzigzag(uint64_t u) {
+    return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+}
+
+static_assert(zigzag(0) == 0 && zigzag(-1) == 1 && zigzag(1) == 2 && zigzag(-3) == 5, "zigzag");
+static_assert(unzigzag(zigzag(-3)) == -3 && unzigzag(zigzag(INT_MIN)) == INT_MIN &&
+              unzigzag(zigzag(INT_MAX)) == INT_MAX, "zigzag round trip");
+
+static inline void put_int(std::string& b, int v) {
+    put_varint(b, zigzag(v));
+}
+
+static inline bool get_varint(std::string_view d, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < d.size(); shift += 7) {
+        const uint8_t c = static_cast<uint8_t>(d[pos++]);
+        v |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline bool get_int(std::string_view d, size_t& pos, int& v) {
+    uint64_t u;
+    if (!get_varint(d, pos, u)) return false;
+    const int64_t s = unzigzag(u);
+    if (s < INT_MIN || s > INT_MAX) return false;
+    v = static_cast<int>(s);
+    return true;
+}
+
+// ===== Files =====
+bool TopoDelta::isDelta(std::string_view data) {
+    return data.size() >= kHeaderSize && std::memcmp(data.data(), kMagic, 4) == 0;
+}
+
+bool TopoDelta::isDeltaFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char h[kHeaderSize];
+    return in.read(h, kHeaderSize) && isDelta(std::string_view(h, kHeaderSize));
+}
+
+bool TopoDelta::appendToFile(const std::string& path, std::string_view groups) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    const bool fresh = ec || size == 0;
+    if (!fresh && !isDeltaFile(path)) return false;
+
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (!out) return false;
+    if (fresh) {
+        std::string h(kMagic, 4);
+        for (int k = 0; k < 4; ++k) h.push_back(static_cast<char>((kVersion >> (8 * k)) & 0xff));
+        out.write(h.data(), (std::streamsize)h.size());
+    }
+    out.write(groups.data(), (std::streamsize)groups.size());
+    return out.good();
+}
+
+// ===== Decoding =====
+bool TopoDelta::readGroup(std::string_view data, size_t pos, Group& g) {
+    uint64_t bytes, base_len;
+    if (!get_varint(data, pos, bytes) || bytes > data.size() - pos) return false;
+    const std::string_view group = data.substr(pos, (size_t)bytes);
+    g.end = pos + (size_t)bytes;
+
+    size_t p = 0;
+    if (!get_varint(group, p, g.variants) || !get_varint(group, p, base_len) || base_len > group.size() - p)
+        return false;
+    g.base = group.substr(p, (size_t)base_len);
+    g.body = group.substr(p + (size_t)base_len);
+    return true;
+}
+
+bool TopoDelta::applyVariant(std::string_view body, size_t& pos, Topology_enhanced& T, uint32_t fields) {
+    uint64_t head;
+    if (!get_varint(body, pos, head) || (head >> 1) > body.size() - pos) return false;
+    const size_t n = (size_t)(head >> 1);
+    const bool conns = fields & TopoLineCompact_enhanced::EConn;
+    const bool params = fields & TopoLineCompact_enhanced::EParams;
+    T.externals.clear();
+    T.e_connection.clear();
+
+    int parent, type, port, v;
+    if (!(head & 1)) {
+        for (size_t k = 0; k < n; ++k) {
+            if (!get_int(body, pos, parent) || !get_int(body, pos, type) || !get_int(body, pos, port)
+                || !get_int(body, pos, v))
+                return false;
+            if (conns) T.e_connection.push_back({parent, type, port, (int)k});
+            if (params) T.externals.push_back(External{v});
+        }
+        return true;
+    }
+
+    for (size_t k = 0; k < n; ++k) {
+        if (!get_int(body, pos, v)) return false;
+        if (params) T.externals.push_back(External{v});
+    }
+    uint64_t c;
+    if (!get_varint(body, pos, c) || c > body.size() - pos) return false;
+    for (uint64_t k = 0; k < c; ++k) {
+        int eid;
+        if (!get_int(body, pos, parent) || !get_int(body, pos, type) || !get_int(body, pos, port)
+            || !get_int(body, pos, eid))
+            return false;
+        if (conns) T.e_connection.push_back({parent, type, port, eid});
+    }
+    return true;
+}
+
+// ===== Encoder =====
+void TopoDeltaEncoder::add(const Topology_enhanced& T) {
+    add(TopologyOverlay(T));
+}
+
+void TopoDeltaEncoder::add(const TopologyOverlay& T) {
+    // The base is the line up to the E= field
+    const Topology_enhanced& B = T.base();
+    line_.clear();
+    TopoLineCompact_enhanced::serializeInto(line_, B);
+    if (!B.externals.empty() || !B.e_connection.empty()) line_.resize(line_.rfind(" | E="));
+    if (variants_ && line_ != base_) closeGroup();
+    if (!variants_) base_.swap(line_);
+
+    const size_t n = T.externalCount(), c = T.eConnectionCount();
+    bool general = c != n;
+    for (size_t k = 0; k < c && !general; ++k)
+        general = T.eConnection(k).external_id != (int)k;
+
+    put_varint(body_, (uint64_t)n << 1 | (general ? 1 : 0));
+    if (!general) {
+        for (size_t k = 0; k < n; ++k) {
+            const auto& e = T.eConnection(k);
+            put_int(body_, e.parent_id);
+            put_int(body_, e.parent_type);
+            put_int(body_, e.port_idx);
+            put_int(body_, T.external(k).param);
+        }
+    } else {
+        for (size_t k = 0; k < n; ++k) put_int(body_, T.external(k).param);
+        put_varint(body_, c);
+        for (size_t k = 0; k < c; ++k) {
+            const auto& e = T.eConnection(k);
+            put_int(body_, e.parent_id);
+            put_int(body_, e.parent_type);
+            put_int(body_, e.port_idx);
+            put_int(body_, e.external_id);
+        }
+    }
+    ++variants_;
+    ++records_;
+}
+
+void TopoDeltaEncoder::closeGroup() {
+    if (!variants_) return;
+    std::string head;
+    put_varint(head, variants_);
+    put_varint(head, base_.size());
+    put_varint(done_, head.size() + base_.size() + body_.size());
+    done_ += head;
+    done_ += base_;
+    done_ += body_;
+    base_.clear();
+    body_.clear();
+    variants_ = 0;
+}
+
+void TopoDeltaEncoder::drain(std::string& out, bool flush) {
+    if (flush) closeGroup();
+    out += done_;
+    done_.clear();
+}
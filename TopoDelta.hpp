@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Topology_enhanced.h"
+#include "TopologyOverlay.hpp"
+
+// Base+delta encoding of generated external variants (.txd files): every base topology is
+// stored once as a line-compact line, followed by only the externals of each variant
+//
+//   "TDL1" | u32 version, then groups, each self-contained:
+//     varint group_bytes            bytes of the group after this varint
+//     varint variants
+//     varint base_len | base        line-compact line without E= / ep=
+//     variants x {
+//       varint n << 1 | general
+//       general = 0:  n x {parent_id, parent_type, port_idx, param}       external k is attached
+//                                                                          by connection k only
+//       general = 1:  n x {param}, varint c, c x {parent_id, parent_type, port_idx, external_id}
+//     }
+//
+// Numbers are LEB128 varints, zigzag-encoded inside variants, so a typical variant with
+// one external takes 5 bytes instead of a full line. A variant with no externals is the
+// base itself. Variants are records in file order, and expanding a file gives back the
+// line-compact lines of its records (names are not stored). Groups can be appended to an
+// existing file, and are where LineIngest cuts a file into chunks.
+
+class TopoDelta {
+public:
+    static constexpr char     kMagic[4]   = {'T','D','L','1'};
+    static constexpr uint32_t kVersion    = 1;
+    static constexpr size_t   kHeaderSize = 8;
+
+    static bool isDelta(std::string_view data);
+    static bool isDeltaFile(const std::string& path);
+
+    // Appends encoded groups to path, writing the header if the file is new or empty;
+    // false if it exists and is not a delta file
+    static bool appendToFile(const std::string& path, std::string_view groups);
+
+    struct Group {
+        uint64_t variants = 0;
+        std::string_view base;   // line-compact, no externals
+        std::string_view body;   // the encoded variants
+        size_t end = 0;          // offset just past the group
+    };
+    // Group starting at data[pos]; false at the end of data or if it is malformed
+    static bool readGroup(std::string_view data, size_t pos, Group& g);
+
+    // Decodes the variant at body[pos] onto T, which holds the base (externals empty),
+    // and advances pos. Externals are only decoded if fields asks for EConn / EParams
+    // (TopoLineCompact_enhanced::Field). False if the variant is malformed.
+    static bool applyVariant(std::string_view body, size_t& pos, Topology_enhanced& T, uint32_t fields);
+};
+
+// Encodes records into groups: consecutive records with the same base (everything but
+// the externals) share a group
+class TopoDeltaEncoder {
+public:
+    void add(const Topology_enhanced& T);
+    void add(const TopologyOverlay& T);   // the base's line up to E=, then the overlay's externals
+
+    // Moves the completed groups to the end of out; flush also closes the open group
+    void drain(std::string& out, bool flush);
+    size_t bufferedBytes() const { return done_.size() + base_.size() + body_.size(); }
+    uint64_t records() const { return records_; }
+
+private:
+    std::string done_;          // complete groups
+    std::string base_, body_;   // open group
+    std::string line_;          // scratch
+    uint64_t variants_ = 0, records_ = 0;
+
+    void closeGroup();
+};
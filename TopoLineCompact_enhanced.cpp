@@ -1,5 +1,7 @@
 #include "TopoLineCompact_enhanced.hpp"
 #include <algorithm>
+#include <charconv>
+#include <initializer_list>
 #include <stdexcept>
 
 // ===== Helper functions =====
@@ -25,283 +27,337 @@ LKind TopoLineCompact_enhanced::intToKind(int k) {
     return LKind::g;
 }
 
-void TopoLineCompact_enhanced::trim(std::string& s) {
+const char* TopoLineCompact_enhanced::errorString(ParseError e) {
+    switch (e) {
+        case ParseError::None:             return "ok";
+        case ParseError::TooFewFields:     return "fewer than 6 fields";
+        case ParseError::BadNumber:        return "bad number";
+        case ParseError::NumberOutOfRange: return "number out of range";
+        case ParseError::CountMismatch:    return "kinds/bparams count mismatch";
+        case ParseError::BadDelta:         return "malformed delta record";
+        case ParseError::BadBlock:         return "corrupt compressed block";
+    }
+    return "unknown error";
+}
+
+// ===== In-place tokenizing (string_view over the input line) =====
+namespace {
+
+using ParseError  = TopoLineCompact_enhanced::ParseError;
+using ParseStatus = TopoLineCompact_enhanced::ParseStatus;
+
+inline std::string_view trim_sv(std::string_view s) {
     size_t a = 0, b = s.size();
     while (a < b && std::isspace((unsigned char)s[a])) ++a;
     while (b > a && std::isspace((unsigned char)s[b-1])) --b;
-    s = s.substr(a, b - a);
+    return s.substr(a, b - a);
 }
 
-std::vector<std::string> TopoLineCompact_enhanced::split(const std::string& s, char sep) {
-    std::vector<std::string> out;
-    std::string cur;
-    for (char c : s) {
-        if (c == sep) {
-            out.push_back(cur);
-            cur.clear();
-        } else {
-            cur.push_back(c);
-        }
+// Calls f(token) for every sep-separated token (empty tokens included)
+template <class F>
+inline bool for_each_token(std::string_view s, char sep, F&& f) {
+    for (;;) {
+        const size_t k = s.find(sep);
+        if (!f(s.substr(0, k))) return false;
+        if (k == std::string_view::npos) return true;
+        s.remove_prefix(k + 1);
     }
-    out.push_back(cur);
-    return out;
 }
 
-std::vector<int> TopoLineCompact_enhanced::parse_csv_ints(const std::string& s) {
-    std::vector<int> v;
-    if (s.empty()) return v;
-    for (auto& t : split(s, ',')) {
-        std::string u = t;
-        trim(u);
-        if (!u.empty()) v.push_back(std::stoi(u));
+struct NumberReader {
+    const char* base;   // start of the line, for error positions
+    ParseStatus& st;
+
+    bool operator()(std::string_view tok, int& v) {
+        tok = trim_sv(tok);
+        const char* end = tok.data() + tok.size();
+        auto r = std::from_chars(tok.data(), end, v);
+        if (r.ec == std::errc::result_out_of_range) return fail(ParseError::NumberOutOfRange, tok.data());
+        if (r.ec != std::errc() || r.ptr != end)    return fail(ParseError::BadNumber, tok.data());
+        return true;
     }
-    return v;
+    bool fail(ParseError e, const char* at) {
+        st.code = e;
+        st.pos = static_cast<size_t>(at - base);
+        return false;
+    }
+};
+
+// "a,b,c": empty entries are skipped
+template <class F>
+inline bool read_csv(std::string_view s, NumberReader& num, F&& f) {
+    if (s.empty()) return true;
+    return for_each_token(s, ',', [&](std::string_view t) {
+        if (trim_sv(t).empty()) return true;
+        int v;
+        if (!num(t, v)) return false;
+        f(v);
+        return true;
+    });
 }
 
-std::vector<std::pair<int,int>> TopoLineCompact_enhanced::parse_pairs(const std::string& s) {
-    // "(u,v);(u,v)" format
-    std::vector<std::pair<int,int>> v;
-    if (s.empty()) return v;
-    
-    for (auto& t : split(s, ';')) {
-        std::string u = t;
-        trim(u);
-        if (u.empty()) continue;
-        
-        // Remove parentheses
-        if (u.front() == '(' && u.back() == ')') {
-            u = u.substr(1, u.size() - 2);
-        }
-        
-        auto xy = split(u, ',');
-        if (xy.size() != 2) continue;
-        
-        v.emplace_back(std::stoi(xy[0]), std::stoi(xy[1]));
+// "(a,b,..);(a,b,..)": tuples of another arity are skipped
+template <size_t N, class F>
+inline bool read_tuples(std::string_view s, NumberReader& num, F&& f) {
+    if (s.empty()) return true;
+    return for_each_token(s, ';', [&](std::string_view t) {
+        t = trim_sv(t);
+        if (t.empty()) return true;
+        if (t.front() == '(' && t.back() == ')') t = t.substr(1, t.size() - 2);
+
+        std::string_view fields[N];
+        size_t n = 0;
+        for_each_token(t, ',', [&](std::string_view x) {
+            if (n < N) fields[n] = x;
+            ++n;
+            return true;
+        });
+        if (n != N) return true;
+
+        int v[N];
+        for (size_t i = 0; i < N; ++i)
+            if (!num(fields[i], v[i])) return false;
+        f(v);
+        return true;
+    });
+}
+
+} // namespace
+
+// ===== Serialization =====
+namespace {
+
+inline void put_int(std::string& buf, int v) {
+    char tmp[12];
+    auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    buf.append(tmp, r.ptr);
+}
+
+// "a,b,c" of get(x) over xs
+template <class V, class G>
+inline void put_csv(std::string& buf, const V& xs, G&& get) {
+    for (size_t i = 0; i < xs.size(); ++i) {
+        if (i) buf.push_back(',');
+        put_int(buf, get(xs[i]));
     }
-    return v;
 }
 
-std::vector<std::tuple<int,int,int,int>> TopoLineCompact_enhanced::parse_quads(const std::string& s) {
-    // "(a,b,c,d);(a,b,c,d)" format for External connections
-    std::vector<std::tuple<int,int,int,int>> v;
-    if (s.empty()) return v;
-    
-    for (auto& t : split(s, ';')) {
-        std::string u = t;
-        trim(u);
-        if (u.empty()) continue;
-        
-        // Remove parentheses
-        if (u.front() == '(' && u.back() == ')') {
-            u = u.substr(1, u.size() - 2);
-        }
-        
-        auto parts = split(u, ',');
-        if (parts.size() != 4) continue;
-        
-        v.emplace_back(
-            std::stoi(parts[0]),  // parent_id
-            std::stoi(parts[1]),  // parent_type
-            std::stoi(parts[2]),  // port_idx
-            std::stoi(parts[3])   // external_id
-        );
+inline void put_tuple(std::string& buf, std::initializer_list<int> vs) {
+    buf.push_back('(');
+    bool first = true;
+    for (int v : vs) {
+        if (!first) buf.push_back(',');
+        put_int(buf, v);
+        first = false;
     }
-    return v;
+    buf.push_back(')');
 }
 
-// ===== Serialization =====
-std::string TopoLineCompact_enhanced::serialize(const Topology_enhanced& T) {
-    // Build kinds and bparams
-    std::ostringstream kinds, bparams;
-    for (size_t i = 0; i < T.block.size(); ++i) {
-        if (i) { 
-            kinds << ","; 
-            bparams << ","; 
-        }
-        kinds << kindToInt(T.block[i].kind);
-        bparams << T.block[i].param;
+// " | E=... | ep=..." over conn(i) for i < nconn and ext(i) for i < next; nothing if
+// there is neither
+template <class ConnAt, class ExtAt>
+inline void put_externals(std::string& buf, size_t nconn, ConnAt&& conn, size_t next, ExtAt&& ext) {
+    if (nconn == 0 && next == 0) return;
+    buf += " | E=";
+    for (size_t i = 0; i < nconn; ++i) {
+        if (i) buf.push_back(';');
+        const ExternalStructure& e = conn(i);
+        put_tuple(buf, {e.parent_id, e.parent_type, e.port_idx, e.external_id});
     }
-    
-    // S/I connections
-    std::ostringstream Sc, Ic;
+    buf += " | ep=";
+    for (size_t i = 0; i < next; ++i) {
+        if (i) buf.push_back(',');
+        put_int(buf, ext(i).param);
+    }
+}
+
+} // namespace
+
+void TopoLineCompact_enhanced::serializeInto(std::string& buf, const Topology_enhanced& T) {
+    serializeLinksInto(buf, T);
+    put_externals(buf, T.e_connection.size(), [&](size_t i) -> const ExternalStructure& { return T.e_connection[i]; },
+                  T.externals.size(), [&](size_t i) -> const External& { return T.externals[i]; });
+}
+
+void TopoLineCompact_enhanced::serializeInto(std::string& buf, const TopologyOverlay& T) {
+    serializeLinksInto(buf, T.base());
+    put_externals(buf, T.eConnectionCount(), [&](size_t i) -> const ExternalStructure& { return T.eConnection(i); },
+                  T.externalCount(), [&](size_t i) -> const External& { return T.external(i); });
+}
+
+void TopoLineCompact_enhanced::serializeLinksInto(std::string& buf, const Topology_enhanced& T) {
+    put_csv(buf, T.block, [](const Block& b) { return kindToInt(b.kind); });
+    buf += " | ";
+    put_csv(buf, T.block, [](const Block& b) { return b.param; });
+
+    buf += " | S=";
     for (size_t i = 0; i < T.s_connection.size(); ++i) {
-        if (i) Sc << ";";
-        Sc << "(" << T.s_connection[i].u << "," << T.s_connection[i].v << ")";
+        if (i) buf.push_back(';');
+        put_tuple(buf, {T.s_connection[i].u, T.s_connection[i].v});
     }
+    buf += " | I=";
     for (size_t i = 0; i < T.i_connection.size(); ++i) {
-        if (i) Ic << ";";
-        Ic << "(" << T.i_connection[i].u << "," << T.i_connection[i].v << ")";
-    }
-    
-    // S/I parameters
-    std::ostringstream Sp, Ip;
-    for (size_t i = 0; i < T.side_links.size(); ++i) {
-        if (i) Sp << ",";
-        Sp << T.side_links[i].param;
-    }
-    for (size_t i = 0; i < T.instantons.size(); ++i) {
-        if (i) Ip << ",";
-        Ip << T.instantons[i].param;
-    }
-    
-    // Enhanced: External connections and parameters
-    std::ostringstream Ec, Ep;
-    for (size_t i = 0; i < T.e_connection.size(); ++i) {
-        if (i) Ec << ";";
-        const auto& e = T.e_connection[i];
-        Ec << "(" << e.parent_id << "," << e.parent_type << "," 
-           << e.port_idx << "," << e.external_id << ")";
-    }
-    for (size_t i = 0; i < T.externals.size(); ++i) {
-        if (i) Ep << ",";
-        Ep << T.externals[i].param;
-    }
-    
-    // Build final output
-    std::ostringstream out;
-    out << kinds.str() << " | "
-        << bparams.str() << " | "
-        << "S=" << Sc.str() << " | "
-        << "I=" << Ic.str() << " | "
-        << "sp=" << Sp.str() << " | "
-        << "ip=" << Ip.str();
-    
-    // Only add External fields if there are externals
-    if (!T.externals.empty() || !T.e_connection.empty()) {
-        out << " | E=" << Ec.str() << " | ep=" << Ep.str();
+        if (i) buf.push_back(';');
+        put_tuple(buf, {T.i_connection[i].u, T.i_connection[i].v});
     }
-    
-    return out.str();
+
+    buf += " | sp=";
+    put_csv(buf, T.side_links, [](const SideLinks& s) { return s.param; });
+    buf += " | ip=";
+    put_csv(buf, T.instantons, [](const Instantons& s) { return s.param; });
+}
+
+std::string TopoLineCompact_enhanced::serialize(const Topology_enhanced& T) {
+    std::string out;
+    out.reserve(64 + 8 * (T.block.size() + T.s_connection.size() + T.i_connection.size()));
+    serializeInto(out, T);
+    return out;
+}
+
+std::string TopoLineCompact_enhanced::serialize(const TopologyOverlay& T) {
+    const Topology_enhanced& B = T.base();
+    std::string out;
+    out.reserve(64 + 8 * (B.block.size() + B.s_connection.size() + B.i_connection.size()));
+    serializeInto(out, T);
+    return out;
 }
 
 // ===== Deserialization =====
-bool TopoLineCompact_enhanced::deserialize(const std::string& line, Topology_enhanced& out) {
-    auto parts = split(line, '|');
-    if (parts.size() < 6) return false;  // Minimum required fields
-    
-    for (auto& p : parts) trim(p);
+TopoLineCompact_enhanced::ParseStatus
+TopoLineCompact_enhanced::parse(std::string_view line, Topology_enhanced& out, uint32_t fields) {
+    ParseStatus st;
+    NumberReader num{line.data(), st};
 
-    // Parse kinds and params
-    auto kinds_csv = parts[0];
-    auto bparams_csv = parts[1];
-    auto kinds_vec = parse_csv_ints(kinds_csv);
-    auto bparams_vec = parse_csv_ints(bparams_csv);
-    
-    if (kinds_vec.size() != bparams_vec.size()) return false;
+    // Fields: kinds, bparams, then the first field starting with each tag
+    enum { F_S, F_I, F_SP, F_IP, F_E, F_EP, F_COUNT };
+    static constexpr std::string_view tags[F_COUNT] = {"S=", "I=", "sp=", "ip=", "E=", "ep="};
+    static constexpr uint32_t masks[F_COUNT] = {SConn, IConn, SParams, IParams, EConn, EParams};
+    std::string_view kinds_csv, bparams_csv, tagged[F_COUNT];
+    bool found[F_COUNT] = {};
+    for (int f = 0; f < F_COUNT; ++f) found[f] = !(fields & masks[f]);   // unwanted: never matched
+    size_t nparts = 0;
 
-    // Initialize topology
-    out.Initialize();
-    for (size_t i = 0; i < kinds_vec.size(); ++i) {
-        const LKind k = intToKind(kinds_vec[i]);
-        // Chain assumption: connect to the right
-        if (i == 0) {
-            out.addBlock(k, bparams_vec[i]);
-        } else {
-            out.addBlockRight(k, bparams_vec[i]);
+    for_each_token(line, '|', [&](std::string_view part) {
+        if (nparts == 0)      kinds_csv = trim_sv(part);
+        else if (nparts == 1) bparams_csv = trim_sv(part);
+        else {
+            part = trim_sv(part);
+            for (int f = 0; f < F_COUNT; ++f) {
+                if (!found[f] && part.substr(0, tags[f].size()) == tags[f]) {
+                    tagged[f] = trim_sv(part.substr(tags[f].size()));
+                    found[f] = true;
+                    break;
+                }
+            }
         }
+        ++nparts;
+        return true;
+    });
+    if (nparts < 6) {  // Minimum required fields
+        st.code = ParseError::TooFewFields;
+        st.pos = line.size();
+        return st;
     }
 
-    // Helper lambda to read fields
-    auto rd = [&](const std::string& tag) -> std::string {
-        for (size_t i = 2; i < parts.size(); ++i) {
-            auto s = parts[i];
-            if (s.rfind(tag, 0) == 0) {
-                auto t = s.substr(tag.size());
-                trim(t);
-                return t;
-            }
-        }
-        return std::string();
+    // Initialize topology (clear() keeps every vector's capacity)
+    out.Initialize();
+
+    // Kinds, then params in the same order; chain assumption: connect to the right
+    auto add_block = [&](LKind k) {
+        const int id = static_cast<int>(out.block.size());
+        out.block.push_back(Block{k, 0});
+        if (id > 0) out.l_connection.push_back(InteriorStructure{id - 1, id});
     };
+    if ((fields & Kinds) &&
+        !read_csv(kinds_csv, num, [&](int k) { add_block(intToKind(k)); })) return st;
 
-    // Parse connections and parameters
-    const std::string Sraw = rd("S=");
-    const std::string Iraw = rd("I=");
-    const std::string SPar = rd("sp=");
-    const std::string IPar = rd("ip=");
-    const std::string Eraw = rd("E=");   // Enhanced: External connections
-    const std::string EPar = rd("ep=");   // Enhanced: External parameters
-
-    // Parse parameters first
-    auto sp = parse_csv_ints(SPar);
-    auto ip = parse_csv_ints(IPar);
-    auto ep = parse_csv_ints(EPar);  // Enhanced
-    
-    // Add side links and instantons
-    for (int v : sp) out.addSideLink(v);
-    for (int v : ip) out.addInstanton(v);
-    for (int v : ep) out.addExternal(v);  // Enhanced
-    
-    // Parse connections
-    std::vector<SideLinkStructure> s_conn;
-    for (auto [u, sid] : parse_pairs(Sraw)) {
-        s_conn.push_back({u, sid});
-    }
-    out.LinkingSideLinks(std::move(s_conn));
-    
-    std::vector<InstantonStructure> i_conn;
-    for (auto [u, iid] : parse_pairs(Iraw)) {
-        i_conn.push_back({u, iid});
-    }
-    out.LinkingInstantonStructure(std::move(i_conn));
-    
-    // Enhanced: Parse external connections
-    if (!Eraw.empty()) {
-        std::vector<ExternalStructure> e_conn;
-        for (auto [parent_id, parent_type, port_idx, eid] : parse_quads(Eraw)) {
-            e_conn.push_back({parent_id, parent_type, port_idx, eid});
+    if (fields & BParams) {
+        const bool have_blocks = (fields & Kinds) != 0;
+        size_t nparams = 0;
+        if (!read_csv(bparams_csv, num, [&](int p) {
+                if (!have_blocks) add_block(LKind::g);
+                if (nparams < out.block.size()) out.block[nparams].param = p;
+                ++nparams;
+            })) return st;
+        if (nparams != out.block.size()) {
+            st.code = ParseError::CountMismatch;
+            st.pos = static_cast<size_t>(bparams_csv.data() - line.data());
+            return st;
         }
-        out.LinkingExternals(std::move(e_conn));
     }
-    
-    return true;
+
+    // Parameters (unrequested sections are empty views)
+    if (!read_csv(tagged[F_SP], num, [&](int v) { out.side_links.push_back(SideLinks{v}); })) return st;
+    if (!read_csv(tagged[F_IP], num, [&](int v) { out.instantons.push_back(Instantons{v}); })) return st;
+    if (!read_csv(tagged[F_EP], num, [&](int v) { out.externals.push_back(External{v}); })) return st;
+
+    // Connections
+    if (!read_tuples<2>(tagged[F_S], num, [&](const int* v) {
+            out.s_connection.push_back(SideLinkStructure{v[0], v[1]});
+        })) return st;
+    if (!read_tuples<2>(tagged[F_I], num, [&](const int* v) {
+            out.i_connection.push_back(InstantonStructure{v[0], v[1]});
+        })) return st;
+    // (parent_id, parent_type, port_idx, external_id)
+    if (!read_tuples<4>(tagged[F_E], num, [&](const int* v) {
+            out.e_connection.push_back(ExternalStructure{v[0], v[1], v[2], v[3]});
+        })) return st;
+
+    return st;
 }
 
 // ===== Validation =====
-bool TopoLineCompact_enhanced::validate(const Topology_enhanced& T) {
-    // Validate all connections reference valid objects
-    
-    // Check S-connections
+namespace {
+
+// S- and I-connections reference existing objects
+bool valid_links(const Topology_enhanced& T) {
     for (const auto& sc : T.s_connection) {
         if (sc.u < 0 || sc.u >= static_cast<int>(T.block.size())) return false;
         if (sc.v < 0 || sc.v >= static_cast<int>(T.side_links.size())) return false;
     }
-    
-    // Check I-connections
     for (const auto& ic : T.i_connection) {
         if (ic.u < 0 || ic.u >= static_cast<int>(T.block.size())) return false;
         if (ic.v < 0 || ic.v >= static_cast<int>(T.instantons.size())) return false;
     }
+    return true;
+}
+
+// An E-connection of T, which has n_externals externals
+bool valid_e_connection(const ExternalStructure& ec, const Topology_enhanced& T, size_t n_externals) {
+    // Check external exists
+    if (ec.external_id < 0 || ec.external_id >= static_cast<int>(n_externals)) {
+        return false;
+    }
     
-    // Check E-connections (Enhanced)
-    for (const auto& ec : T.e_connection) {
-        // Check external exists
-        if (ec.external_id < 0 || ec.external_id >= static_cast<int>(T.externals.size())) {
+    // Check parent exists based on type
+    switch (ec.parent_type) {
+        case 0:  // Block
+            return ec.parent_id >= 0 && ec.parent_id < static_cast<int>(T.block.size());
+        case 1:  // SideLink
+            return ec.parent_id >= 0 && ec.parent_id < static_cast<int>(T.side_links.size());
+        case 2:  // Instanton
+            return ec.parent_id >= 0 && ec.parent_id < static_cast<int>(T.instantons.size());
+        default:
             return false;
-        }
-        
-        // Check parent exists based on type
-        switch (ec.parent_type) {
-            case 0:  // Block
-                if (ec.parent_id < 0 || ec.parent_id >= static_cast<int>(T.block.size())) {
-                    return false;
-                }
-                break;
-            case 1:  // SideLink
-                if (ec.parent_id < 0 || ec.parent_id >= static_cast<int>(T.side_links.size())) {
-                    return false;
-                }
-                break;
-            case 2:  // Instanton
-                if (ec.parent_id < 0 || ec.parent_id >= static_cast<int>(T.instantons.size())) {
-                    return false;
-                }
-                break;
-            default:
-                return false;
-        }
     }
-    
+}
+
+} // namespace
+
+bool TopoLineCompact_enhanced::validate(const Topology_enhanced& T) {
+    // Validate all connections reference valid objects
+    if (!valid_links(T)) return false;
+    for (const auto& ec : T.e_connection) {
+        if (!valid_e_connection(ec, T, T.externals.size())) return false;
+    }
+    return true;
+}
+
+bool TopoLineCompact_enhanced::validate(const TopologyOverlay& T) {
+    if (!valid_links(T.base())) return false;
+    for (size_t i = 0; i < T.eConnectionCount(); ++i) {
+        if (!valid_e_connection(T.eConnection(i), T.base(), T.externalCount())) return false;
+    }
     return true;
 }
 
@@ -357,3 +413,7 @@ std::string TopoLineCompact_enhanced::getValidationErrors(const Topology_enhance
     
     return errors.str();
 }
+
+std::string TopoLineCompact_enhanced::getValidationErrors(const TopologyOverlay& T) {
+    return getValidationErrors(T.materialize());
+}
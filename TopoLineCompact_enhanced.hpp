@@ -1,6 +1,9 @@
 #pragma once
 #include "Topology_enhanced.h"
+#include "TopologyOverlay.hpp"
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <vector>
 #include <sstream>
 #include <cctype>
@@ -18,20 +21,71 @@
 
 class TopoLineCompact_enhanced {
 public:
+    // Parse failures, reported with the byte offset in the line where they occurred
+    enum class ParseError : uint8_t {
+        None = 0,
+        TooFewFields,       // fewer than 6 '|' separated fields
+        BadNumber,          // token is not an integer
+        NumberOutOfRange,   // integer does not fit in int
+        CountMismatch,      // kinds and bparams have different lengths
+        BadDelta,           // malformed base+delta record (TopoDelta.hpp)
+        BadBlock,           // .txtz block failing to decompress or its checksum (Txtz.hpp)
+    };
+    struct ParseStatus {
+        ParseError code = ParseError::None;
+        size_t     pos  = 0;
+        explicit operator bool() const { return code == ParseError::None; }
+    };
+    static const char* errorString(ParseError e);
+
+    // Appends the line (no trailing newline) to buf with std::to_chars: no streams,
+    // no locale, no temporaries. serialize() is the same bytes as a fresh string.
+    static void serializeInto(std::string& buf, const Topology_enhanced& T);
     static std::string serialize(const Topology_enhanced& T);
-    static bool deserialize(const std::string& line, Topology_enhanced& out);
+    // The line of the overlay's materialized topology, without materializing it
+    static void serializeInto(std::string& buf, const TopologyOverlay& T);
+    static std::string serialize(const TopologyOverlay& T);
+
+    // Sections of a line, for parsing only what a consumer reads
+    enum Field : uint32_t {
+        Kinds     = 1u << 0,   // block kinds (blocks + linear chain)
+        BParams   = 1u << 1,   // block params
+        SConn     = 1u << 2,   // S=
+        IConn     = 1u << 3,   // I=
+        SParams   = 1u << 4,   // sp=
+        IParams   = 1u << 5,   // ip=
+        EConn     = 1u << 6,   // E=
+        EParams   = 1u << 7,   // ep=
+        AllFields = 0xFFu,
+    };
+
+    // Tokenizes in place (string_view + from_chars) and refills `out`, whose vectors
+    // keep their capacity, so parsing into a reused topology does not allocate.
+    // Malformed S/I/E entries (wrong arity) are skipped as before; a non-numeric token
+    // is an error. On error `out` is left partially filled.
+    //
+    // `fields` selects the sections to decode; the others are only delimited, never
+    // converted, and their vectors stay empty (so errors in them go unnoticed). Blocks
+    // come from kinds if requested (else kind g from bparams); the kinds/bparams count
+    // check needs both.
+    static ParseStatus parse(std::string_view line, Topology_enhanced& out,
+                             uint32_t fields = AllFields);
+    static bool deserialize(std::string_view line, Topology_enhanced& out,
+                            uint32_t fields = AllFields) {
+        return static_cast<bool>(parse(line, out, fields));
+    }
     
     // Validation
     static bool validate(const Topology_enhanced& T);
     static std::string getValidationErrors(const Topology_enhanced& T);
+    static bool validate(const TopologyOverlay& T);
+    static std::string getValidationErrors(const TopologyOverlay& T);
     
 private:
+    // Everything up to the E= field
+    static void serializeLinksInto(std::string& buf, const Topology_enhanced& T);
+
     // Helper functions
     static int kindToInt(LKind k);
     static LKind intToKind(int k);
-    static void trim(std::string& s);
-    static std::vector<std::string> split(const std::string& s, char sep);
-    static std::vector<int> parse_csv_ints(const std::string& s);
-    static std::vector<std::pair<int,int>> parse_pairs(const std::string& s);
-    static std::vector<std::tuple<int,int,int,int>> parse_quads(const std::string& s);
 };
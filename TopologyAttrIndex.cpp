@@ -0,0 +1,354 @@
+#include "TopologyAttrIndex.hpp"
+#include "TopologyDB_enhanced.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===== Header fields =====
+namespace {
+
+constexpr size_t kDbBytes = 8, kDbHead = 16, kCount = 24, kLists = 32;
+constexpr size_t kRowBytes = 32, kListBytes = 32;
+constexpr size_t kHeadBytes = 4096;    // DB prefix covered by db_head
+constexpr uint64_t kDenseRatio = 32;   // dense once n * 32 >= count
+
+inline uint64_t ld64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t ld32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <class T>
+void put(std::string& buf, T v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void pad8(std::string& buf) {
+    buf.resize((buf.size() + 7) & ~size_t(7), '\0');
+}
+
+// FNV-1a of the DB's first bytes; 0 for an empty prefix
+uint64_t head_hash(const std::string& path, uint64_t upto) {
+    std::string head(std::min<uint64_t>(upto, kHeadBytes), '\0');
+    if (head.empty()) return 0;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+    const ssize_t got = pread(fd, &head[0], head.size(), 0);
+    ::close(fd);
+    uint64_t h = 1469598103934665603ULL;
+    for (ssize_t i = 0; i < got; ++i) {
+        h ^= (unsigned char)head[(size_t)i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+// ===== Bitmap =====
+TopologyAttrIndex::Bitmap::Bitmap(size_t n, bool all) : n_(n), w_((n + 63) / 64, all ? ~uint64_t(0) : 0) {
+    if (all && (n & 63)) w_.back() = (uint64_t(1) << (n & 63)) - 1;
+}
+
+size_t TopologyAttrIndex::Bitmap::count() const {
+    size_t c = 0;
+    for (uint64_t w : w_) c += (size_t)__builtin_popcountll(w);
+    return c;
+}
+
+TopologyAttrIndex::Bitmap& TopologyAttrIndex::Bitmap::operator&=(const Bitmap& o) {
+    for (size_t k = 0; k < w_.size(); ++k) w_[k] &= k < o.w_.size() ? o.w_[k] : 0;
+    return *this;
+}
+
+TopologyAttrIndex::Bitmap& TopologyAttrIndex::Bitmap::operator|=(const Bitmap& o) {
+    if (o.n_ > n_) {
+        n_ = o.n_;
+        w_.resize(o.w_.size(), 0);
+    }
+    for (size_t k = 0; k < o.w_.size(); ++k) w_[k] |= o.w_[k];
+    return *this;
+}
+
+TopologyAttrIndex::Bitmap TopologyAttrIndex::Bitmap::operator~() const {
+    Bitmap r(n_, true);
+    for (size_t k = 0; k < w_.size(); ++k) r.w_[k] &= ~w_[k];
+    return r;
+}
+
+// ===== Attributes =====
+void TopologyAttrIndex::keysOf(const Topology_enhanced& T, std::vector<Key>& out) {
+    out.clear();
+    out.push_back(Key{BlockCount, (int32_t)T.block.size(), 0});
+    out.push_back(Key{ExternalCount, (int32_t)T.externals.size(), 0});
+    for (const auto& ec : T.e_connection) out.push_back(Key{ExternalOnPort, ec.parent_type, ec.port_idx});
+    for (const auto& s : T.side_links) out.push_back(Key{SideLinkParam, s.param, 0});
+
+    // Motifs; connections naming a missing component are skipped
+    const int nb = (int)T.block.size(), ns = (int)T.side_links.size(), ni = (int)T.instantons.size();
+    for (const auto& b : T.block) out.push_back(Key{BlockParam, b.param, 0});
+    for (const auto& e : T.l_connection) {
+        if (e.u < 0 || e.u >= nb || e.v < 0 || e.v >= nb) continue;
+        const int p = T.block[e.u].param, q = T.block[e.v].param;
+        out.push_back(Key{BlockPair, std::min(p, q), std::max(p, q)});
+    }
+    for (const auto& e : T.s_connection)
+        if (e.u >= 0 && e.u < nb && e.v >= 0 && e.v < ns)
+            out.push_back(Key{BlockSideLink, T.block[e.u].param, T.side_links[e.v].param});
+    for (const auto& e : T.i_connection)
+        if (e.u >= 0 && e.u < nb && e.v >= 0 && e.v < ni)
+            out.push_back(Key{BlockInstanton, T.block[e.u].param, T.instantons[e.v].param});
+    for (const auto& ec : T.e_connection) {
+        const int id = ec.parent_id;
+        if (ec.parent_type == 0 && id >= 0 && id < nb)
+            out.push_back(Key{ExternalOnBlock, T.block[id].param, ec.port_idx});
+        else if (ec.parent_type == 1 && id >= 0 && id < ns)
+            out.push_back(Key{ExternalOnSideLink, T.side_links[id].param, ec.port_idx});
+        else if (ec.parent_type == 2 && id >= 0 && id < ni)
+            out.push_back(Key{ExternalOnInstanton, T.instantons[id].param, ec.port_idx});
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+TopologyAttrIndex::Row TopologyAttrIndex::rowOf(const Topology_enhanced& T, uint64_t pos) {
+    Row r{pos, (uint32_t)T.block.size(), (uint32_t)T.externals.size(), 0, 0, 0, 0};
+    for (const auto& ec : T.e_connection) {
+        r.max_port = std::max(r.max_port, (int32_t)ec.port_idx);
+        switch (ec.parent_type) {
+            case 0: r.ec_blocks++; break;
+            case 1: r.ec_sidelinks++; break;
+            case 2: r.ec_instantons++; break;
+        }
+    }
+    return r;
+}
+
+// ===== Building =====
+// Whole index in memory; written out in one piece
+struct TopologyAttrIndex::Builder {
+    std::vector<Row> rows;
+    std::map<Key, std::vector<uint32_t>> lists;
+    uint64_t db_bytes = 0;
+
+    void add(const Topology_enhanced& T, uint64_t pos, std::vector<Key>& keys) {
+        const uint32_t id = (uint32_t)rows.size();
+        rows.push_back(rowOf(T, pos));
+        keysOf(T, keys);
+        for (const Key& k : keys) lists[k].push_back(id);
+    }
+};
+
+bool TopologyAttrIndex::scan(Builder& b, uint64_t from) const {
+    TopologyDB_enhanced::Cursor c(db_);
+    if (!c.isOpen()) return false;
+    c.seek(from);
+    TopologyDB_enhanced::Record r;
+    std::vector<Key> keys;
+    while (c.next(r)) b.add(r.topo, c.offset(), keys);
+    b.db_bytes = db_.isColumnar() ? std::filesystem::file_size(db_path_) : c.position();
+    return true;
+}
+
+// Current contents back into a builder, for catching up
+bool TopologyAttrIndex::load(Builder& b) const {
+    const uint64_t n = size();
+    b.rows.resize(n);
+    for (uint64_t i = 0; i < n; ++i) b.rows[i] = row(i);
+    const uint8_t* lists = base_ + kHeaderSize + n * kRowBytes;
+    for (uint64_t l = 0; l < ld64(base_ + kLists); ++l) {
+        const uint8_t* e = lists + l * kListBytes;
+        const Key k{ld32(e), (int32_t)ld32(e + 4), (int32_t)ld32(e + 8)};
+        select((Attr)k.attr, k.a, k.b).forEach([&](size_t i) { b.lists[k].push_back((uint32_t)i); });
+    }
+    b.db_bytes = ld64(base_ + kDbBytes);
+    return true;
+}
+
+bool TopologyAttrIndex::write(const Builder& b) {
+    const uint64_t n = b.rows.size();
+    std::string buf;
+    buf.append(kMagic, 4);
+    put(buf, kVersion);
+    put(buf, b.db_bytes);
+    put(buf, head_hash(db_path_, b.db_bytes));
+    put(buf, n);
+    put(buf, (uint64_t)b.lists.size());
+    put(buf, uint64_t(0));
+
+    for (const Row& r : b.rows) {
+        put(buf, r.pos);
+        put(buf, r.blocks);
+        put(buf, r.externals);
+        put(buf, r.ec_blocks);
+        put(buf, r.ec_sidelinks);
+        put(buf, r.ec_instantons);
+        put(buf, r.max_port);
+    }
+
+    // List table first, data offsets known up front
+    const size_t table = buf.size();
+    buf.resize(table + b.lists.size() * kListBytes);
+    size_t l = 0;
+    for (const auto& [k, ids] : b.lists) {
+        pad8(buf);
+        const bool dense = ids.size() * kDenseRatio >= n;
+        const uint64_t data = buf.size();
+        if (dense) {
+            std::vector<uint64_t> words((n + 63) / 64, 0);
+            for (uint32_t id : ids) words[id >> 6] |= uint64_t(1) << (id & 63);
+            buf.append(reinterpret_cast<const char*>(words.data()), words.size() * 8);
+        } else {
+            buf.append(reinterpret_cast<const char*>(ids.data()), ids.size() * 4);
+        }
+        std::string e;
+        put(e, k.attr);
+        put(e, k.a);
+        put(e, k.b);
+        put(e, (uint32_t)dense);
+        put(e, (uint64_t)ids.size());
+        put(e, data);
+        std::memcpy(&buf[table + l++ * kListBytes], e.data(), kListBytes);
+    }
+
+    const std::string tmp = idx_path_ + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t off = 0; ok && off < buf.size();) {
+        const ssize_t w = ::write(fd, buf.data() + off, buf.size() - off);
+        ok = w > 0;
+        off += ok ? (size_t)w : 0;
+    }
+    ::close(fd);
+    if (!ok || std::rename(tmp.c_str(), idx_path_.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    close();
+    return mapFile();
+}
+
+// ===== Mapping =====
+TopologyAttrIndex::TopologyAttrIndex(const TopologyDB_enhanced& db, std::string db_path)
+    : db_(db), db_path_(std::move(db_path)), idx_path_(sidecarPath(db_path_)) {}
+
+TopologyAttrIndex::~TopologyAttrIndex() {
+    close();
+}
+
+void TopologyAttrIndex::close() {
+    if (base_) munmap(const_cast<uint8_t*>(base_), map_bytes_);
+    base_ = nullptr;
+    map_bytes_ = 0;
+}
+
+uint64_t TopologyAttrIndex::size() const {
+    return base_ ? ld64(base_ + kCount) : 0;
+}
+
+bool TopologyAttrIndex::mapFile() {
+    const int fd = ::open(idx_path_.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    const bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= kHeaderSize;
+    void* p = ok ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base_ = static_cast<const uint8_t*>(p);
+    map_bytes_ = (size_t)st.st_size;
+
+    // Every list must lie inside the file
+    const uint64_t n = ld64(base_ + kCount), lists = ld64(base_ + kLists);
+    const uint64_t table = kHeaderSize + n * kRowBytes;
+    bool valid = std::memcmp(base_, kMagic, 4) == 0 && ld32(base_ + 4) == kVersion
+              && n < (uint64_t(1) << 32) && lists <= map_bytes_ / kListBytes
+              && table + lists * kListBytes <= map_bytes_;
+    for (uint64_t l = 0; valid && l < lists; ++l) {
+        const uint8_t* e = base_ + table + l * kListBytes;
+        const uint64_t cnt = ld64(e + 16), data = ld64(e + 24);
+        const uint64_t bytes = ld32(e + 12) ? (n + 63) / 64 * 8 : cnt * 4;
+        valid = cnt <= n && data % 4 == 0 && data <= map_bytes_ && bytes <= map_bytes_ - data;
+    }
+    if (!valid) close();
+    return valid;
+}
+
+bool TopologyAttrIndex::open() {
+    close();
+    std::error_code ec;
+    const uint64_t db_bytes = std::filesystem::file_size(db_path_, ec);
+    if (ec) return false;
+    if (!mapFile()) return rebuild();
+
+    // A DB that shrank or whose first bytes changed was rewritten, not appended to
+    const uint64_t indexed = ld64(base_ + kDbBytes);
+    if (db_bytes < indexed || head_hash(db_path_, indexed) != ld64(base_ + kDbHead)) return rebuild();
+    if (db_bytes == indexed) return true;
+    if (db_.isColumnar()) return rebuild();
+
+    Builder b;
+    return load(b) && scan(b, indexed) && write(b);
+}
+
+bool TopologyAttrIndex::rebuild() {
+    close();
+    Builder b;
+    return scan(b, 0) && write(b);
+}
+
+// ===== Queries =====
+TopologyAttrIndex::Row TopologyAttrIndex::row(uint64_t i) const {
+    const uint8_t* p = base_ + kHeaderSize + i * kRowBytes;
+    Row r;
+    r.pos = ld64(p);
+    r.blocks = ld32(p + 8);
+    r.externals = ld32(p + 12);
+    r.ec_blocks = ld32(p + 16);
+    r.ec_sidelinks = ld32(p + 20);
+    r.ec_instantons = ld32(p + 24);
+    r.max_port = (int32_t)ld32(p + 28);
+    return r;
+}
+
+TopologyAttrIndex::Bitmap TopologyAttrIndex::select(Attr attr, int a, int b) const {
+    const uint64_t n = size();
+    Bitmap out((size_t)n);
+    if (!base_) return out;
+
+    const uint8_t* table = base_ + kHeaderSize + n * kRowBytes;
+    const Key want{attr, a, b};
+    uint64_t lo = 0, hi = ld64(base_ + kLists);
+    while (lo < hi) {
+        const uint64_t mid = (lo + hi) / 2;
+        const uint8_t* e = table + mid * kListBytes;
+        if (Key{ld32(e), (int32_t)ld32(e + 4), (int32_t)ld32(e + 8)} < want) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == ld64(base_ + kLists)) return out;
+    const uint8_t* e = table + lo * kListBytes;
+    if (!(Key{ld32(e), (int32_t)ld32(e + 4), (int32_t)ld32(e + 8)} == want)) return out;
+
+    const uint8_t* data = base_ + ld64(e + 24);
+    if (ld32(e + 12)) {
+        std::memcpy(out.w_.data(), data, out.w_.size() * 8);
+    } else {
+        for (uint64_t k = 0; k < ld64(e + 16); ++k) {
+            const uint32_t id = ld32(data + k * 4);
+            if (id < n) out.set(id);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TopologyDB_enhanced;
+class Topology_enhanced;
+
+// Secondary attribute indexes of a TopologyDB_enhanced, either backend (<db>.bix)
+//
+// Layout (little-endian, mapped read-only):
+//   header : "TBX1" | u32 version | u64 db_bytes | u64 db_head | u64 count | u64 lists
+//            | u64 reserved                                                     (48 bytes)
+//   rows   : count x {u64 pos, u32 blocks, u32 externals, u32 ec_blocks, u32 ec_sidelinks,
+//            u32 ec_instantons, i32 max_port}                                   (32 bytes)
+//   lists  : lists x {u32 attr, i32 a, i32 b, u32 dense, u64 n, u64 data}       (32 bytes)
+//   data   : per list either n ascending u32 record numbers or, when dense, a bitmap of
+//            ceil(count/64) u64 words; 8-byte aligned
+//
+// Record numbers are file order and pos is what TopologyDB_enhanced::Cursor::seek takes
+// (byte offset in a text DB, row in a .tcol). A list holds the records with one attribute
+// value, e.g. (ExternalOnPort, parent_type, port); lists are sorted by (attr, a, b) and
+// stored dense once they cover 1/32 of the records. The row columns carry what
+// getExternalStatistics needs, so it never touches the DB.
+//
+// Motif attributes form an inverted index of local configurations by parameter: a block,
+// two blocks joined by an l_connection, a block and an attached side link or instanton,
+// and an external on a port of a block / side link / instanton. Intersecting their lists
+// narrows a substructure query to the records that can contain it; the candidates still
+// need checking, since the motifs of one record need not sit on the same block.
+//
+// db_bytes/db_head detect staleness as in TopologyIndex: records appended to a text DB
+// are indexed from db_bytes on the next open, any other change rebuilds the sidecar.
+// One writer at a time.
+
+class TopologyAttrIndex {
+public:
+    static constexpr char     kMagic[4]   = {'T','B','X','1'};
+    static constexpr uint32_t kVersion    = 2;
+    static constexpr size_t   kHeaderSize = 48;
+
+    enum Attr : uint32_t {
+        BlockCount     = 0,   // a = block.size()
+        ExternalCount  = 1,   // a = externals.size()
+        ExternalOnPort = 2,   // a = parent_type, b = port_idx of some e_connection
+        SideLinkParam  = 3,   // a = param of some side link
+
+        // Motifs, by parameter
+        BlockParam          = 4,    // a = block param
+        BlockPair           = 5,    // a <= b, params of two blocks joined by an l_connection
+        BlockSideLink       = 6,    // a = block param, b = param of a side link on it
+        BlockInstanton      = 7,    // a = block param, b = param of an instanton on it
+        ExternalOnBlock     = 8,    // a = block param, b = port of an external on it
+        ExternalOnSideLink  = 9,    // a = side-link param, b = port
+        ExternalOnInstanton = 10,   // a = instanton param, b = port
+    };
+
+    // Set of record numbers
+    class Bitmap {
+    public:
+        Bitmap() = default;
+        explicit Bitmap(size_t n, bool all = false);
+
+        size_t size() const { return n_; }
+        size_t count() const;
+        bool test(size_t i) const { return i < n_ && (w_[i >> 6] >> (i & 63)) & 1; }
+        void set(size_t i) { w_[i >> 6] |= uint64_t(1) << (i & 63); }
+
+        Bitmap& operator&=(const Bitmap& o);
+        Bitmap& operator|=(const Bitmap& o);
+        Bitmap operator~() const;
+        friend Bitmap operator&(Bitmap a, const Bitmap& b) { return a &= b; }
+        friend Bitmap operator|(Bitmap a, const Bitmap& b) { return a |= b; }
+
+        // Set bits in ascending order
+        template <class F> void forEach(F&& f) const {
+            for (size_t k = 0; k < w_.size(); ++k)
+                for (uint64_t w = w_[k]; w; w &= w - 1)
+                    f((k << 6) + (size_t)__builtin_ctzll(w));
+        }
+
+    private:
+        size_t n_ = 0;
+        std::vector<uint64_t> w_;
+        friend class TopologyAttrIndex;
+    };
+
+    struct Row {
+        uint64_t pos;
+        uint32_t blocks, externals;
+        uint32_t ec_blocks, ec_sidelinks, ec_instantons;   // e_connection parent_type 0/1/2
+        int32_t  max_port;                                  // max(0, port_idx)
+    };
+
+    struct Key {
+        uint32_t attr;
+        int32_t a, b;
+        bool operator<(const Key& o) const {
+            if (attr != o.attr) return attr < o.attr;
+            return a != o.a ? a < o.a : b < o.b;
+        }
+        bool operator==(const Key& o) const { return attr == o.attr && a == o.a && b == o.b; }
+    };
+
+    // Distinct keys a topology is listed under, sorted
+    static void keysOf(const Topology_enhanced& T, std::vector<Key>& out);
+    static Row rowOf(const Topology_enhanced& T, uint64_t pos);
+
+    TopologyAttrIndex(const TopologyDB_enhanced& db, std::string db_path);
+    ~TopologyAttrIndex();
+    TopologyAttrIndex(const TopologyAttrIndex&) = delete;
+    TopologyAttrIndex& operator=(const TopologyAttrIndex&) = delete;
+
+    static std::string sidecarPath(const std::string& db_path) { return db_path + ".bix"; }
+
+    // Map the sidecar, building it or bringing it up to date with the DB.
+    // False if the DB is missing or the sidecar cannot be written.
+    bool open();
+    bool rebuild();
+    void close();
+
+    bool isOpen() const { return base_ != nullptr; }
+    uint64_t size() const;
+    Row row(uint64_t i) const;
+    Bitmap select(Attr attr, int a, int b = 0) const;
+
+private:
+    struct Builder;
+
+    const TopologyDB_enhanced& db_;
+    std::string db_path_;
+    std::string idx_path_;
+    const uint8_t* base_ = nullptr;
+    size_t map_bytes_ = 0;
+
+    bool mapFile();
+    bool write(const Builder& b);
+    bool load(Builder& b) const;
+    bool scan(Builder& b, uint64_t from) const;
+};
@@ -1,11 +1,24 @@
 #include "TopologyDB_enhanced.hpp"
 #include "TopoLineCompact_enhanced.hpp"  // Include separate implementation
+#include "TopoColumnar.hpp"
+#include "TopologyIndex.hpp"
+#include "TopologyAttrIndex.hpp"
+#include "TopologyLog.hpp"
 #include <fstream>
 #include <sstream>
-#include <unordered_map>
 #include <filesystem>
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <charconv>
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ===== Helper functions for LKind conversion =====
 static inline int kindToInt(LKind k) {
@@ -72,53 +85,86 @@ bool TopologyDB_enhanced::writeFileAtomic(const std::string& path, const std::st
 }
 
 // ===== Serialization =====
-std::string TopologyDB_enhanced::serializeCanonical(const Topology_enhanced& T) {
-    std::ostringstream os;
-    os << "name:" << T.name << "\n";
-    os << "blocks:" << T.block.size() << "\n";
-    for (const auto& b : T.block) {
-        os << "  " << kindToInt(b.kind) << "," << b.param << "\n";
-    }
-    
-    os << "side_links:" << T.side_links.size() << "\n";
-    for (const auto& s : T.side_links) {
-        os << "  " << s.param << "\n";
+static inline void put_int(std::string& buf, long long v) {
+    char tmp[24];
+    const auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    buf.append(tmp, r.ptr);
+}
+
+static inline void put_section(std::string& buf, const char* key, size_t n) {
+    buf += key;
+    put_int(buf, (long long)n);
+    buf += '\n';
+}
+
+void TopologyDB_enhanced::serializeCanonicalInto(std::string& buf, const Topology_enhanced& T, bool with_header) {
+    if (with_header) {
+        // Nine section lines plus one per element (plus any newlines inside the name)
+        size_t lines = 9 + T.block.size() + T.side_links.size() + T.instantons.size()
+                     + T.externals.size() + T.l_connection.size() + T.s_connection.size()
+                     + T.i_connection.size() + T.e_connection.size()
+                     + (size_t)std::count(T.name.begin(), T.name.end(), '\n');
+        buf += T.name;
+        buf += '\t';
+        put_int(buf, (long long)lines);
+        buf += '\n';
     }
-    
-    os << "instantons:" << T.instantons.size() << "\n";
-    for (const auto& i : T.instantons) {
-        os << "  " << i.param << "\n";
+
+    buf += "name:";
+    buf += T.name;
+    buf += '\n';
+    put_section(buf, "blocks:", T.block.size());
+    for (const auto& b : T.block) {
+        buf += "  ";
+        put_int(buf, kindToInt(b.kind));
+        buf += ',';
+        put_int(buf, b.param);
+        buf += '\n';
     }
-    
+
+    put_section(buf, "side_links:", T.side_links.size());
+    for (const auto& s : T.side_links) { buf += "  "; put_int(buf, s.param); buf += '\n'; }
+
+    put_section(buf, "instantons:", T.instantons.size());
+    for (const auto& i : T.instantons) { buf += "  "; put_int(buf, i.param); buf += '\n'; }
+
     // ✨ NEW: Externals
-    os << "externals:" << T.externals.size() << "\n";
-    for (const auto& e : T.externals) {
-        os << "  " << e.param << "\n";
-    }
-    
-    os << "l_conn:" << T.l_connection.size() << "\n";
-    for (const auto& e : T.l_connection) {
-        os << "  " << e.u << "," << e.v << "\n";
-    }
-    
-    os << "s_conn:" << T.s_connection.size() << "\n";
-    for (const auto& e : T.s_connection) {
-        os << "  " << e.u << "," << e.v << "\n";
-    }
-    
-    os << "i_conn:" << T.i_connection.size() << "\n";
-    for (const auto& e : T.i_connection) {
-        os << "  " << e.u << "," << e.v << "\n";
-    }
-    
+    put_section(buf, "externals:", T.externals.size());
+    for (const auto& e : T.externals) { buf += "  "; put_int(buf, e.param); buf += '\n'; }
+
+    auto pairs = [&](const char* key, const auto& conn) {
+        put_section(buf, key, conn.size());
+        for (const auto& e : conn) {
+            buf += "  ";
+            put_int(buf, e.u);
+            buf += ',';
+            put_int(buf, e.v);
+            buf += '\n';
+        }
+    };
+    pairs("l_conn:", T.l_connection);
+    pairs("s_conn:", T.s_connection);
+    pairs("i_conn:", T.i_connection);
+
     // ✨ NEW: External connections
-    os << "e_conn:" << T.e_connection.size() << "\n";
+    put_section(buf, "e_conn:", T.e_connection.size());
     for (const auto& e : T.e_connection) {
-        os << "  " << e.parent_id << "," << e.parent_type << "," 
-           << e.port_idx << "," << e.external_id << "\n";
+        buf += "  ";
+        put_int(buf, e.parent_id);
+        buf += ',';
+        put_int(buf, e.parent_type);
+        buf += ',';
+        put_int(buf, e.port_idx);
+        buf += ',';
+        put_int(buf, e.external_id);
+        buf += '\n';
     }
-    
-    return os.str();
+}
+
+std::string TopologyDB_enhanced::serializeCanonical(const Topology_enhanced& T) {
+    std::string buf;
+    serializeCanonicalInto(buf, T);
+    return buf;
 }
 
 static void trim_end(std::string& s) {
@@ -265,91 +311,645 @@ bool TopologyDB_enhanced::deserializeCanonical(std::istream& in, int /*nLines*/,
     return true;
 }
 
+// In-memory parser: the same format and leniency as deserializeCanonical (unknown
+// section keys read as empty, unparsable connection lines are dropped), but numbers
+// come from from_chars on the payload itself.
+namespace {
+
+struct LineReader {
+    std::string_view s;
+    size_t pos = 0;
+
+    bool next(std::string_view& line) {
+        if (pos >= s.size()) return false;
+        size_t nl = s.find('\n', pos);
+        if (nl == std::string_view::npos) nl = s.size();
+        line = s.substr(pos, nl - pos);
+        pos = nl < s.size() ? nl + 1 : nl;
+        return true;
+    }
+    bool nextTrimmed(std::string_view& line) {
+        if (!next(line)) return false;
+        while (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return true;
+    }
+};
+
+// Integer after optional blanks (stoi / operator>> leniency); advances p
+bool take_int(const char*& p, const char* end, int& v) {
+    while (p < end && std::isspace((unsigned char)*p)) ++p;
+    if (p < end && *p == '+') ++p;
+    const auto r = std::from_chars(p, end, v);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+}
+
+// Integers separated by single non-blank characters, e.g. "  3,-1"
+bool take_ints(std::string_view line, int* v, int count) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) {
+            while (p < end && std::isspace((unsigned char)*p)) ++p;
+            if (p == end) return false;
+            ++p;
+        }
+        if (!take_int(p, end, v[i])) return false;
+    }
+    return true;
+}
+
+// "key:N" section header; another key reads as an empty section
+bool section_count(LineReader& in, std::string_view key, int& n) {
+    std::string_view line;
+    if (!in.nextTrimmed(line)) return false;
+    n = 0;
+    if (line.substr(0, key.size()) != key) return true;
+    const char* p = line.data() + key.size();
+    return take_int(p, line.data() + line.size(), n);
+}
+
+} // namespace
+
+bool TopologyDB_enhanced::parseCanonical(std::string_view payload, Topology_enhanced& T) {
+    T.Initialize();
+    LineReader in{payload};
+    std::string_view line;
+
+    if (!in.next(line) || line.substr(0, 5) != "name:") return false;
+    T.name.assign(line.substr(5));
+
+    int n, v[4];
+    if (!section_count(in, "blocks:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line) || !take_ints(line, v, 2)) return false;
+        T.block.push_back(Block{intToKind(v[0]), v[1]});
+    }
+
+    if (!section_count(in, "side_links:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line) || !take_ints(line, v, 1)) return false;
+        T.side_links.push_back(SideLinks{v[0]});
+    }
+
+    if (!section_count(in, "instantons:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line) || !take_ints(line, v, 1)) return false;
+        T.instantons.push_back(Instantons{v[0]});
+    }
+
+    if (!section_count(in, "externals:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line) || !take_ints(line, v, 1)) return false;
+        T.externals.push_back(External{v[0]});
+    }
+
+    if (!section_count(in, "l_conn:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line)) return false;
+        if (take_ints(line, v, 2)) T.l_connection.push_back({v[0], v[1]});
+    }
+
+    if (!section_count(in, "s_conn:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line)) return false;
+        if (take_ints(line, v, 2)) T.s_connection.push_back({v[0], v[1]});
+    }
+
+    if (!section_count(in, "i_conn:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line)) return false;
+        if (take_ints(line, v, 2)) T.i_connection.push_back({v[0], v[1]});
+    }
+
+    if (!section_count(in, "e_conn:", n)) return false;
+    for (int i = 0; i < n; i++) {
+        if (!in.nextTrimmed(line)) return false;
+        if (take_ints(line, v, 4)) T.e_connection.push_back({v[0], v[1], v[2], v[3]});
+    }
+    return true;
+}
+
 // ===== Basic I/O =====
-bool TopologyDB_enhanced::append(const Topology_enhanced& T) const {
-    const std::string payload = serializeCanonical(T);
-    const int lines = countLines(payload);
-    std::ofstream out(path_, std::ios::app);
-    if (!out) return false;
-    out << T.name << "\t" << lines << "\n" << payload;
+bool TopologyDB_enhanced::isColumnar() const {
+    return TopoColumnar::isColumnarFile(path_);
+}
+
+bool TopologyDB_enhanced::isLogStructured() const {
+    return TopologyLog::isLogDir(path_);
+}
+
+bool TopologyDB_enhanced::createLogStructured(const std::string& dir) {
+    return TopologyLog::create(dir);
+}
+
+// Sidecars describe the old file; both are rebuilt on next use
+void TopologyDB_enhanced::dropSidecars() const {
+    std::error_code ec;
+    std::filesystem::remove(TopologyIndex::sidecarPath(path_), ec);
+    std::filesystem::remove(TopologyAttrIndex::sidecarPath(path_), ec);
+}
+
+bool TopologyDB_enhanced::writeRecords(const std::vector<Record>& records) const {
+    if (isColumnar()) {
+        TopoColumnarWriter w;
+        for (const auto& r : records) w.add(r.topo);
+        if (!w.write(path_)) return false;
+        dropSidecars();
+        return true;
+    }
+    std::string buf;
+    for (const auto& r : records) serializeCanonicalInto(buf, r.topo, true);
+    if (!writeFileAtomic(path_, buf)) return false;
+    dropSidecars();
     return true;
 }
 
-std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::loadAll() const {
-    std::vector<Record> out;
-    std::ifstream in(path_);
-    if (!in) return out;
+// Payload lines after the first line (the "name:" line of serializeCanonical)
+static std::string_view without_name_line(std::string_view payload) {
+    const size_t nl = payload.find('\n');
+    return nl == std::string_view::npos ? std::string_view() : payload.substr(nl + 1);
+}
+
+// "name\tN" record header
+static bool parse_header(std::string_view header, std::string_view& name, int& n) {
+    const size_t tab = header.find('\t');
+    if (tab == std::string_view::npos) return false;
+    name = header.substr(0, tab);
+    const char* p = header.data() + tab + 1;
+    return take_int(p, header.data() + header.size(), n);
+}
+
+// Header name fills in a payload without one
+static bool finish_record(std::string_view name, std::string_view payload, TopologyDB_enhanced::Record& out) {
+    if (!TopologyDB_enhanced::parseCanonical(payload, out.topo)) return false;
+    out.name.assign(name);
+    if (out.topo.name.empty()) out.topo.name = out.name;
+    return true;
+}
 
+bool TopologyDB_enhanced::readRecord(std::istream& in, const std::string& header, Record& out) {
+    std::string_view nm;
+    int n;
+    if (!parse_header(header, nm, n)) return false;
+
+    std::string payload, l;
+    for (int i = 0; i < n; i++) {
+        if (!std::getline(in, l)) break;
+        payload += l;
+        payload += '\n';
+    }
+    return finish_record(nm, payload, out);
+}
+
+bool TopologyDB_enhanced::readRecordAt(uint64_t offset, Record& out) const {
+    std::ifstream in(path_);
+    if (!in) return false;
+    in.seekg((std::streamoff)offset);
     std::string header;
-    while (std::getline(in, header)) {
-        if (header.empty()) continue;
-        std::istringstream hs(header);
-        std::string nm, cnt;
-        if (!std::getline(hs, nm, '\t')) continue;
-        if (!std::getline(hs, cnt)) continue;
-        int n = std::stoi(cnt);
-
-        std::ostringstream payload;
-        for (int i = 0; i < n; i++) {
-            std::string l;
-            if (!std::getline(in, l)) break;
-            payload << l << "\n";
+    if (!std::getline(in, header) || header.empty()) return false;
+    return readRecord(in, header, out);
+}
+
+bool TopologyDB_enhanced::parseNextRecord(std::string_view text, size_t& pos, Record& out, size_t* at) {
+    LineReader in{text, pos};
+    std::string_view header, line;
+    while (true) {
+        const size_t start = in.pos;
+        if (!in.next(header)) break;
+        std::string_view nm;
+        int n;
+        if (header.empty() || !parse_header(header, nm, n)) continue;
+
+        const size_t begin = in.pos;
+        for (int i = 0; i < n && in.next(line); i++) {}
+        const std::string_view payload = text.substr(begin, in.pos - begin);
+        if (finish_record(nm, payload, out)) {
+            pos = in.pos;
+            if (at) *at = start;
+            return true;
+        }
+    }
+    pos = in.pos;
+    return false;
+}
+
+// ===== Cursor =====
+TopologyDB_enhanced::Cursor::Cursor(const TopologyDB_enhanced& db) {
+    if (db.isLogStructured()) {
+        log_ = std::make_unique<TopologyLog::Snapshot>();
+        open_ = log_->open(TopologyLog(db.path_));
+        return;
+    }
+    if (db.isColumnar()) {
+        columnar_ = std::make_unique<TopoColumnarReader>();
+        open_ = columnar_->open(db.path_);
+        return;
+    }
+    const int fd = ::open(db.path_.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    open_ = fstat(fd, &st) == 0;
+    size_ = open_ ? (size_t)st.st_size : 0;
+    if (open_ && size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        open_ = p != MAP_FAILED;
+        data_ = open_ ? static_cast<const char*>(p) : nullptr;
+        if (open_) madvise(p, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+}
+
+TopologyDB_enhanced::Cursor::~Cursor() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+}
+
+bool TopologyDB_enhanced::Cursor::next(Record& out) {
+    if (columnar_) {
+        if (!open_ || row_ >= columnar_->size()) return false;
+        offset_ = row_;
+        if (!columnar_->get(row_++, out.topo)) return false;
+        out.name = out.topo.name;
+        return true;
+    }
+
+    if (log_) {
+        // Parts in sequence order; tombstoned records are skipped
+        while (open_ && part_ < log_->parts()) {
+            if (!parseNextRecord(log_->text(part_), pos_, out)) {
+                ++part_;
+                pos_ = 0;
+                ordinal_ = 0;
+                continue;
+            }
+            const uint64_t seq = log_->seqOf(part_, ordinal_++);
+            if (log_->removed(seq)) continue;
+            offset_ = seq;
+            return true;
         }
+        return false;
+    }
+
+    size_t at = 0;
+    if (!parseNextRecord(std::string_view(data_ ? data_ : "", size_), pos_, out, &at)) return false;
+    offset_ = at;
+    return true;
+}
+
+bool TopologyDB_enhanced::forEach(const Visitor& fn) const {
+    Cursor c(*this);
+    if (!c.isOpen()) return false;
+    Record r;
+    while (c.next(r)) fn(r);
+    return true;
+}
+
+bool TopologyDB_enhanced::forEach(const Predicate& pred, const Visitor& fn) const {
+    return forEach([&](Record& r) { if (pred(r)) fn(r); });
+}
 
-        std::istringstream pin(payload.str());
-        Topology_enhanced T;
-        if (!deserializeCanonical(pin, n, T)) continue;
-        if (T.name.empty()) T.name = nm;
+bool TopologyDB_enhanced::rebuildIndex() const {
+    if (isColumnar() || isLogStructured()) return false;
+    return TopologyIndex(path_).rebuild();
+}
+
+bool TopologyDB_enhanced::append(const Topology_enhanced& T) const {
+    if (isColumnar()) return false;   // .tcol files are written whole
+    if (isLogStructured()) {
+        Writer w(*this);
+        return w.append(T) && w.close();
+    }
+    std::string rec;
+    serializeCanonicalInto(rec, T, true);
+    {
+        std::ofstream out(path_, std::ios::app);
+        if (!out) return false;
+        out << rec;
+        if (!out.good()) return false;
+    }
+
+    // Keep an existing sidecar index current (its catch-up reads just this record)
+    std::error_code ec;
+    if (std::filesystem::exists(TopologyIndex::sidecarPath(path_), ec)) {
+        TopologyIndex(path_).open();
+    }
+    return true;
+}
 
-        out.push_back(Record{nm, std::move(T)});
+// ===== Writer =====
+static int64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TopologyDB_enhanced::Writer::Writer(const TopologyDB_enhanced& db, Options opt) : db_(db), opt_(opt) {
+    if (db_.isColumnar()) {
+        std::cerr << "[Error] " << db_.path_ << " is a columnar DB; it cannot be appended to\n";
+        return;
+    }
+    std::string log_path;
+    if (db_.isLogStructured()) fd_ = TopologyLog(db_.path_).openActiveLog(log_path);
+    else fd_ = ::open(db_.path_.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[Error] Cannot open " << db_.path_ << " for appending\n";
+        return;
     }
+    if (!repairTail()) {
+        std::cerr << "[Error] Cannot check the end of " << db_.path_ << "\n";
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+    buf_.reserve(opt_.flush_bytes + 4096);
+    last_flush_ms_ = steady_ms();
+}
+
+TopologyDB_enhanced::Writer::~Writer() {
+    close();
+}
+
+// Records go out whole, so anything after the last complete record is a torn write:
+// an unterminated last line, or a final "name\tN" header with fewer than N lines after it
+bool TopologyDB_enhanced::Writer::repairTail() {
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    const size_t size = (size_t)st.st_size;
+    if (size == 0) return true;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    const std::string_view text(static_cast<const char*>(p), size);
+
+    const size_t last_nl = text.rfind('\n');
+    size_t keep = last_nl == std::string_view::npos ? 0 : last_nl + 1;
+
+    // Walk back to the last header; payload lines never contain a tab
+    int lines_after = 0;
+    for (size_t line_end = keep; line_end > 0;) {
+        const size_t nl = line_end - 1;
+        const size_t prev = nl ? text.rfind('\n', nl - 1) : std::string_view::npos;
+        const size_t start = prev == std::string_view::npos ? 0 : prev + 1;
+        const std::string_view line = text.substr(start, nl - start);
+        std::string_view nm;
+        int n;
+        if (line.find('\t') != std::string_view::npos && parse_header(line, nm, n)) {
+            if (lines_after < n) keep = start;
+            break;
+        }
+        ++lines_after;
+        line_end = start;
+    }
+    munmap(p, size);
+
+    if (keep == size) return true;
+    if (ftruncate(fd_, (off_t)keep) != 0) return false;
+    truncated_ = size - keep;
+    db_.dropSidecars();
+    std::cerr << "[Warning] Truncated a torn record (" << truncated_ << " bytes) at the end of "
+              << db_.path_ << "\n";
+    return true;
+}
+
+bool TopologyDB_enhanced::Writer::append(const Topology_enhanced& T) {
+    if (fd_ < 0 || failed_) return false;
+    serializeCanonicalInto(buf_, T, true);
+    ++appended_;
+    if (buf_.size() >= opt_.flush_bytes || steady_ms() - last_flush_ms_ >= opt_.flush_ms) return flush();
+    return true;
+}
+
+bool TopologyDB_enhanced::Writer::flush() {
+    if (fd_ < 0) return false;
+    for (size_t off = 0; off < buf_.size() && !failed_;) {
+        const ssize_t w = ::write(fd_, buf_.data() + off, buf_.size() - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            // Whatever made it out is cut off by the next Writer
+            std::cerr << "[Error] Write to " << db_.path_ << " failed: " << std::strerror(errno) << "\n";
+            failed_ = true;
+            break;
+        }
+        off += (size_t)w;
+    }
+    buf_.clear();
+    last_flush_ms_ = steady_ms();
+    if (!failed_ && opt_.sync == Sync::OnFlush && fdatasync(fd_) != 0) failed_ = true;
+    return !failed_;
+}
+
+bool TopologyDB_enhanced::Writer::close() {
+    if (fd_ < 0) return !failed_;
+    flush();
+    if (!failed_ && opt_.sync != Sync::None && fdatasync(fd_) != 0) failed_ = true;
+    ::close(fd_);
+    fd_ = -1;
+
+    // Same as append(): an existing point-lookup sidecar is kept current
+    std::error_code ec;
+    if (std::filesystem::exists(TopologyIndex::sidecarPath(db_.path_), ec)) {
+        TopologyIndex(db_.path_).open();
+    }
+    return !failed_;
+}
+
+std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::loadAll() const {
+    std::vector<Record> out;
+    forEach([&](Record& r) { out.push_back(std::move(r)); });
     return out;
 }
 
 bool TopologyDB_enhanced::loadByName(const std::string& name, Topology_enhanced& out) const {
-    auto all = loadAll();
-    for (auto& r : all) {
-        const std::string nm = r.topo.name.empty() ? r.name : r.topo.name;
-        if (nm == name) {
-            out = r.topo;
+    if (isColumnar()) {
+        // Scan the name column; only the match is materialized
+        TopoColumnarReader rd;
+        if (!rd.open(path_)) return false;
+        for (size_t i = 0; i < rd.size(); ++i)
+            if (rd.name(i) == name) return rd.get(i, out);
+        return false;
+    }
+
+    // Sidecar index: seek straight to the candidates
+    TopologyIndex idx(path_);
+    if (idx.open()) {
+        for (uint64_t off : idx.findName(name)) {
+            Record r;
+            if (!readRecordAt(off, r)) continue;
+            if ((r.topo.name.empty() ? r.name : r.topo.name) == name) {
+                out = std::move(r.topo);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Cursor c(*this);
+    Record r;
+    while (c.next(r)) {
+        if ((r.topo.name.empty() ? r.name : r.topo.name) == name) {
+            out = std::move(r.topo);
             return true;
         }
     }
     return false;
 }
 
+bool TopologyDB_enhanced::containsContent(const Topology_enhanced& T) const {
+    const std::string payload = serializeCanonical(T);
+    const std::string_view content = without_name_line(payload);
+
+    TopologyIndex idx(path_);
+    if (!isColumnar() && idx.open()) {
+        uint64_t off;
+        if (!idx.findContent(TopologyIndex::contentHash(content), off)) return false;
+        Record r;
+        return readRecordAt(off, r) && without_name_line(serializeCanonical(r.topo)) == content;
+    }
+
+    Cursor c(*this);
+    Record r;
+    while (c.next(r))
+        if (without_name_line(serializeCanonical(r.topo)) == content) return true;
+    return false;
+}
+
 // ✨ NEW: External-specific queries
 std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::loadWithExternals() const {
     std::vector<Record> result;
-    auto all = loadAll();
-    for (auto& r : all) {
-        if (r.topo.hasExternalCurves()) {
-            result.push_back(std::move(r));
-        }
-    }
+    forEach([](const Record& r) { return r.topo.hasExternalCurves(); },
+            [&](Record& r) { result.push_back(std::move(r)); });
     return result;
 }
 
 std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::loadWithoutExternals() const {
     std::vector<Record> result;
-    auto all = loadAll();
-    for (auto& r : all) {
-        if (!r.topo.hasExternalCurves()) {
-            result.push_back(std::move(r));
-        }
+    forEach([](const Record& r) { return !r.topo.hasExternalCurves(); },
+            [&](Record& r) { result.push_back(std::move(r)); });
+    return result;
+}
+
+// Topologies with an external curve on port `port` of a parent of type parent_type
+std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::loadWithExternalsOnPort(int parent_type, int port) const {
+    return load(whereExternalOnPort(parent_type, port));
+}
+
+// ===== Attribute queries =====
+TopologyDB_enhanced::Selection TopologyDB_enhanced::where(TopologyAttrIndex::Attr attr, int a, int b) const {
+    TopologyAttrIndex idx(*this, path_);
+    if (idx.open()) return idx.select(attr, a, b);
+
+    // No usable sidecar: the same set from a scan
+    std::vector<size_t> hits;
+    std::vector<TopologyAttrIndex::Key> keys;
+    const TopologyAttrIndex::Key want{attr, a, b};
+    size_t n = 0;
+    forEach([&](Record& r) {
+        TopologyAttrIndex::keysOf(r.topo, keys);
+        if (std::binary_search(keys.begin(), keys.end(), want)) hits.push_back(n);
+        ++n;
+    });
+    Selection sel(n);
+    for (size_t i : hits) sel.set(i);
+    return sel;
+}
+
+TopologyDB_enhanced::Selection TopologyDB_enhanced::whereBlockCount(int n) const {
+    return where(TopologyAttrIndex::BlockCount, n, 0);
+}
+
+TopologyDB_enhanced::Selection TopologyDB_enhanced::whereExternalCount(int n) const {
+    return where(TopologyAttrIndex::ExternalCount, n, 0);
+}
+
+TopologyDB_enhanced::Selection TopologyDB_enhanced::whereExternalOnPort(int parent_type, int port) const {
+    return where(TopologyAttrIndex::ExternalOnPort, parent_type, port);
+}
+
+TopologyDB_enhanced::Selection TopologyDB_enhanced::whereSideLinkParam(int param) const {
+    return where(TopologyAttrIndex::SideLinkParam, param, 0);
+}
+
+bool TopologyDB_enhanced::forEach(const Selection& sel, const Visitor& fn) const {
+    Cursor c(*this);
+    if (!c.isOpen()) return false;
+    Record r;
+
+    // Seek straight to each selected record
+    TopologyAttrIndex idx(*this, path_);
+    if (idx.open() && idx.size() == sel.size()) {
+        bool ok = true;
+        sel.forEach([&](size_t i) {
+            c.seek(idx.row(i).pos);
+            if (c.next(r)) fn(r);
+            else ok = false;
+        });
+        return ok;
     }
+
+    for (size_t i = 0; c.next(r); ++i)
+        if (sel.test(i)) fn(r);
+    return true;
+}
+
+std::vector<TopologyDB_enhanced::Record> TopologyDB_enhanced::load(const Selection& sel) const {
+    std::vector<Record> result;
+    result.reserve(sel.count());
+    forEach(sel, [&](Record& r) { result.push_back(std::move(r)); });
     return result;
 }
 
+bool TopologyDB_enhanced::rebuildAttributeIndex() const {
+    if (isLogStructured()) return false;   // selections on it come from a scan
+    return TopologyAttrIndex(*this, path_).rebuild();
+}
+
 // ✨ NEW: Statistics
 TopologyDB_enhanced::ExternalStats TopologyDB_enhanced::getExternalStatistics() const {
     ExternalStats stats = {0, 0, 0, 0, 0, 0, 0, 0};
-    auto all = loadAll();
-    
-    stats.total_topologies = static_cast<int>(all.size());
-    
-    for (const auto& r : all) {
+    if (isColumnar()) {
+        // Only the externals and e_conn columns are touched
+        TopoColumnarReader rd;
+        if (!rd.open(path_)) return stats;
+        stats.total_topologies = static_cast<int>(rd.size());
+        for (size_t i = 0; i < rd.size(); ++i) {
+            const int next = static_cast<int>(rd.externalCount(i));
+            if (next == 0) continue;
+            stats.topologies_with_externals++;
+            stats.total_externals += next;
+            stats.max_externals_per_topology = std::max(stats.max_externals_per_topology, next);
+            const int32_t* ec = rd.eConn(i);
+            for (size_t k = 0; k < rd.eConnCount(i); ++k, ec += 4) {
+                stats.max_port_index_used = std::max(stats.max_port_index_used, (int)ec[2]);
+                switch (ec[1]) {
+                    case 0: stats.externals_on_blocks++; break;
+                    case 1: stats.externals_on_sidelinks++; break;
+                    case 2: stats.externals_on_instantons++; break;
+                }
+            }
+        }
+        return stats;
+    }
+
+    // Text DB: the row columns of the attribute index, no records decoded
+    TopologyAttrIndex idx(*this, path_);
+    if (idx.open()) {
+        stats.total_topologies = static_cast<int>(idx.size());
+        for (uint64_t i = 0; i < idx.size(); ++i) {
+            const TopologyAttrIndex::Row row = idx.row(i);
+            if (row.externals == 0) continue;
+            stats.topologies_with_externals++;
+            stats.total_externals += static_cast<int>(row.externals);
+            stats.max_externals_per_topology = std::max(stats.max_externals_per_topology, (int)row.externals);
+            stats.max_port_index_used = std::max(stats.max_port_index_used, (int)row.max_port);
+            stats.externals_on_blocks += static_cast<int>(row.ec_blocks);
+            stats.externals_on_sidelinks += static_cast<int>(row.ec_sidelinks);
+            stats.externals_on_instantons += static_cast<int>(row.ec_instantons);
+        }
+        return stats;
+    }
+
+    forEach([&](const Record& r) {
         const auto& T = r.topo;
+        stats.total_topologies++;
         if (T.hasExternalCurves()) {
             stats.topologies_with_externals++;
             stats.total_externals += static_cast<int>(T.externals.size());
@@ -367,72 +967,341 @@ TopologyDB_enhanced::ExternalStats TopologyDB_enhanced::getExternalStatistics()
                 }
             }
         }
-    }
+    });
     
     return stats;
 }
 
 // ===== Deduplication =====
-int TopologyDB_enhanced::dedupeByContentHash(bool keep_last) const {
-    auto all = loadAll();
-    if (all.empty()) return 0;
-
-    std::unordered_map<std::string, int> seen;
-    std::vector<Record> kept;
-    kept.reserve(all.size());
-
-    if (!keep_last) {
-        for (auto& r : all) {
-            const std::string payload = serializeCanonical(r.topo);
-            const std::string h = cheapHashHex(payload);
-            if (seen.emplace(h, 1).second) kept.push_back(std::move(r));
-        }
-    } else {
-        std::vector<Record> rev(all.rbegin(), all.rend());
-        for (auto& r : rev) {
-            const std::string payload = serializeCanonical(r.topo);
-            const std::string h = cheapHashHex(payload);
-            if (seen.emplace(h, 1).second) kept.push_back(std::move(r));
+// Two streaming passes over the DB. Pass 1 reads one record at a time and emits a
+// 128-bit key (structure hash or name hash) with the record's ordinal; keys go to hash
+// partitions sized to the memory budget, spilled to <path>.dedupe.d/ when the DB is too
+// large for a single one. Each partition is then sorted on its own to pick the surviving
+// ordinal of every key, and pass 2 re-reads the DB writing the survivors (in file order)
+// to a temp file renamed over the original. Memory is bounded by one partition plus the
+// spill buffers, not by the DB size.
+namespace {
+
+struct DedupeKey {
+    uint64_t lo, hi, ord;
+};
+
+inline uint64_t fmix64(uint64_t x) {
+    x ^= x >> 33;  x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;  x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Two independent 64-bit lanes over a stream of integers; no text round trip
+class KeyHasher {
+public:
+    void add(uint64_t v) {
+        a_ = (a_ ^ v) * 0x9e3779b97f4a7c15ULL;
+        a_ ^= a_ >> 29;
+        b_ = (b_ + v) * 0xc2b2ae3d27d4eb4fULL;
+        b_ = (b_ << 31) | (b_ >> 33);
+        ++n_;
+    }
+    void add(std::string_view s) {
+        add(s.size());
+        size_t i = 0;
+        for (; i + 8 <= s.size(); i += 8) {
+            uint64_t w;
+            std::memcpy(&w, s.data() + i, 8);
+            add(w);
         }
-        std::reverse(kept.begin(), kept.end());
+        uint64_t w = 0;
+        std::memcpy(&w, s.data() + i, s.size() - i);
+        add(w);
+    }
+    TopologyDB_enhanced::Key128 finish() const {
+        return {fmix64(a_ ^ n_), fmix64(b_ ^ fmix64(a_))};
+    }
+
+private:
+    uint64_t a_ = 0x243f6a8885a308d3ULL, b_ = 0x13198a2e03707344ULL, n_ = 0;
+};
+
+} // namespace
+
+// Every field serializeCanonical writes, name included
+TopologyDB_enhanced::Key128 TopologyDB_enhanced::contentKey(const Topology_enhanced& T) {
+    KeyHasher h;
+    h.add(T.name);
+    h.add(T.block.size());
+    for (const auto& b : T.block) { h.add(kindToInt(b.kind)); h.add((uint64_t)b.param); }
+    h.add(T.side_links.size());
+    for (const auto& s : T.side_links) h.add((uint64_t)s.param);
+    h.add(T.instantons.size());
+    for (const auto& i : T.instantons) h.add((uint64_t)i.param);
+    h.add(T.externals.size());
+    for (const auto& e : T.externals) h.add((uint64_t)e.param);
+    h.add(T.l_connection.size());
+    for (const auto& e : T.l_connection) { h.add((uint64_t)e.u); h.add((uint64_t)e.v); }
+    h.add(T.s_connection.size());
+    for (const auto& e : T.s_connection) { h.add((uint64_t)e.u); h.add((uint64_t)e.v); }
+    h.add(T.i_connection.size());
+    for (const auto& e : T.i_connection) { h.add((uint64_t)e.u); h.add((uint64_t)e.v); }
+    h.add(T.e_connection.size());
+    for (const auto& e : T.e_connection) {
+        h.add((uint64_t)e.parent_id);  h.add((uint64_t)e.parent_type);
+        h.add((uint64_t)e.port_idx);   h.add((uint64_t)e.external_id);
+    }
+    return h.finish();
+}
+
+TopologyDB_enhanced::Key128 TopologyDB_enhanced::nameKey(std::string_view name) {
+    KeyHasher h;
+    h.add(name);
+    return h.finish();
+}
+
+namespace {
+
+DedupeKey structure_key(const Topology_enhanced& T, uint64_t ord) {
+    const auto k = TopologyDB_enhanced::contentKey(T);
+    return DedupeKey{k.lo, k.hi, ord};
+}
+
+DedupeKey name_key(std::string_view name, uint64_t ord) {
+    const auto k = TopologyDB_enhanced::nameKey(name);
+    return DedupeKey{k.lo, k.hi, ord};
+}
+
+template <class T>
+bool append_file(const std::string& path, const std::vector<T>& v) {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out.write(reinterpret_cast<const char*>(v.data()), (std::streamsize)(v.size() * sizeof(T)));
+    return out.good();
+}
+
+template <class T>
+bool read_file(const std::string& path, std::vector<T>& v) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return true;   // partition never spilled
+    const size_t n = (size_t)in.tellg() / sizeof(T);
+    const size_t old = v.size();
+    v.resize(old + n);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(v.data() + old), (std::streamsize)(n * sizeof(T)));
+    return in.good();
+}
+
+// Keys bucketed by their top hash bits; with one partition nothing touches the disk
+class KeyPartitions {
+public:
+    KeyPartitions(std::string dir, size_t parts, size_t buffer_keys)
+        : dir_(std::move(dir)), bufs_(parts), buffer_keys_(buffer_keys) {
+        while ((size_t(1) << bits_) < parts) ++bits_;
+    }
+
+    size_t size() const { return bufs_.size(); }
+    std::string file(const char* kind, size_t p) const { return dir_ + "/" + kind + std::to_string(p); }
+
+    bool add(const DedupeKey& k) {
+        const size_t p = bits_ ? (size_t)(k.hi >> (64 - bits_)) : 0;
+        auto& b = bufs_[p];
+        b.push_back(k);
+        if (bufs_.size() == 1 || b.size() < buffer_keys_) return true;
+        const bool ok = append_file(file("keys", p), b);
+        b.clear();
+        return ok;
     }
 
-    std::ostringstream buf;
-    for (auto& r : kept) {
-        const std::string payload = serializeCanonical(r.topo);
-        buf << r.topo.name << "\t" << countLines(payload) << "\n" << payload;
+    // Spilled keys of partition p followed by its buffered tail; releases the buffer
+    bool take(size_t p, std::vector<DedupeKey>& out) {
+        out.clear();
+        if (bufs_.size() > 1 && !read_file(file("keys", p), out)) return false;
+        out.insert(out.end(), bufs_[p].begin(), bufs_[p].end());
+        std::vector<DedupeKey>().swap(bufs_[p]);
+        return true;
     }
-    if (!writeFileAtomic(path_, buf.str())) return 0;
-    return (int)all.size() - (int)kept.size();
+
+private:
+    std::string dir_;
+    std::vector<std::vector<DedupeKey>> bufs_;
+    size_t buffer_keys_;
+    unsigned bits_ = 0;
+};
+
+// Surviving ordinals of one partition, ascending: the first (or last) of each key run
+std::vector<uint64_t> surviving_ordinals(std::vector<DedupeKey>& keys, bool keep_last) {
+    std::sort(keys.begin(), keys.end(), [](const DedupeKey& a, const DedupeKey& b) {
+        if (a.hi != b.hi) return a.hi < b.hi;
+        if (a.lo != b.lo) return a.lo < b.lo;
+        return a.ord < b.ord;
+    });
+    std::vector<uint64_t> kept;
+    for (size_t i = 0; i < keys.size();) {
+        size_t j = i + 1;
+        while (j < keys.size() && keys[j].hi == keys[i].hi && keys[j].lo == keys[i].lo) ++j;
+        kept.push_back(keep_last ? keys[j - 1].ord : keys[i].ord);
+        i = j;
+    }
+    std::sort(kept.begin(), kept.end());
+    return kept;
 }
 
-int TopologyDB_enhanced::dedupeByName(bool keep_last) const {
-    auto all = loadAll();
-    if (all.empty()) return 0;
+// k-way merge of the per-partition survivor files back into file order
+class OrdinalMerge {
+public:
+    bool open(const std::vector<std::string>& files) {
+        in_.resize(files.size());
+        for (size_t p = 0; p < files.size(); ++p) {
+            in_[p].open(files[p], std::ios::binary);
+            if (!in_[p]) return false;
+            pull(p);
+        }
+        return true;
+    }
+    // Next surviving ordinal, or UINT64_MAX when exhausted
+    uint64_t next() {
+        if (heap_.empty()) return UINT64_MAX;
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<>());
+        const auto [ord, p] = heap_.back();
+        heap_.pop_back();
+        pull(p);
+        return ord;
+    }
+
+private:
+    std::vector<std::ifstream> in_;
+    std::vector<std::pair<uint64_t, size_t>> heap_;
+
+    void pull(size_t p) {
+        uint64_t ord;
+        if (!in_[p].read(reinterpret_cast<char*>(&ord), sizeof ord)) return;
+        heap_.emplace_back(ord, p);
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+    }
+};
+
+} // namespace
+
+int TopologyDB_enhanced::dedupeStreaming(bool by_name, bool keep_last, size_t memory_bytes) const {
+    // Tombstones only; the records go at the next compaction
+    if (isLogStructured()) return std::max(0, TopologyLog(path_).dedupe(by_name, keep_last));
+
+    std::error_code ec;
+    const bool columnar = isColumnar();
+    const uint64_t db_bytes = std::filesystem::file_size(path_, ec);
+    if (ec) return 0;
+
+    // Partitions: half the budget holds one partition's keys, the other half the
+    // spill buffers. The record count is bounded from the file size (a text record
+    // is at least ~80 bytes; a columnar one at least ~64)
+    const size_t budget = std::max<size_t>(memory_bytes, size_t(1) << 20);
+    const uint64_t est_records = db_bytes / 64 + 1;
+    const size_t part_keys = budget / 2 / sizeof(DedupeKey);
+    size_t parts = 1;
+    while (parts < 512 && est_records / parts > part_keys) parts <<= 1;
+    const size_t buffer_keys = std::max<size_t>(256, budget / 2 / sizeof(DedupeKey) / parts);
 
-    std::unordered_map<std::string, int> seen;
-    std::vector<Record> kept;
-    kept.reserve(all.size());
+    const std::string dir = path_ + ".dedupe.d";
+    struct DirGuard {
+        std::string dir;
+        ~DirGuard() { std::error_code e; std::filesystem::remove_all(dir, e); }
+    } guard{parts > 1 ? dir : std::string()};
+    if (parts > 1) {
+        std::filesystem::remove_all(dir, ec);
+        if (!std::filesystem::create_directories(dir, ec)) {
+            std::cerr << "[Error] Cannot create dedupe spill directory " << dir << "\n";
+            return 0;
+        }
+    }
+
+    // Pass 1: keys
+    KeyPartitions keys(dir, parts, buffer_keys);
+    uint64_t total = 0;
+    bool spilled = true;
+    bool ok = forEach([&](Record& r) {
+        spilled = spilled && keys.add(by_name ? name_key(r.topo.name.empty() ? r.name : r.topo.name, total)
+                                    : structure_key(r.topo, total));
+        ++total;
+    });
+    if (!ok || !spilled) {
+        std::cerr << "[Error] Dedupe failed reading " << path_ << " or spilling keys\n";
+        return 0;
+    }
+    if (total == 0) return 0;
 
-    if (!keep_last) {
-        for (auto& r : all) {
-            const std::string nm = r.topo.name.empty() ? r.name : r.topo.name;
-            if (seen.emplace(nm, 1).second) kept.push_back(std::move(r));
+    // Survivors per partition
+    std::vector<uint64_t> kept;          // single partition: kept in memory
+    std::vector<std::string> kept_files;
+    uint64_t n_kept = 0;
+    {
+        std::vector<DedupeKey> part;
+        for (size_t p = 0; p < keys.size(); ++p) {
+            if (!keys.take(p, part)) return 0;
+            std::vector<uint64_t> s = surviving_ordinals(part, keep_last);
+            n_kept += s.size();
+            if (keys.size() == 1) { kept = std::move(s); break; }
+            std::filesystem::remove(keys.file("keys", p), ec);
+            kept_files.push_back(keys.file("kept", p));
+            if (!append_file(kept_files.back(), s)) return 0;
         }
+    }
+    OrdinalMerge merge;
+    if (!kept_files.empty() && !merge.open(kept_files)) return 0;
+    size_t kept_pos = 0;
+    auto next_kept = [&]() -> uint64_t {
+        if (kept_files.empty()) return kept_pos < kept.size() ? kept[kept_pos++] : UINT64_MAX;
+        return merge.next();
+    };
+
+    // Pass 2: survivors in file order
+    uint64_t ord = 0, want = next_kept();
+    if (columnar) {
+        TopoColumnarWriter w;
+        ok = forEach([&](Record& r) {
+            if (ord++ != want) return;
+            w.add(r.topo);
+            want = next_kept();
+        });
+        if (!ok || !w.write(path_)) return 0;
     } else {
-        std::vector<Record> rev(all.rbegin(), all.rend());
-        for (auto& r : rev) {
-            const std::string nm = r.topo.name.empty() ? r.name : r.topo.name;
-            if (seen.emplace(nm, 1).second) kept.push_back(std::move(r));
+        const std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return 0;
+            std::string buf;
+            ok = forEach([&](Record& r) {
+                if (ord++ != want) return;
+                serializeCanonicalInto(buf, r.topo, true);
+                if (buf.size() >= (size_t(1) << 22)) {
+                    out.write(buf.data(), (std::streamsize)buf.size());
+                    buf.clear();
+                }
+                want = next_kept();
+            });
+            out.write(buf.data(), (std::streamsize)buf.size());
+            ok = ok && out.good();
+        }
+        if (ok) std::filesystem::rename(tmp, path_, ec);
+        if (!ok || ec) {
+            std::filesystem::remove(tmp, ec);
+            return 0;
         }
-        std::reverse(kept.begin(), kept.end());
     }
+    dropSidecars();
+    return (int)(total - n_kept);
+}
 
-    std::ostringstream buf;
-    for (auto& r : kept) {
-        const std::string payload = serializeCanonical(r.topo);
-        buf << r.topo.name << "\t" << countLines(payload) << "\n" << payload;
-    }
-    if (!writeFileAtomic(path_, buf.str())) return 0;
-    return (int)all.size() - (int)kept.size();
+int TopologyDB_enhanced::dedupeByContentHash(bool keep_last, size_t memory_bytes) const {
+    return dedupeStreaming(false, keep_last, memory_bytes);
+}
+
+int TopologyDB_enhanced::dedupeByName(bool keep_last, size_t memory_bytes) const {
+    return dedupeStreaming(true, keep_last, memory_bytes);
+}
+
+// ===== Compaction =====
+int TopologyDB_enhanced::compact(bool full, bool dedupe) const {
+    if (!isLogStructured()) return -1;
+    return TopologyLog(path_).compact(full, dedupe);
+}
+
+std::future<int> TopologyDB_enhanced::compactInBackground(bool full, bool dedupe) const {
+    return std::async(std::launch::async, [this, full, dedupe] { return compact(full, dedupe); });
 }
@@ -4,7 +4,22 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string_view>
+#include <future>
+#include "TopologyAttrIndex.hpp"
+#include "TopologyLog.hpp"
 
+class TopoColumnarReader;
+
+// Backends, detected from the file contents:
+//   - text: "name\tN" header + N lines of serializeCanonical per record (append-friendly)
+//   - columnar: .tcol structure-of-arrays file (TopoColumnar.hpp); read-only apart from
+//     whole-file rewrites (dedupe), append() returns false
+//   - log-structured: a directory of immutable segments plus an append log (TopologyLog.hpp),
+//     made with createLogStructured(); dedupe writes tombstones and compact() merges
 class TopologyDB_enhanced {
 public:
     struct Record {
@@ -14,14 +29,133 @@ public:
 
     explicit TopologyDB_enhanced(std::string path);
 
+    // Forward cursor over the records in file order. A text DB is mapped and each record
+    // parsed straight from the mapping into the caller's Record, reusing its vectors;
+    // malformed records are skipped. One record in memory at a time. A log-structured DB
+    // is read from a snapshot taken at construction, in insertion order.
+    class Cursor {
+    public:
+        explicit Cursor(const TopologyDB_enhanced& db);
+        ~Cursor();
+        Cursor(const Cursor&) = delete;
+        Cursor& operator=(const Cursor&) = delete;
+
+        bool isOpen() const { return open_; }
+        bool next(Record& out);              // false once exhausted
+        // Positions are byte offsets in a text DB and rows in a .tcol; offset() is the
+        // sequence number in a log-structured DB, which cannot seek
+        uint64_t offset() const { return offset_; }   // of the last record returned
+        uint64_t position() const { return columnar_ ? row_ : pos_; }   // where next() resumes
+        void seek(uint64_t pos) { (columnar_ ? row_ : pos_) = (size_t)pos; }
+
+    private:
+        bool open_ = false;
+        const char* data_ = nullptr;
+        size_t size_ = 0, pos_ = 0;
+        uint64_t offset_ = 0;
+        std::unique_ptr<TopoColumnarReader> columnar_;
+        size_t row_ = 0;
+        std::unique_ptr<TopologyLog::Snapshot> log_;
+        size_t part_ = 0;
+        uint64_t ordinal_ = 0;
+    };
+
+    // Append session on a text DB: one descriptor, records serialized into a buffer that
+    // is written once it holds flush_bytes or, checked on append, flush_ms have passed
+    // since the last write. Buffered records are lost if the process dies; a record torn
+    // by a crash mid-write is truncated away when the next Writer opens the DB. Sidecar
+    // indexes catch up on their next open. On a log-structured DB the session appends to
+    // the active log and holds its lock, so compaction leaves that log alone until close().
+    class Writer {
+    public:
+        enum class Sync { None, OnFlush, OnClose };   // when to fdatasync
+        struct Options {
+            size_t flush_bytes = size_t(4) << 20;
+            int flush_ms = 1000;
+            Sync sync = Sync::OnClose;
+        };
+
+        explicit Writer(const TopologyDB_enhanced& db) : Writer(db, Options()) {}
+        Writer(const TopologyDB_enhanced& db, Options opt);
+        ~Writer();
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        bool isOpen() const { return fd_ >= 0; }
+        bool append(const Topology_enhanced& T);
+        bool flush();
+        bool close();
+
+        uint64_t appended() const { return appended_; }
+        uint64_t truncatedBytes() const { return truncated_; }   // torn tail dropped at open
+
+    private:
+        const TopologyDB_enhanced& db_;
+        Options opt_;
+        int fd_ = -1;
+        std::string buf_;
+        int64_t last_flush_ms_ = 0;
+        uint64_t appended_ = 0, truncated_ = 0;
+        bool failed_ = false;
+
+        bool repairTail();
+    };
+
+    // Streaming scans built on Cursor; false if the DB cannot be opened.
+    // The visitor may move out of the Record it is given.
+    using Predicate = std::function<bool(const Record&)>;
+    using Visitor = std::function<void(Record&)>;
+    bool forEach(const Visitor& fn) const;
+    bool forEach(const Predicate& pred, const Visitor& fn) const;
+
     // Basic operations
+    bool isColumnar() const;
+    bool isLogStructured() const;
+    static bool createLogStructured(const std::string& dir);
     bool append(const Topology_enhanced& T) const;
     std::vector<Record> loadAll() const;
     bool loadByName(const std::string& name, Topology_enhanced& out) const;
 
-    // Deduplication
-    int dedupeByContentHash(bool keep_last = false) const;
-    int dedupeByName(bool keep_last = false) const;
+    // Point lookups on a text DB go through the sidecar index <path>.idx
+    // (TopologyIndex.hpp), created on first use and kept current by append().
+    // containsContent: some record equals T apart from its name.
+    bool containsContent(const Topology_enhanced& T) const;
+    bool rebuildIndex() const;
+
+    // Deduplication: streams the DB twice keeping about memory_bytes of 128-bit keys in
+    // memory, spilling hash partitions to <path>.dedupe.d/ beyond that. Content
+    // duplicates agree in every serialized field, name included. Returns records removed.
+    static constexpr size_t kDedupeMemoryBytes = size_t(256) << 20;
+    int dedupeByContentHash(bool keep_last = false, size_t memory_bytes = kDedupeMemoryBytes) const;
+    int dedupeByName(bool keep_last = false, size_t memory_bytes = kDedupeMemoryBytes) const;
+
+    // Dedupe keys: every serialized field (name included), or the name alone
+    struct Key128 {
+        uint64_t lo = 0, hi = 0;
+        bool operator==(const Key128& o) const { return lo == o.lo && hi == o.hi; }
+    };
+    static Key128 contentKey(const Topology_enhanced& T);
+    static Key128 nameKey(std::string_view name);
+
+    // Log-structured DB only: merge the sealed logs and newest segments, dropping
+    // tombstoned records and, with dedupe, content already stored. Readers keep their
+    // snapshots meanwhile. full merges every segment. Returns records dropped, -1 on failure.
+    int compact(bool full = false, bool dedupe = true) const;
+    std::future<int> compactInBackground(bool full = false, bool dedupe = true) const;
+
+    // Attribute queries answered from the bitmap sidecar <path>.bix (TopologyAttrIndex.hpp),
+    // built on first use and caught up after appends. A Selection is a set of record
+    // numbers: combine with & | ~, then load()/forEach() decode only the selected records.
+    // Without a writable sidecar the same answers come from a scan.
+    using Selection = TopologyAttrIndex::Bitmap;
+    Selection whereBlockCount(int n) const;
+    Selection whereExternalCount(int n) const;
+    Selection whereExternalOnPort(int parent_type, int port) const;
+    Selection whereSideLinkParam(int param) const;
+    Selection where(TopologyAttrIndex::Attr attr, int a, int b = 0) const;   // any attribute, motifs included
+    std::vector<Record> load(const Selection& sel) const;
+    bool forEach(const Selection& sel, const Visitor& fn) const;
+    bool rebuildAttributeIndex() const;
 
     // ✨ NEW: External-specific queries
     std::vector<Record> loadWithExternals() const;  // Load only topologies with external curves
@@ -43,7 +177,14 @@ public:
 
     // Serialization
     static std::string serializeCanonical(const Topology_enhanced& T);
+    // serializeCanonical appended to buf, optionally behind its "name\tN" record header
+    static void serializeCanonicalInto(std::string& buf, const Topology_enhanced& T, bool with_header = false);
     static bool deserializeCanonical(std::istream& in, int nLines, Topology_enhanced& out);
+    // Same format parsed from memory; clears `out` but keeps its capacity
+    static bool parseCanonical(std::string_view payload, Topology_enhanced& out);
+    // Next well-formed record of a text DB image at or after pos, which is advanced past
+    // it; at receives the offset of its header. False once the text is exhausted.
+    static bool parseNextRecord(std::string_view text, size_t& pos, Record& out, size_t* at = nullptr);
     
     // Migration from basic Topology
     static Topology_enhanced upgradeFromBasic(const struct Topology& basic);
@@ -56,6 +197,11 @@ private:
     static int countLines(const std::string& s);
     static std::string cheapHashHex(const std::string& s);
     static bool writeFileAtomic(const std::string& path, const std::string& content);
+    bool writeRecords(const std::vector<Record>& records) const;  // whole file, current backend
+    static bool readRecord(std::istream& in, const std::string& header, Record& out);
+    bool readRecordAt(uint64_t offset, Record& out) const;
+    int dedupeStreaming(bool by_name, bool keep_last, size_t memory_bytes) const;
+    void dropSidecars() const;   // after a whole-file rewrite
 };
 
 // TopoLineCompact_enhanced is now in its own file
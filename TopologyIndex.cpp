@@ -0,0 +1,342 @@
+#include "TopologyIndex.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===== Header fields and slots =====
+namespace {
+
+constexpr size_t kDbBytes = 8, kDbHead = 16, kCount = 24, kSlots = 32;
+constexpr size_t kNameSlot = 16, kContentSlot = 24;
+constexpr uint64_t kInitialSlots = 1024;
+constexpr size_t kHeadBytes = 4096;    // DB prefix covered by db_head
+
+inline uint64_t ld64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void st64(uint8_t* p, uint64_t v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t fnv1a(std::string_view s, uint64_t h) {
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Read-only mapping of the DB for scanning
+struct DbView {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool map(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        size = ok ? (size_t)st.st_size : 0;
+        if (ok && size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = p != MAP_FAILED;
+            data = ok ? static_cast<const char*>(p) : nullptr;
+        }
+        ::close(fd);
+        return ok;
+    }
+    ~DbView() { if (data) munmap(const_cast<char*>(data), size); }
+
+    uint64_t headHash(uint64_t upto) const {
+        return mix64(fnv1a(std::string_view(data, std::min<size_t>({size, (size_t)upto, kHeadBytes})),
+                           1469598103934665603ULL));
+    }
+};
+
+} // namespace
+
+// ===== Hashing =====
+uint64_t TopologyIndex::nameHash(std::string_view name) {
+    const uint64_t h = mix64(fnv1a(name, 1469598103934665603ULL));
+    return h ? h : 1;
+}
+
+TopologyIndex::Hash128 TopologyIndex::contentHash(std::string_view payload) {
+    Hash128 h;
+    h.lo = mix64(fnv1a(payload, 1469598103934665603ULL));
+    h.hi = mix64(fnv1a(payload, 0x9e3779b97f4a7c15ULL) ^ payload.size());
+    if (h.lo == 0) h.lo = 1;
+    return h;
+}
+
+// ===== Mapping =====
+TopologyIndex::TopologyIndex(std::string db_path)
+    : db_path_(std::move(db_path)), idx_path_(sidecarPath(db_path_)) {}
+
+TopologyIndex::~TopologyIndex() {
+    close();
+}
+
+void TopologyIndex::close() {
+    if (base_) munmap(base_, map_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    map_bytes_ = 0;
+    fd_ = -1;
+}
+
+uint64_t TopologyIndex::size() const {
+    return base_ ? ld64(base_ + kCount) : 0;
+}
+
+static size_t index_bytes(uint64_t slots) {
+    return TopologyIndex::kHeaderSize + (size_t)slots * (kNameSlot + kContentSlot);
+}
+
+bool TopologyIndex::mapFile() {
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || (size_t)st.st_size < kHeaderSize) return false;
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    base_ = static_cast<uint8_t*>(p);
+    map_bytes_ = (size_t)st.st_size;
+
+    uint32_t version;
+    std::memcpy(&version, base_ + 4, 4);
+    const uint64_t slots = ld64(base_ + kSlots);
+    return std::memcmp(base_, kMagic, 4) == 0 && version == kVersion
+        && slots >= kInitialSlots && (slots & (slots - 1)) == 0
+        && map_bytes_ == index_bytes(slots);
+}
+
+// Fresh, empty index file with `slots` slots, written next to the sidecar and renamed
+// over it; on success the new file is mapped
+bool TopologyIndex::create(uint64_t slots) {
+    const std::string tmp = idx_path_ + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const size_t bytes = index_bytes(slots);
+    if (ftruncate(fd, (off_t)bytes) != 0) { ::close(fd); return false; }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { ::close(fd); return false; }
+
+    uint8_t* base = static_cast<uint8_t*>(p);
+    std::memcpy(base, kMagic, 4);
+    std::memcpy(base + 4, &kVersion, 4);
+    st64(base + kSlots, slots);
+    if (std::rename(tmp.c_str(), idx_path_.c_str()) != 0) {
+        munmap(p, bytes);
+        ::close(fd);
+        return false;
+    }
+    close();
+    fd_ = fd;
+    base_ = base;
+    map_bytes_ = bytes;
+    return true;
+}
+
+bool TopologyIndex::open() {
+    close();
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(db_path_, ec)) return false;
+
+    fd_ = ::open(idx_path_.c_str(), O_RDWR);
+    if (fd_ < 0 || !mapFile()) return rebuild();
+
+    // A DB that shrank or whose first bytes changed was rewritten, not appended to
+    DbView db;
+    if (!db.map(db_path_)) return false;
+    const uint64_t indexed = ld64(base_ + kDbBytes);
+    if (db.size < indexed || db.headHash(indexed) != ld64(base_ + kDbHead)) return rebuild();
+    return catchUp();
+}
+
+bool TopologyIndex::rebuild() {
+    close();
+    return create(kInitialSlots) && catchUp();
+}
+
+// ===== Tables =====
+bool TopologyIndex::grow() {
+    const uint64_t old_slots = ld64(base_ + kSlots);
+    const uint8_t* old_names = base_ + kHeaderSize;
+    const uint8_t* old_content = old_names + old_slots * kNameSlot;
+
+    // Keep the old mapping alive while the new file is filled
+    uint8_t* old_base = base_;
+    const size_t old_bytes = map_bytes_;
+    const int old_fd = fd_;
+    base_ = nullptr;
+    fd_ = -1;
+    if (!create(2 * old_slots)) {
+        base_ = old_base;
+        map_bytes_ = old_bytes;
+        fd_ = old_fd;
+        return false;
+    }
+
+    const uint64_t mask = 2 * old_slots - 1;
+    uint8_t* names = base_ + kHeaderSize;
+    uint8_t* content = names + (mask + 1) * kNameSlot;
+    for (uint64_t s = 0; s < old_slots; ++s) {
+        const uint8_t* e = old_names + s * kNameSlot;
+        if (const uint64_t h = ld64(e)) {
+            uint64_t i = h & mask;
+            while (ld64(names + i * kNameSlot)) i = (i + 1) & mask;
+            std::memcpy(names + i * kNameSlot, e, kNameSlot);
+        }
+        const uint8_t* c = old_content + s * kContentSlot;
+        if (const uint64_t h = ld64(c)) {
+            uint64_t i = h & mask;
+            while (ld64(content + i * kContentSlot)) i = (i + 1) & mask;
+            std::memcpy(content + i * kContentSlot, c, kContentSlot);
+        }
+    }
+    std::memcpy(base_ + kDbBytes, old_base + kDbBytes, 24);   // db_bytes, db_head, count
+
+    munmap(old_base, old_bytes);
+    ::close(old_fd);
+    return true;
+}
+
+// Idempotent: a (name hash, offset) pair already present is not added again, so
+// re-scanning records after an interrupted update is harmless
+bool TopologyIndex::insert(uint64_t offset, uint64_t name_hash, const Hash128& content) {
+    if (2 * (ld64(base_ + kCount) + 1) > ld64(base_ + kSlots) && !grow()) return false;
+
+    const uint64_t mask = ld64(base_ + kSlots) - 1;
+    uint8_t* names = base_ + kHeaderSize;
+    uint8_t* table = names + (mask + 1) * kNameSlot;
+
+    uint64_t i = name_hash & mask;
+    for (;; i = (i + 1) & mask) {
+        uint8_t* e = names + i * kNameSlot;
+        const uint64_t h = ld64(e);
+        if (h == 0) {
+            st64(e, name_hash);
+            st64(e + 8, offset);
+            st64(base_ + kCount, ld64(base_ + kCount) + 1);
+            break;
+        }
+        if (h == name_hash && ld64(e + 8) == offset) break;
+    }
+
+    for (i = content.lo & mask;; i = (i + 1) & mask) {
+        uint8_t* e = table + i * kContentSlot;
+        const uint64_t lo = ld64(e);
+        if (lo == 0) {
+            st64(e, content.lo);
+            st64(e + 8, content.hi);
+            st64(e + 16, offset);
+            break;
+        }
+        if (lo == content.lo && ld64(e + 8) == content.hi) break;   // first record wins
+    }
+    return true;
+}
+
+std::vector<uint64_t> TopologyIndex::findName(std::string_view name) const {
+    std::vector<uint64_t> out;
+    if (!base_) return out;
+    const uint64_t h = nameHash(name);
+    const uint64_t mask = ld64(base_ + kSlots) - 1;
+    const uint8_t* names = base_ + kHeaderSize;
+    for (uint64_t i = h & mask;; i = (i + 1) & mask) {
+        const uint8_t* e = names + i * kNameSlot;
+        const uint64_t eh = ld64(e);
+        if (eh == 0) break;
+        if (eh == h) out.push_back(ld64(e + 8));
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+bool TopologyIndex::findContent(const Hash128& h, uint64_t& offset) const {
+    if (!base_) return false;
+    const uint64_t mask = ld64(base_ + kSlots) - 1;
+    const uint8_t* table = base_ + kHeaderSize + (mask + 1) * kNameSlot;
+    for (uint64_t i = h.lo & mask;; i = (i + 1) & mask) {
+        const uint8_t* e = table + i * kContentSlot;
+        const uint64_t lo = ld64(e);
+        if (lo == 0) return false;
+        if (lo == h.lo && ld64(e + 8) == h.hi) {
+            offset = ld64(e + 16);
+            return true;
+        }
+    }
+}
+
+// ===== Scanning =====
+// Records are read the way TopologyDB_enhanced::loadAll reads them: empty lines are
+// skipped, a header is "name\tN", and the N following lines are the payload whose
+// first line is "name:<name>". A record cut off by the end of the file is left for
+// the next catch-up.
+bool TopologyIndex::catchUp() {
+    DbView db;
+    if (!db.map(db_path_)) return false;
+
+    uint64_t pos = ld64(base_ + kDbBytes);
+    const std::string_view all(db.data ? db.data : "", db.size);
+    auto line_at = [&](uint64_t at, uint64_t& next) {
+        size_t nl = all.find('\n', (size_t)at);
+        const bool complete = nl != std::string_view::npos;
+        if (!complete) nl = all.size();
+        next = complete ? nl + 1 : all.size() + 1;   // past the end marks a partial line
+        return all.substr((size_t)at, nl - (size_t)at);
+    };
+
+    uint64_t indexed = pos;
+    while (pos < all.size()) {
+        uint64_t next;
+        const std::string_view header = line_at(pos, next);
+        if (next > all.size()) break;
+        const uint64_t rec = pos;
+        pos = next;
+        if (header.empty()) { indexed = pos; continue; }
+
+        const size_t tab = header.find('\t');
+        int n = 0;
+        const char* cnt = header.data() + (tab == std::string_view::npos ? header.size() : tab + 1);
+        const auto r = std::from_chars(cnt, header.data() + header.size(), n);
+        if (tab == std::string_view::npos || r.ec != std::errc() || n < 0) { indexed = pos; continue; }
+
+        uint64_t name_end = pos;
+        std::string_view name = header.substr(0, tab);
+        bool complete = true;
+        for (int k = 0; k < n; ++k) {
+            const std::string_view l = line_at(pos, next);
+            if (next > all.size()) { complete = false; break; }
+            if (k == 0 && l.rfind("name:", 0) == 0) {
+                if (l.size() > 5) name = l.substr(5);
+                name_end = next;
+            }
+            pos = next;
+        }
+        if (!complete) break;
+
+        const Hash128 content = contentHash(all.substr((size_t)name_end, (size_t)(pos - name_end)));
+        if (!insert(rec, nameHash(name), content)) return false;
+        indexed = pos;
+    }
+
+    st64(base_ + kDbBytes, indexed);
+    st64(base_ + kDbHead, db.headHash(indexed));
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Persistent sidecar index of a text TopologyDB_enhanced (<db>.idx)
+//
+// Layout (little-endian, mapped read-write):
+//   header  : "TDX1" | u32 version | u64 db_bytes | u64 db_head | u64 count | u64 slots
+//             | u64 reserved                                                  (48 bytes)
+//   names   : slots x {u64 name_hash, u64 offset}                 name_hash 0 = empty
+//   content : slots x {u64 hash_lo, u64 hash_hi, u64 offset}      hash_lo 0 = empty
+//
+// Both tables are open-addressed with linear probing; slots is a power of two kept at
+// least twice the record count. Every record is in the name table (offset = byte
+// offset of its "name\tN" header); the content table keeps the first record of each
+// content hash. db_bytes is how much of the DB has been indexed and db_head a hash of
+// its first bytes: records appended behind the index's back are picked up by scanning
+// from db_bytes, and a DB that shrank or was rewritten is re-indexed from scratch.
+//
+// Hashes only select candidates; callers confirm names against the record itself.
+// One writer at a time.
+
+class TopologyIndex {
+public:
+    static constexpr char     kMagic[4]   = {'T','D','X','1'};
+    static constexpr uint32_t kVersion    = 1;
+    static constexpr size_t   kHeaderSize = 48;
+
+    struct Hash128 {
+        uint64_t lo = 0, hi = 0;
+        bool operator==(const Hash128& o) const { return lo == o.lo && hi == o.hi; }
+    };
+
+    static uint64_t nameHash(std::string_view name);
+    // Hash of a canonical payload without its "name:" line
+    static Hash128 contentHash(std::string_view payload);
+
+    explicit TopologyIndex(std::string db_path);
+    ~TopologyIndex();
+    TopologyIndex(const TopologyIndex&) = delete;
+    TopologyIndex& operator=(const TopologyIndex&) = delete;
+
+    static std::string sidecarPath(const std::string& db_path) { return db_path + ".idx"; }
+
+    // Map the sidecar, creating it or bringing it up to date with the DB.
+    // False if the DB is missing or the sidecar cannot be written.
+    bool open();
+    bool rebuild();
+    void close();
+
+    bool isOpen() const { return base_ != nullptr; }
+    uint64_t size() const;
+
+    // Offsets of the records whose name hashes like `name`, in file order
+    std::vector<uint64_t> findName(std::string_view name) const;
+    // Offset of the first record with this content hash
+    bool findContent(const Hash128& h, uint64_t& offset) const;
+
+private:
+    std::string db_path_;
+    std::string idx_path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t map_bytes_ = 0;
+
+    bool create(uint64_t slots);
+    bool mapFile();
+    bool grow();
+    bool insert(uint64_t offset, uint64_t name_hash, const Hash128& content);
+    bool catchUp();
+};
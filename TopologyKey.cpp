@@ -0,0 +1,140 @@
+#include "TopologyKey.hpp"
+#include "TopoLineCompact_enhanced.hpp"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ===== Param ids =====
+// Shared by all threads; each thread keeps the ids it has used, so the lock is only
+// taken for values new to that thread. Values in [kSmallMin, kSmallMin + kSmallSpan)
+// (block params, side link codes) are looked up in a flat table.
+namespace {
+constexpr int kSmallMin = -1024;
+constexpr int kSmallSpan = 9216;
+
+struct ParamIds {
+    std::vector<uint32_t> small = std::vector<uint32_t>(kSmallSpan, 0);   // id + 1, 0 = not yet
+    std::unordered_map<int, uint32_t> large;
+
+    static ParamIds& local() {
+        thread_local ParamIds ids;
+        return ids;
+    }
+
+    uint64_t id(int v) {
+        const bool is_small = v >= kSmallMin && v < kSmallMin + kSmallSpan;
+        if (is_small && small[v - kSmallMin]) return small[v - kSmallMin] - 1;
+        if (!is_small) {
+            auto it = large.find(v);
+            if (it != large.end()) return it->second;
+        }
+
+        static std::mutex mtx;
+        static std::unordered_map<int, uint32_t> ids;
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            id = ids.emplace(v, (uint32_t)ids.size()).first->second;
+        }
+        if (is_small) small[v - kSmallMin] = id + 1;
+        else large.emplace(v, id);
+        return id;
+    }
+};
+} // namespace
+
+// ===== Packing =====
+namespace {
+struct Packer {
+    ParamIds& ids = ParamIds::local();
+    uint64_t w[2] = {0, 0};
+    unsigned bits = 0;
+    bool over = false;
+
+    void put(uint64_t v, unsigned n) {   // the low n (<= 64) bits of v
+        if (over || bits + n > 128) { over = true; return; }
+        if (n == 0) return;
+        if (n < 64) v &= (uint64_t(1) << n) - 1;
+        const unsigned k = bits / 64, o = bits % 64;
+        w[k] |= v << o;
+        if (o && o + n > 64) w[k + 1] |= v >> (64 - o);
+        bits += n;
+    }
+    void ue(uint64_t n) {
+        if (n >= (uint64_t(1) << 62)) { over = true; return; }
+        const uint64_t x = n + 1;
+        const unsigned len = 64 - (unsigned)__builtin_clzll(x);
+        const uint64_t low = x & ((uint64_t(1) << (len - 1)) - 1);
+        if (len <= 32) {
+            put((uint64_t(1) << (len - 1)) | (low << len), 2 * len - 1);
+            return;
+        }
+        put(0, len - 1);
+        put(1, 1);
+        put(low, len - 1);
+    }
+    void se(int v) {   // zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+        ue((static_cast<uint64_t>(static_cast<int64_t>(v)) << 1) ^
+           static_cast<uint64_t>(static_cast<int64_t>(v) >> 63));
+    }
+    void param(int v) { ue(ids.id(v)); }
+};
+} // namespace
+
+TopologyKey TopologyKey::of(const Topology_enhanced& T) {
+    return of(TopologyOverlay(T));
+}
+
+TopologyKey TopologyKey::of(const TopologyOverlay& O) {
+    const Topology_enhanced& T = O.base();
+    Packer p;
+    p.ue(T.block.size());
+    p.ue(T.s_connection.size());
+    p.ue(T.i_connection.size());
+    p.ue(T.side_links.size());
+    p.ue(T.instantons.size());
+    p.ue(O.eConnectionCount());
+    p.ue(O.externalCount());
+    for (size_t i = 0; i < T.block.size() && !p.over; ++i) {
+        const unsigned kind = static_cast<unsigned>(T.block[i].kind);
+        if (kind > 7) p.over = true;
+        p.put(kind, 3);
+        p.param(T.block[i].param);
+    }
+    for (size_t i = 0; i < T.s_connection.size() && !p.over; ++i) {
+        p.se(T.s_connection[i].u);
+        p.se(T.s_connection[i].v);
+    }
+    for (size_t i = 0; i < T.i_connection.size() && !p.over; ++i) {
+        p.se(T.i_connection[i].u);
+        p.se(T.i_connection[i].v);
+    }
+    for (size_t i = 0; i < T.side_links.size() && !p.over; ++i) p.param(T.side_links[i].param);
+    for (size_t i = 0; i < T.instantons.size() && !p.over; ++i) p.param(T.instantons[i].param);
+    for (size_t i = 0; i < O.eConnectionCount() && !p.over; ++i) {
+        const auto& e = O.eConnection(i);
+        p.se(e.parent_id);
+        p.se(e.parent_type);
+        p.se(e.port_idx);
+        p.se(e.external_id);
+    }
+    for (size_t i = 0; i < O.externalCount() && !p.over; ++i) p.param(O.external(i).param);
+
+    TopologyKey k;
+    if (p.over) {
+        k.line_ = std::make_shared<const std::string>(TopoLineCompact_enhanced::serialize(O));
+        k.w_[0] = std::hash<std::string>()(*k.line_);
+        k.w_[1] = ~uint64_t(0);
+        return k;
+    }
+    k.w_[0] = p.w[0];
+    k.w_[1] = p.w[1];
+    return k;
+}
+
+size_t TopologyKey::hash() const {
+    uint64_t h = w_[0] ^ (w_[1] * 0x9e3779b97f4a7c15ULL);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<size_t>(h ^ (h >> 31));
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Topology_enhanced.h"
+#include "TopologyOverlay.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Fixed-width key of a Topology_enhanced, for hash sets, dedupe and caches
+//
+// Two topologies get equal keys exactly when their line-compact lines are equal
+// (TopoLineCompact_enhanced::serialize; the name is not part of either). The line's
+// fields are packed in order into 128 bits of Exp-Golomb codes, LSB first:
+//   counts     : blocks, S, I, side links, instantons, E, externals       ue
+//   blocks     : kind (3 bits), param id                                 ue
+//   S, I       : (u, v)                                                   se
+//   sp, ip     : param ids                                                ue
+//   E, ep      : (parent, type, port, external id), then param ids       se, ue
+// ue(n) is floor(log2(n+1)) zeros, a one and the low bits of n+1, so small counts and
+// indices take 1-5 bits; se is ue of the zigzagged value. Params are first mapped to
+// dense ids, in the order the process meets them, so the few values a run uses cost a
+// few bits whatever their size. A topology whose codes do not fit keeps its line
+// instead (overflow): still exact, equality then compares strings.
+//
+// Param ids depend on the order values were met, so keys are only meaningful inside
+// one process; anything persisted stores the line-compact line.
+class TopologyKey {
+public:
+    TopologyKey() = default;
+    static TopologyKey of(const Topology_enhanced& T);
+    static TopologyKey of(const TopologyOverlay& T);   // that of the materialized topology
+
+    bool packed() const { return !line_; }
+    size_t hash() const;
+
+    bool operator==(const TopologyKey& o) const {
+        return w_[0] == o.w_[0] && w_[1] == o.w_[1]
+            && (line_ == o.line_ || (line_ && o.line_ && *line_ == *o.line_));
+    }
+    bool operator!=(const TopologyKey& o) const { return !(*this == o); }
+
+private:
+    uint64_t w_[2] = {0, 0};                    // the codes; the line's hash on overflow
+    std::shared_ptr<const std::string> line_;  // set on overflow only
+};
+
+namespace std {
+template <> struct hash<TopologyKey> {
+    size_t operator()(const TopologyKey& k) const noexcept { return k.hash(); }
+};
+} // namespace std
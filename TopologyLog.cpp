@@ -0,0 +1,554 @@
+#include "TopologyLog.hpp"
+#include "TopologyDB_enhanced.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===== Helpers =====
+namespace {
+
+constexpr size_t kKeyRowBytes = 40;
+constexpr size_t kFlushBytes = size_t(4) << 20;
+constexpr int kSnapshotAttempts = 8;
+
+inline uint64_t ld64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void put(std::string& buf, const void* p, size_t n) {
+    buf.append(static_cast<const char*>(p), n);
+}
+
+bool write_all(int fd, const char* data, size_t n) {
+    for (size_t off = 0; off < n;) {
+        const ssize_t w = ::write(fd, data + off, n - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        off += (size_t)w;
+    }
+    return true;
+}
+
+// New file with the given contents, on disk before returning
+bool write_file_synced(const std::string& path, std::string_view content) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const bool ok = write_all(fd, content.data(), content.size()) && fdatasync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+void sync_dir(const std::string& dir) {
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    ::close(fd);
+}
+
+// A log being appended to may end in a partial line; readers stop before it
+std::string_view complete_lines(std::string_view s) {
+    const size_t nl = s.rfind('\n');
+    return nl == std::string_view::npos ? std::string_view() : s.substr(0, nl + 1);
+}
+
+std::string_view record_name(const TopologyDB_enhanced::Record& r) {
+    return r.topo.name.empty() ? r.name : r.topo.name;
+}
+
+struct KeyHash {
+    size_t operator()(const TopologyDB_enhanced::Key128& k) const { return (size_t)k.lo; }
+};
+
+// Segment files written side by side; both synced by finish()
+class SegmentWriter {
+public:
+    ~SegmentWriter() { if (fd_ >= 0) ::close(fd_); }
+
+    bool open(std::string db_path, std::string key_path) {
+        db_path_ = std::move(db_path);
+        key_path_ = std::move(key_path);
+        fd_ = ::open(db_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd_ >= 0;
+    }
+
+    bool add(uint64_t seq, const TopologyDB_enhanced::Record& r, const TopologyDB_enhanced::Key128& content) {
+        TopologyDB_enhanced::serializeCanonicalInto(buf_, r.topo, true);
+        const auto name = TopologyDB_enhanced::nameKey(record_name(r));
+        put(keys_, &seq, 8);
+        put(keys_, &content.lo, 8);
+        put(keys_, &content.hi, 8);
+        put(keys_, &name.lo, 8);
+        put(keys_, &name.hi, 8);
+        ++count_;
+        if (buf_.size() < kFlushBytes) return true;
+        const bool ok = write_all(fd_, buf_.data(), buf_.size());
+        buf_.clear();
+        return ok;
+    }
+
+    bool finish() {
+        bool ok = write_all(fd_, buf_.data(), buf_.size()) && fdatasync(fd_) == 0;
+        ::close(fd_);
+        fd_ = -1;
+        std::string header(TopologyLog::kKeyMagic, 4);
+        put(header, &TopologyLog::kVersion, 4);
+        put(header, &count_, 8);
+        return ok && write_file_synced(key_path_, header + keys_);
+    }
+
+    void discard() const {
+        std::error_code ec;
+        std::filesystem::remove(db_path_, ec);
+        std::filesystem::remove(key_path_, ec);
+    }
+
+    uint64_t count() const { return count_; }
+
+private:
+    std::string db_path_, key_path_;
+    int fd_ = -1;
+    std::string buf_, keys_;
+    uint64_t count_ = 0;
+};
+
+} // namespace
+
+// ===== Mapping =====
+TopologyLog::Mapping::~Mapping() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+}
+
+TopologyLog::Mapping::Mapping(Mapping&& o) noexcept : data_(o.data_), size_(o.size_) {
+    o.data_ = nullptr;
+    o.size_ = 0;
+}
+
+TopologyLog::Mapping& TopologyLog::Mapping::operator=(Mapping&& o) noexcept {
+    if (this != &o) {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        data_ = o.data_;
+        size_ = o.size_;
+        o.data_ = nullptr;
+        o.size_ = 0;
+    }
+    return *this;
+}
+
+bool TopologyLog::Mapping::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    const size_t size = ok ? (size_t)st.st_size : 0;
+    if (ok && size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = p != MAP_FAILED;
+        if (ok) {
+            madvise(p, size, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+            size_ = size;
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+// ===== Lock =====
+TopologyLog::Lock::Lock(const std::string& path, bool wait) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) return;
+    int rc;
+    do rc = flock(fd_, wait ? LOCK_EX : LOCK_EX | LOCK_NB);
+    while (rc != 0 && errno == EINTR);
+    if (rc != 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+TopologyLog::Lock::~Lock() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+// ===== Manifest =====
+bool TopologyLog::isLogDir(const std::string& path) {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(std::filesystem::path(path) / "MANIFEST", ec);
+}
+
+std::string TopologyLog::keyFile(const std::string& segment_file) {
+    return std::filesystem::path(segment_file).replace_extension(".key").string();
+}
+
+std::string TopologyLog::newFile(Manifest& m, const char* prefix, const char* ext) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s-%06llu%s", prefix, (unsigned long long)m.next_file++, ext);
+    return name;
+}
+
+bool TopologyLog::create(const std::string& dir) {
+    if (isLogDir(dir)) return true;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (!std::filesystem::is_directory(dir, ec) || !std::filesystem::is_empty(dir, ec)) {
+        std::cerr << "[Error] " << dir << " exists and is not a log-structured DB\n";
+        return false;
+    }
+    TopologyLog log(dir);
+    Manifest m;
+    m.logs.push_back({log.newFile(m, "log", ".db"), 0});
+    m.tombstones = log.newFile(m, "tomb", ".seq");
+    return write_file_synced(log.file(m.logs.back().file), {})
+        && write_file_synced(log.file(m.tombstones), {})
+        && log.writeManifest(m);
+}
+
+bool TopologyLog::readManifest(Manifest& m) const {
+    std::ifstream in(file("MANIFEST"));
+    std::string line;
+    if (!std::getline(in, line) || line != "TLOG 1") return false;
+    m = Manifest();
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string kind;
+        if (!(ls >> kind)) continue;
+        bool ok = true;
+        if (kind == "next_file") ok = bool(ls >> m.next_file);
+        else if (kind == "segment") {
+            Segment s;
+            ok = bool(ls >> s.file >> s.first_seq >> s.count);
+            m.segments.push_back(s);
+        } else if (kind == "log") {
+            Log l;
+            ok = bool(ls >> l.file >> l.first_seq);
+            m.logs.push_back(l);
+        } else if (kind == "tombstones") ok = bool(ls >> m.tombstones);
+        if (!ok) return false;
+    }
+    return !m.logs.empty() && !m.tombstones.empty();
+}
+
+bool TopologyLog::writeManifest(const Manifest& m) const {
+    std::ostringstream os;
+    os << "TLOG 1\n" << "next_file " << m.next_file << "\n";
+    for (const auto& s : m.segments) os << "segment " << s.file << ' ' << s.first_seq << ' ' << s.count << "\n";
+    for (const auto& l : m.logs) os << "log " << l.file << ' ' << l.first_seq << "\n";
+    os << "tombstones " << m.tombstones << "\n";
+
+    const std::string tmp = file("MANIFEST.tmp");
+    if (!write_file_synced(tmp, os.str())) return false;
+    std::error_code ec;
+    std::filesystem::rename(tmp, file("MANIFEST"), ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    sync_dir(dir_);
+    return true;
+}
+
+// Files of a crashed compaction or a failed write; only the COMPACT holder creates them
+void TopologyLog::removeOrphans(const Manifest& m) const {
+    std::unordered_set<std::string> live{m.tombstones};
+    for (const auto& s : m.segments) {
+        live.insert(s.file);
+        live.insert(keyFile(s.file));
+    }
+    for (const auto& l : m.logs) live.insert(l.file);
+
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(dir_, ec)) {
+        const std::string name = e.path().filename().string();
+        const bool ours = name.rfind("seg-", 0) == 0 || name.rfind("log-", 0) == 0
+                       || name.rfind("tomb-", 0) == 0 || name == "MANIFEST.tmp";
+        if (ours && !live.count(name)) std::filesystem::remove(e.path(), ec);
+    }
+}
+
+// ===== Snapshot =====
+bool TopologyLog::Snapshot::open(const TopologyLog& log) {
+    // A compaction may delete files between reading the manifest and opening them
+    for (int attempt = 0; attempt < kSnapshotAttempts; ++attempt)
+        if (tryOpen(log)) return true;
+    parts_.clear();
+    return false;
+}
+
+bool TopologyLog::Snapshot::tryOpen(const TopologyLog& log) {
+    parts_.clear();
+    tombstones_.clear();
+    if (!log.readManifest(m_)) return false;
+
+    parts_.resize(m_.segments.size() + m_.logs.size());
+    for (size_t i = 0; i < m_.segments.size(); ++i) {
+        Part& p = parts_[i];
+        if (!p.file.open(log.file(m_.segments[i].file)) || !p.keys.open(log.file(keyFile(m_.segments[i].file))))
+            return false;
+        const std::string_view k = p.keys.view();
+        if (k.size() < kKeyHeader || std::memcmp(k.data(), kKeyMagic, 4) != 0
+            || k.size() < kKeyHeader + ld64(k.data() + 8) * kKeyRowBytes) return false;
+        p.text = p.file.view();
+    }
+    for (size_t i = 0; i < m_.logs.size(); ++i) {
+        Part& p = parts_[m_.segments.size() + i];
+        if (!p.file.open(log.file(m_.logs[i].file))) return false;
+        p.text = complete_lines(p.file.view());
+    }
+
+    Mapping t;
+    if (!t.open(log.file(m_.tombstones))) return false;
+    const std::string_view v = t.view();
+    tombstones_.resize(v.size() / 8);
+    if (!tombstones_.empty()) std::memcpy(tombstones_.data(), v.data(), tombstones_.size() * 8);
+    std::sort(tombstones_.begin(), tombstones_.end());
+    return true;
+}
+
+uint64_t TopologyLog::Snapshot::firstSeq(size_t part) const {
+    return isSegment(part) ? m_.segments[part].first_seq : m_.logs[part - m_.segments.size()].first_seq;
+}
+
+uint64_t TopologyLog::Snapshot::endSeq(size_t part) const {
+    return part + 1 < parts_.size() ? firstSeq(part + 1) : UINT64_MAX;
+}
+
+uint64_t TopologyLog::Snapshot::keyRows(size_t part) const {
+    return isSegment(part) ? ld64(parts_[part].keys.view().data() + 8) : 0;
+}
+
+TopologyLog::KeyRow TopologyLog::Snapshot::keyRow(size_t part, uint64_t i) const {
+    KeyRow r;
+    std::memcpy(&r, parts_[part].keys.view().data() + kKeyHeader + i * kKeyRowBytes, sizeof(r));
+    return r;
+}
+
+uint64_t TopologyLog::Snapshot::seqOf(size_t part, uint64_t ordinal) const {
+    if (!isSegment(part)) return firstSeq(part) + ordinal;
+    return ordinal < keyRows(part) ? keyRow(part, ordinal).seq : UINT64_MAX;
+}
+
+bool TopologyLog::Snapshot::removed(uint64_t seq) const {
+    return std::binary_search(tombstones_.begin(), tombstones_.end(), seq);
+}
+
+size_t TopologyLog::Snapshot::removedIn(uint64_t from, uint64_t to) const {
+    return (size_t)(std::lower_bound(tombstones_.begin(), tombstones_.end(), to)
+                  - std::lower_bound(tombstones_.begin(), tombstones_.end(), from));
+}
+
+// ===== Writers =====
+int TopologyLog::openActiveLog(std::string& path) const {
+    // The log may be sealed while we wait for its lock; then retry on the new one
+    for (int attempt = 0; attempt < kSnapshotAttempts; ++attempt) {
+        Manifest m;
+        if (!readManifest(m)) return -1;
+        path = file(m.logs.back().file);
+        const int fd = ::open(path.c_str(), O_RDWR | O_APPEND);
+        if (fd < 0) continue;
+        int rc;
+        do rc = flock(fd, LOCK_EX);
+        while (rc != 0 && errno == EINTR);
+        Manifest now;
+        if (rc == 0 && readManifest(now) && now.logs.back().file == m.logs.back().file) return fd;
+        ::close(fd);
+        if (rc != 0) return -1;
+    }
+    return -1;
+}
+
+// New empty active log behind the current one, unless it is empty or a Writer holds it
+bool TopologyLog::sealActiveLog(Manifest& m) const {
+    const Log active = m.logs.back();
+    const int fd = ::open(file(active.file).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        return true;
+    }
+
+    Mapping map;
+    uint64_t n = 0;
+    bool ok = map.open(file(active.file));
+    if (ok) {
+        const std::string_view text = complete_lines(map.view());
+        TopologyDB_enhanced::Record r;
+        for (size_t pos = 0; TopologyDB_enhanced::parseNextRecord(text, pos, r);) ++n;
+
+        Manifest next = m;
+        next.logs.push_back({newFile(next, "log", ".db"), active.first_seq + n});
+        ok = write_file_synced(file(next.logs.back().file), {}) && writeManifest(next);
+        if (ok) m = std::move(next);
+    }
+    ::close(fd);
+    return ok;
+}
+
+// ===== Dedupe =====
+int TopologyLog::dedupe(bool by_name, bool keep_last) const {
+    Lock busy(file("COMPACT"), true);
+    Snapshot snap;
+    if (!busy.held() || !snap.open(*this)) return -1;
+
+    // Live keys: segments from their key files, logs parsed
+    struct Entry {
+        uint64_t lo, hi, seq;
+    };
+    std::vector<Entry> keys;
+    TopologyDB_enhanced::Record r;
+    for (size_t p = 0; p < snap.parts(); ++p) {
+        if (snap.isSegment(p)) {
+            for (uint64_t i = 0; i < snap.keyRows(p); ++i) {
+                const KeyRow k = snap.keyRow(p, i);
+                if (snap.removed(k.seq)) continue;
+                keys.push_back(by_name ? Entry{k.name_lo, k.name_hi, k.seq} : Entry{k.content_lo, k.content_hi, k.seq});
+            }
+            continue;
+        }
+        const std::string_view text = snap.text(p);
+        uint64_t ord = 0;
+        for (size_t pos = 0; TopologyDB_enhanced::parseNextRecord(text, pos, r);) {
+            const uint64_t seq = snap.seqOf(p, ord++);
+            if (snap.removed(seq)) continue;
+            const auto k = by_name ? TopologyDB_enhanced::nameKey(record_name(r)) : TopologyDB_enhanced::contentKey(r.topo);
+            keys.push_back(Entry{k.lo, k.hi, seq});
+        }
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const Entry& a, const Entry& b) {
+        if (a.hi != b.hi) return a.hi < b.hi;
+        if (a.lo != b.lo) return a.lo < b.lo;
+        return a.seq < b.seq;
+    });
+    std::vector<uint64_t> dropped;
+    for (size_t i = 0; i < keys.size();) {
+        size_t j = i + 1;
+        while (j < keys.size() && keys[j].hi == keys[i].hi && keys[j].lo == keys[i].lo) ++j;
+        const size_t keep = keep_last ? j - 1 : i;
+        for (size_t k = i; k < j; ++k)
+            if (k != keep) dropped.push_back(keys[k].seq);
+        i = j;
+    }
+    if (dropped.empty()) return 0;
+
+    const int fd = ::open(file(snap.manifest().tombstones).c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) return -1;
+    const bool ok = write_all(fd, reinterpret_cast<const char*>(dropped.data()), dropped.size() * 8)
+                 && fdatasync(fd) == 0;
+    ::close(fd);
+    return ok ? (int)dropped.size() : -1;
+}
+
+// ===== Compaction =====
+int TopologyLog::compact(bool full, bool dedupe) const {
+    Lock busy(file("COMPACT"), false);
+    if (!busy.held()) {
+        std::cerr << "[Warning] " << dir_ << " is already being compacted or deduplicated\n";
+        return 0;
+    }
+    Manifest m;
+    if (!readManifest(m)) return -1;
+    removeOrphans(m);
+    if (!sealActiveLog(m)) return -1;
+
+    Snapshot snap;
+    if (!snap.open(*this)) return -1;
+    const Manifest& cur = snap.manifest();
+    const size_t nseg = cur.segments.size();
+    const size_t active = snap.parts() - 1;
+
+    // Inputs: every sealed log, then segments from the newest back (size-tiered)
+    uint64_t merged = 0;
+    for (size_t p = nseg; p < active; ++p) merged += snap.text(p).size();
+    size_t first = nseg;
+    while (first > 0) {
+        const size_t p = first - 1;
+        const uint64_t bytes = snap.text(p).size();
+        if (!full && bytes > 2 * merged && snap.removedIn(snap.firstSeq(p), snap.endSeq(p)) == 0) break;
+        merged += bytes;
+        first = p;
+    }
+    if (first == active) return 0;
+    const uint64_t lo = snap.firstSeq(first), hi = snap.firstSeq(active);
+    if (first + 1 == active && nseg == active && snap.removedIn(lo, hi) == 0) return 0;   // one clean segment
+
+    // Content already stored in the older segments
+    std::unordered_set<TopologyDB_enhanced::Key128, KeyHash> seen;
+    if (dedupe) {
+        for (size_t p = 0; p < first; ++p) {
+            for (uint64_t i = 0; i < snap.keyRows(p); ++i) {
+                const KeyRow k = snap.keyRow(p, i);
+                if (!snap.removed(k.seq)) seen.insert({k.content_lo, k.content_hi});
+            }
+        }
+    }
+
+    Manifest next = cur;
+    const std::string seg = newFile(next, "seg", ".db");
+    SegmentWriter out;
+    if (!out.open(file(seg), file(keyFile(seg)))) return -1;
+    int dropped = 0;
+    bool ok = true;
+    TopologyDB_enhanced::Record r;
+    for (size_t p = first; p < active && ok; ++p) {
+        const std::string_view text = snap.text(p);
+        uint64_t ord = 0;
+        for (size_t pos = 0; ok && TopologyDB_enhanced::parseNextRecord(text, pos, r);) {
+            const uint64_t seq = snap.seqOf(p, ord++);
+            const auto content = TopologyDB_enhanced::contentKey(r.topo);
+            if (snap.removed(seq) || (dedupe && !seen.insert(content).second)) {
+                ++dropped;
+                continue;
+            }
+            ok = out.add(seq, r, content);
+        }
+    }
+    if (!ok || !out.finish()) {
+        out.discard();
+        std::cerr << "[Error] Cannot write segment " << file(seg) << "\n";
+        return -1;
+    }
+
+    next.segments.erase(next.segments.begin() + (std::ptrdiff_t)first, next.segments.end());
+    if (out.count() > 0) next.segments.push_back({seg, lo, out.count()});
+    next.logs.erase(next.logs.begin(), next.logs.end() - 1);
+
+    // Tombstones of the merged range are spent
+    if (snap.removedIn(lo, hi) > 0) {
+        std::string keep;
+        for (uint64_t t : snap.tombstones())
+            if (t < lo || t >= hi) put(keep, &t, 8);
+        next.tombstones = newFile(next, "tomb", ".seq");
+        ok = write_file_synced(file(next.tombstones), keep);
+    }
+    if (!ok || !writeManifest(next)) {
+        out.discard();
+        std::cerr << "[Error] Cannot update the manifest of " << dir_ << "\n";
+        return -1;
+    }
+    if (out.count() == 0) out.discard();
+
+    // Open snapshots keep their mappings of the inputs
+    std::error_code ec;
+    for (size_t p = first; p < nseg; ++p) {
+        std::filesystem::remove(file(cur.segments[p].file), ec);
+        std::filesystem::remove(file(keyFile(cur.segments[p].file)), ec);
+    }
+    for (size_t l = 0; l + 1 < cur.logs.size(); ++l) std::filesystem::remove(file(cur.logs[l].file), ec);
+    if (next.tombstones != cur.tombstones) std::filesystem::remove(file(cur.tombstones), ec);
+    return dropped;
+}
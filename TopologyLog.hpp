@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Log-structured TopologyDB_enhanced backend: a directory of immutable segments, an
+// append log and a tombstone list, tied together by a manifest
+//
+//   MANIFEST        "TLOG 1", then one entry per line, replaced atomically (tmp + rename):
+//                     next_file <n>
+//                     segment <file> <first_seq> <count>     oldest first
+//                     log <file> <first_seq>                 sealed logs, the active one last
+//                     tombstones <file>
+//   seg-N.db        segment records in the text DB format, ascending sequence numbers
+//   seg-N.key       "TSK1" | u32 version | u64 count, then count x {u64 seq, u64 content_lo,
+//                   u64 content_hi, u64 name_lo, u64 name_hi} in record order  (40 bytes)
+//   log-N.db        append log in the text DB format; its records are first_seq, first_seq+1, ...
+//   tomb-N.seq      append-only u64 sequence numbers of removed records
+//   LOCK, COMPACT   flock targets
+//
+// Every record gets a sequence number when it is appended, and segments and logs cover
+// consecutive ranges of them, so reading the parts in manifest order yields the records in
+// insertion order. Keys are TopologyDB_enhanced::contentKey / nameKey.
+//
+// Readers take a Snapshot: the manifest is read once and every file it names is mapped,
+// logs up to their last complete line. Files are never modified once sealed and are
+// unlinked only after a newer manifest stops naming them, so a snapshot stays valid while
+// compaction runs. Writers append to the active log holding an flock on it; compaction
+// and dedupe serialize on COMPACT, the only manifest writers.
+//
+// Removal never rewrites data: dedupe appends the sequence numbers it drops to the
+// tombstone file, reading segment keys from their key files and parsing only the logs.
+// compact() seals the active log (when no Writer holds it), merges the sealed logs and the
+// newest segments into one segment without the tombstoned records (and, optionally, without
+// content already stored), swaps the manifest and then deletes the inputs. Segments are
+// merged size-tiered: the newest ones while no larger than twice what is merged so far.
+
+class TopologyLog {
+public:
+    static constexpr char     kKeyMagic[4] = {'T','S','K','1'};
+    static constexpr uint32_t kVersion     = 1;
+    static constexpr size_t   kKeyHeader   = 16;
+
+    struct Segment {
+        std::string file;
+        uint64_t first_seq = 0, count = 0;
+    };
+    struct Log {
+        std::string file;
+        uint64_t first_seq = 0;
+    };
+    struct Manifest {
+        uint64_t next_file = 1;
+        std::vector<Segment> segments;
+        std::vector<Log> logs;          // never empty: the last one is active
+        std::string tombstones;
+    };
+
+    struct KeyRow {
+        uint64_t seq;
+        uint64_t content_lo, content_hi;
+        uint64_t name_lo, name_hi;
+    };
+
+    // Read-only mapping of one file
+    class Mapping {
+    public:
+        Mapping() = default;
+        ~Mapping();
+        Mapping(Mapping&& o) noexcept;
+        Mapping& operator=(Mapping&& o) noexcept;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        bool open(const std::string& path);
+        std::string_view view() const { return {data_ ? data_ : "", size_}; }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Consistent view of the DB: parts are the segments then the logs, in manifest order
+    class Snapshot {
+    public:
+        bool open(const TopologyLog& log);
+
+        const Manifest& manifest() const { return m_; }
+        size_t parts() const { return parts_.size(); }
+        bool isSegment(size_t part) const { return part < m_.segments.size(); }
+        std::string_view text(size_t part) const { return parts_[part].text; }
+        uint64_t firstSeq(size_t part) const;
+        uint64_t endSeq(size_t part) const;   // first_seq of the next part; UINT64_MAX for the active log
+
+        // Sequence number of the ordinal-th record parsed from a part
+        uint64_t seqOf(size_t part, uint64_t ordinal) const;
+        uint64_t keyRows(size_t part) const;
+        KeyRow keyRow(size_t part, uint64_t i) const;
+
+        bool removed(uint64_t seq) const;
+        size_t removedIn(uint64_t from, uint64_t to) const;
+        const std::vector<uint64_t>& tombstones() const { return tombstones_; }
+
+    private:
+        struct Part {
+            Mapping file, keys;
+            std::string_view text;
+        };
+        Manifest m_;
+        std::vector<Part> parts_;
+        std::vector<uint64_t> tombstones_;   // sorted
+
+        bool tryOpen(const TopologyLog& log);
+    };
+
+    // flock held for the object's lifetime
+    class Lock {
+    public:
+        Lock(const std::string& path, bool wait);
+        ~Lock();
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+        bool held() const { return fd_ >= 0; }
+
+    private:
+        int fd_ = -1;
+    };
+
+    static bool isLogDir(const std::string& path);
+    // Empty log-structured DB; an existing one is left alone
+    static bool create(const std::string& dir);
+
+    explicit TopologyLog(std::string dir) : dir_(std::move(dir)) {}
+
+    const std::string& dir() const { return dir_; }
+    std::string file(const std::string& name) const { return dir_ + "/" + name; }
+    static std::string keyFile(const std::string& segment_file);
+
+    bool readManifest(Manifest& m) const;
+    bool writeManifest(const Manifest& m) const;
+
+    // Log file a Writer should append to, opened O_APPEND and flocked; -1 on failure
+    int openActiveLog(std::string& path) const;
+
+    // Tombstone duplicates; returns records removed, -1 on failure
+    int dedupe(bool by_name, bool keep_last) const;
+    // Returns records dropped, 0 if another compaction is running, -1 on failure
+    int compact(bool full, bool dedupe) const;
+
+private:
+    std::string dir_;
+
+    std::string newFile(Manifest& m, const char* prefix, const char* ext) const;
+    bool sealActiveLog(Manifest& m) const;
+    void removeOrphans(const Manifest& m) const;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include "Topology_enhanced.h"
+#include "SmallVector.hpp"
+#include <cstddef>
+
+// A topology seen as an immutable base plus added external curves
+//
+// Variant generation attaches a few externals to one base many times over. Instead of
+// copying the base's eight vectors per variant, an overlay points at the base and keeps
+// only the added externals and E connections, the first kInline of each in place. The
+// view it presents is that of the copy it stands for: externals are the base's followed
+// by the added ones (ids continue from base().externals.size()), E connections likewise.
+//
+// The line-compact serializer and validator (TopoLineCompact_enhanced), TopologyKey,
+// TopoDeltaEncoder and the generators' intersection-form builders take overlays
+// directly; materialize() makes the full topology, name included, when one is needed.
+// The base must outlive the overlay and not change while it is in use.
+class TopologyOverlay {
+public:
+    static constexpr size_t kInline = 4;
+
+    explicit TopologyOverlay(const Topology_enhanced& base) : base_(&base) {}
+
+    // Back to the bare base (or another one), keeping nothing added
+    void reset(const Topology_enhanced& base) {
+        base_ = &base;
+        ext_.clear();
+        conn_.clear();
+    }
+
+    const Topology_enhanced& base() const { return *base_; }
+
+    // Topology_enhanced::addExternal / attachExternal over the combined view
+    int addExternal(int param = 0) {
+        ext_.push_back(External{param});
+        return static_cast<int>(externalCount()) - 1;
+    }
+    bool attachExternal(int external_id, int parent_id, int parent_type, int port_idx = 0) {
+        if (external_id < 0 || external_id >= static_cast<int>(externalCount())) return false;
+        int n;
+        switch (parent_type) {
+            case 0: n = static_cast<int>(base_->block.size()); break;
+            case 1: n = static_cast<int>(base_->side_links.size()); break;
+            case 2: n = static_cast<int>(base_->instantons.size()); break;
+            default: return false;
+        }
+        if (parent_id < 0 || parent_id >= n) return false;
+        conn_.push_back({parent_id, parent_type, port_idx, external_id});
+        return true;
+    }
+
+    size_t externalCount() const { return base_->externals.size() + ext_.size(); }
+    const External& external(size_t i) const {
+        const size_t nb = base_->externals.size();
+        return i < nb ? base_->externals[i] : ext_[i - nb];
+    }
+    size_t eConnectionCount() const { return base_->e_connection.size() + conn_.size(); }
+    const ExternalStructure& eConnection(size_t i) const {
+        const size_t nb = base_->e_connection.size();
+        return i < nb ? base_->e_connection[i] : conn_[i - nb];
+    }
+
+    // The full topology (a copy of the base with the additions); out keeps its capacity
+    void materializeInto(Topology_enhanced& out) const {
+        out = *base_;
+        out.externals.insert(out.externals.end(), ext_.begin(), ext_.end());
+        out.e_connection.insert(out.e_connection.end(), conn_.begin(), conn_.end());
+    }
+    Topology_enhanced materialize() const {
+        Topology_enhanced out;
+        materializeInto(out);
+        return out;
+    }
+
+private:
+    const Topology_enhanced* base_;
+    SmallVector<External, kInline> ext_;
+    SmallVector<ExternalStructure, kInline> conn_;
+};
@@ -0,0 +1,328 @@
+#include "TopologyShards.hpp"
+#include "LineIngest.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// ===== Helpers =====
+static char kind_letter(LKind k) {
+    switch (k) {
+        case LKind::g: return 'g';
+        case LKind::L: return 'L';
+        case LKind::S: return 'S';
+        case LKind::I: return 'I';
+        case LKind::E: return 'E';
+    }
+    return '?';
+}
+
+// A category becomes a directory name: one path component, no blanks
+static bool valid_category(const std::string& c) {
+    if (c == "." || c == "..") return false;
+    for (unsigned char ch : c)
+        if (ch == '/' || std::isspace(ch)) return false;
+    return true;
+}
+
+static int resolve_threads(int threads) {
+    return threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs job(worker, i) for i in [0, n) on `workers` threads, the calling thread being worker 0
+template <class Job>
+static void run_pool(size_t n, int workers, const Job& job) {
+    std::atomic<size_t> next{0};
+    auto work = [&](int w) {
+        for (size_t i; (i = next.fetch_add(1)) < n;) job(w, i);
+    };
+    std::vector<std::thread> pool;
+    for (int w = 1; w < workers; ++w) pool.emplace_back(work, w);
+    work(0);
+    for (auto& t : pool) t.join();
+}
+
+// ===== Keys =====
+bool TopologyShards::Filter::matches(const Key& k) const {
+    if (!category.empty() && category != k.category) return false;
+    if (blocks >= 0 && blocks != k.blocks) return false;
+    return k.kinds.compare(0, kinds.size(), kinds) == 0;
+}
+
+TopologyShards::Key TopologyShards::keyOf(const Topology_enhanced& T, const std::string& category) {
+    Key k;
+    k.category = category;
+    k.blocks = (int)T.block.size();
+    k.kinds.reserve(T.block.size());
+    for (const auto& b : T.block) k.kinds.push_back(kind_letter(b.kind));
+    return k;
+}
+
+std::string TopologyShards::shardPath(const Key& k) {
+    return (k.category.empty() ? std::string("_") : k.category) + "/len-" + std::to_string(k.blocks) + "/"
+         + (k.kinds.empty() ? std::string("-") : k.kinds) + ".db";
+}
+
+bool TopologyShards::isShardRoot(const std::string& dir) {
+    std::error_code ec;
+    return fs::is_regular_file(fs::path(dir) / "SHARDS", ec);
+}
+
+// ===== Manifest =====
+TopologyShards::TopologyShards(std::string root) : root_(std::move(root)) {}
+
+bool TopologyShards::open() {
+    shards_.clear();
+    std::ifstream in(root_ + "/SHARDS");
+    if (!in) return !fs::exists(root_) || fs::is_directory(root_);
+
+    std::string line;
+    if (!std::getline(in, line) || line != "TSHD 1") {
+        std::cerr << "[Error] " << root_ << "/SHARDS is not a shard manifest\n";
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string tag;
+        Shard s;
+        if (!(ls >> tag) || tag != "shard") continue;
+        if (!(ls >> s.key.category >> s.key.blocks >> s.key.kinds >> s.records)) return false;
+        ls.get();
+        std::getline(ls, s.path);
+        if (s.key.category == "_") s.key.category.clear();
+        if (s.key.kinds == "-") s.key.kinds.clear();
+        shards_.push_back(std::move(s));
+    }
+    std::sort(shards_.begin(), shards_.end(), [](const Shard& a, const Shard& b) { return a.key < b.key; });
+    return true;
+}
+
+bool TopologyShards::writeManifest() const {
+    std::error_code ec;
+    fs::create_directories(root_, ec);
+    const std::string path = root_ + "/SHARDS", tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        out << "TSHD 1\n";
+        for (const auto& s : shards_) {
+            out << "shard " << (s.key.category.empty() ? "_" : s.key.category) << ' ' << s.key.blocks << ' '
+                << (s.key.kinds.empty() ? "-" : s.key.kinds) << ' ' << s.records << ' ' << s.path << "\n";
+        }
+        if (!out.good()) return false;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+TopologyShards::Shard& TopologyShards::shardFor(const Key& k) {
+    auto it = std::lower_bound(shards_.begin(), shards_.end(), k,
+                               [](const Shard& s, const Key& key) { return s.key < key; });
+    if (it == shards_.end() || !(it->key == k)) it = shards_.insert(it, Shard{k, shardPath(k), 0});
+    return *it;
+}
+
+std::vector<const TopologyShards::Shard*> TopologyShards::select(const Filter& f) const {
+    std::vector<const Shard*> out;
+    for (const auto& s : shards_)
+        if (f.matches(s.key)) out.push_back(&s);
+    return out;
+}
+
+uint64_t TopologyShards::count(const Filter& f) const {
+    uint64_t n = 0;
+    for (const Shard* s : select(f)) n += s->records;
+    return n;
+}
+
+// ===== Writer =====
+struct TopologyShards::Writer::Open {
+    Key key;
+    TopologyDB_enhanced db;
+    TopologyDB_enhanced::Writer w;
+    Open(Key k, std::string path) : key(std::move(k)), db(std::move(path)), w(db) {}
+};
+
+TopologyShards::Writer::Writer(TopologyShards& db) : db_(db) {
+    failed_ = !db_.open();
+}
+
+TopologyShards::Writer::~Writer() {
+    close();
+}
+
+bool TopologyShards::Writer::append(const Topology_enhanced& T, const std::string& category) {
+    if (failed_) return false;
+    Key k = keyOf(T, category);
+    if (!last_ || !(last_->key == k)) {
+        auto it = open_.find(k);
+        if (it == open_.end()) {
+            if (!valid_category(category)) {
+                std::cerr << "[Error] Bad shard category '" << category << "'\n";
+                return false;
+            }
+            const std::string path = db_.root_ + "/" + shardPath(k);
+            std::error_code ec;
+            fs::create_directories(fs::path(path).parent_path(), ec);
+            auto o = std::make_unique<Open>(k, path);
+            if (!o->w.isOpen()) {
+                failed_ = true;
+                return false;
+            }
+            it = open_.emplace(std::move(k), std::move(o)).first;
+        }
+        last_ = it->second.get();
+    }
+    if (!last_->w.append(T)) return false;
+    ++appended_;
+    return true;
+}
+
+bool TopologyShards::Writer::close() {
+    if (open_.empty()) return !failed_;
+    bool ok = !failed_;
+    for (auto& [key, o] : open_) {
+        ok = o->w.close() && ok;
+        db_.shardFor(key).records += o->w.appended();
+    }
+    open_.clear();
+    last_ = nullptr;
+    if (!db_.writeManifest()) {
+        std::cerr << "[Error] Cannot write " << db_.root_ << "/SHARDS\n";
+        ok = false;
+    }
+    failed_ = !ok;
+    return ok;
+}
+
+bool TopologyShards::append(const Topology_enhanced& T, const std::string& category) {
+    Writer w(*this);
+    return w.append(T, category) && w.close();
+}
+
+// ===== Scans =====
+int TopologyShards::workers(const Filter& f, int threads) const {
+    return std::max(1, std::min(resolve_threads(threads), (int)select(f).size()));
+}
+
+bool TopologyShards::forEach(const Filter& f, const Visitor& fn, int threads) const {
+    // Largest shards first, so the last one to finish is a small one; a single worker
+    // goes in key order
+    std::vector<const Shard*> picked = select(f);
+    const int n = workers(f, threads);
+    if (n > 1) {
+        std::stable_sort(picked.begin(), picked.end(),
+                         [](const Shard* a, const Shard* b) { return a->records > b->records; });
+    }
+
+    std::atomic<bool> ok{true};
+    run_pool(picked.size(), n, [&](int w, size_t i) {
+        const Shard& s = *picked[i];
+        TopologyDB_enhanced db(file(s));
+        TopologyDB_enhanced::Cursor c(db);
+        if (!c.isOpen()) {
+            std::cerr << "[Error] Cannot read shard " << file(s) << "\n";
+            ok = false;
+            return;
+        }
+        TopologyDB_enhanced::Record r;
+        while (c.next(r)) fn(w, s, r);
+    });
+    return ok;
+}
+
+int TopologyShards::dedupeByContentHash(int threads) {
+    if (!open()) return 0;
+    const int n = std::max(1, std::min(resolve_threads(threads), (int)shards_.size()));
+    std::vector<int> removed(shards_.size(), 0);
+    run_pool(shards_.size(), n, [&](int, size_t i) {
+        removed[i] = TopologyDB_enhanced(file(shards_[i]))
+                         .dedupeByContentHash(false, TopologyDB_enhanced::kDedupeMemoryBytes / (size_t)n);
+    });
+    int total = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i].records -= std::min<uint64_t>(shards_[i].records, (uint64_t)removed[i]);
+        total += removed[i];
+    }
+    return writeManifest() ? total : 0;
+}
+
+bool TopologyShards::recount(int threads) {
+    if (!open()) return false;
+    std::vector<uint64_t> counts(shards_.size(), 0);
+    std::atomic<bool> ok{true};
+    run_pool(shards_.size(), std::max(1, std::min(resolve_threads(threads), (int)shards_.size())),
+             [&](int, size_t i) {
+        uint64_t n = 0;
+        if (!TopologyDB_enhanced(file(shards_[i])).forEach([&](TopologyDB_enhanced::Record&) { ++n; })) ok = false;
+        counts[i] = n;
+    });
+    for (size_t i = 0; i < shards_.size(); ++i) shards_[i].records = counts[i];
+    return ok && writeManifest();
+}
+
+// ===== Import =====
+long long TopologyShards::importTree(const std::string& tree, int threads) {
+    threads = resolve_threads(threads);
+
+    // <CATEGORY>/len-N/*.txt, in a stable order
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(tree, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        const fs::path& p = it->path();
+        if (!it->is_regular_file() || (p.extension() != ".txt" && p.extension() != ".txtz")) continue;
+        const std::string len_dir = p.parent_path().filename().string();
+        if (len_dir.rfind("len-", 0) == 0 && p.parent_path().has_parent_path()) files.push_back(p);
+    }
+    if (ec) {
+        std::cerr << "[Error] Cannot walk " << tree << ": " << ec.message() << "\n";
+        return -1;
+    }
+    std::sort(files.begin(), files.end());
+
+    Writer w(*this);
+    bool ok = true;
+    for (const auto& p : files) {
+        const std::string category = p.parent_path().parent_path().filename().string();
+        const std::string rel = fs::relative(p, tree, ec).generic_string();
+        int len = -1;
+        try { len = std::stoi(p.parent_path().filename().string().substr(4)); } catch (const std::exception&) {}
+
+        LineIngest ingest;
+        if (!ingest.open(p.string(), LineIngest::kDefaultChunkBytes, threads)) {
+            std::cerr << "[Error] Cannot open " << p.string() << "\n";
+            ok = false;
+            continue;
+        }
+        size_t off_len = 0;
+        ingest.run(threads, [&](IngestBatch& batch) {
+            for (auto& rec : batch) {
+                if (!rec.status) {
+                    std::cerr << "[Warning] " << rel << ": failed to parse line " << rec.line << " ("
+                              << TopoLineCompact_enhanced::errorString(rec.status.code) << ")\n";
+                    continue;
+                }
+                rec.topo.name = rel + ":" + std::to_string(rec.line);
+                if ((int)rec.topo.block.size() != len) ++off_len;
+                ok = w.append(rec.topo, category) && ok;
+            }
+        });
+        if (off_len) {
+            std::cerr << "[Warning] " << rel << ": " << off_len << " records do not have " << len
+                      << " blocks; routed by their own key\n";
+        }
+    }
+    ok = w.close() && ok;
+    return ok ? (long long)w.appended() : -1;
+}
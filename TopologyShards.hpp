@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TopologyDB_enhanced.hpp"
+
+// Sharded TopologyDB_enhanced: records partitioned by a structural key, one DB per shard
+//
+// Layout under the root directory:
+//   SHARDS                             "TSHD 1", then one line per shard, replaced atomically:
+//                                        shard <category> <blocks> <kinds> <records> <path>
+//   <category>/len-<blocks>/<kinds>.db  the shard, a text DB (any TopologyDB_enhanced
+//                                       backend works, e.g. after a conversion)
+//
+// The key of a topology is (category, block count, block kinds), the kinds being the
+// block kind letters in block order (g L S I E), e.g. "gLg". The category (LST, SCFT, ...)
+// is not part of a topology and comes from whoever writes it; empty is stored as "_" and
+// an empty kind string as "-". This follows the hand-made trees deco_X/<CATEGORY>/len-N/*.txt,
+// which importTree() loads (their file names also spell side links and instantons, so
+// several of them can feed one shard).
+//
+// Writes are routed by key, a shard being created on its first record. Scans hand whole
+// shards to a pool of workers; a Filter on the key leaves the other shards unopened.
+// Record counts in SHARDS are kept by Writer and dedupe, and are what count() reports;
+// writing to a shard DB directly leaves them stale until recount(). One writer at a time.
+
+class TopologyShards {
+public:
+    struct Key {
+        std::string category;
+        int blocks = 0;
+        std::string kinds;
+        bool operator<(const Key& o) const {
+            if (category != o.category) return category < o.category;
+            return blocks != o.blocks ? blocks < o.blocks : kinds < o.kinds;
+        }
+        bool operator==(const Key& o) const {
+            return category == o.category && blocks == o.blocks && kinds == o.kinds;
+        }
+    };
+
+    // Unset fields match anything; kinds is a prefix
+    struct Filter {
+        std::string category;
+        int blocks = -1;
+        std::string kinds;
+        bool matches(const Key& k) const;
+    };
+
+    struct Shard {
+        Key key;
+        std::string path;   // relative to the root
+        uint64_t records = 0;
+    };
+
+    static Key keyOf(const Topology_enhanced& T, const std::string& category);
+    static std::string shardPath(const Key& k);
+    static bool isShardRoot(const std::string& dir);
+
+    explicit TopologyShards(std::string root);
+
+    // Reads SHARDS; a root without one is an empty sharded DB
+    bool open();
+    const std::vector<Shard>& shards() const { return shards_; }
+    std::vector<const Shard*> select(const Filter& f) const;
+    std::string file(const Shard& s) const { return root_ + "/" + s.path; }
+    uint64_t count(const Filter& f) const;
+    uint64_t count() const { return count(Filter{}); }
+
+    // Append session routing every record to its shard; each shard written to gets a
+    // TopologyDB_enhanced::Writer, and close() records the new counts in SHARDS
+    class Writer {
+    public:
+        explicit Writer(TopologyShards& db);
+        ~Writer();
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        bool append(const Topology_enhanced& T, const std::string& category);
+        bool close();
+        uint64_t appended() const { return appended_; }
+
+    private:
+        struct Open;
+        TopologyShards& db_;
+        std::map<Key, std::unique_ptr<Open>> open_;
+        Open* last_ = nullptr;
+        uint64_t appended_ = 0;
+        bool failed_ = false;
+    };
+    bool append(const Topology_enhanced& T, const std::string& category);
+
+    // Calls fn for every record of the matching shards on up to `threads` workers
+    // (0: hardware concurrency), largest shards first; a single worker takes them in key
+    // order. Each shard is read by one worker, in file order; fn runs concurrently across
+    // workers and gets the worker number, 0 .. threads-1, for per-worker accumulators.
+    // False if a shard cannot be read.
+    using Visitor = std::function<void(int worker, const Shard& shard, TopologyDB_enhanced::Record& r)>;
+    bool forEach(const Filter& f, const Visitor& fn, int threads = 0) const;
+    int workers(const Filter& f, int threads = 0) const;   // how many forEach would use
+
+    // Per-shard dedupe, shards in parallel (duplicates share a key); records removed
+    int dedupeByContentHash(int threads = 0);
+    // Counts in SHARDS from the shard DBs themselves
+    bool recount(int threads = 0);
+
+    // Loads deco_X/<CATEGORY>/len-N/*.txt (or .txtz) line-compact files found under `tree`,
+    // the category taken from the directory above len-N. Records are named
+    // "<path relative to tree>:<line>". Returns records imported, -1 on failure.
+    long long importTree(const std::string& tree, int threads = 0);
+
+private:
+    std::string root_;
+    std::vector<Shard> shards_;   // sorted by key
+
+    bool writeManifest() const;
+    Shard& shardFor(const Key& k);
+};
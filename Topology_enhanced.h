@@ -4,6 +4,7 @@
 #include <utility>
 #include <cstdint>
 #include <ostream>
+#include "SmallVector.hpp"
 
 // 블록 종류: g, L, S, I, E (External 추가)
 enum class LKind : uint8_t { g, L, S, I, E };
@@ -59,17 +60,22 @@ class Topology_enhanced {
 public:
     std::string name; // Topology identifier
 
+    // Core components and linking structures keep their elements inline up to these
+    // sizes (corpus: <= 3 blocks, S/I/E and their params <= 4), on the heap beyond
+    static constexpr size_t kInlineBlocks = 5;
+    static constexpr size_t kInlineDecor  = 4;
+
     // Core components
-    std::vector<Block>         block;        // Set of Blocks (nodes, interior links)
-    std::vector<SideLinks>     side_links;   // Set of side links
-    std::vector<Instantons>    instantons;   // Set of instantons
-    std::vector<External>      externals;    // ✨ NEW: Set of external curves
+    SmallVector<Block, kInlineBlocks>      block;        // Set of Blocks (nodes, interior links)
+    SmallVector<SideLinks, kInlineDecor>   side_links;   // Set of side links
+    SmallVector<Instantons, kInlineDecor>  instantons;   // Set of instantons
+    SmallVector<External, kInlineDecor>    externals;    // ✨ NEW: Set of external curves
 
     // Linking structures
-    std::vector<InteriorStructure>  l_connection;  // Interior connections
-    std::vector<SideLinkStructure>  s_connection;  // Sidelink connections
-    std::vector<InstantonStructure> i_connection;  // Instanton connections
-    std::vector<ExternalStructure>  e_connection;  // ✨ NEW: External connections with ports
+    SmallVector<InteriorStructure, kInlineBlocks - 1> l_connection;  // Interior connections
+    SmallVector<SideLinkStructure, kInlineDecor>      s_connection;  // Sidelink connections
+    SmallVector<InstantonStructure, kInlineDecor>     i_connection;  // Instanton connections
+    SmallVector<ExternalStructure, kInlineDecor>      e_connection;  // ✨ NEW: External connections with ports
 
     // === Utility functions ===
     
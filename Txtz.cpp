@@ -0,0 +1,298 @@
+#include "Txtz.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// ===== Helpers =====
+static inline void put_u32(std::string& b, uint32_t v) {
+    for (int k = 0; k < 4; ++k) b.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+static inline uint32_t get_u32(const char* p) {
+    uint32_t v = 0;
+    for (int k = 0; k < 4; ++k) v |= uint32_t(static_cast<uint8_t>(p[k])) << (8 * k);
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+// 255-runs continuing a nibble that reached 15
+static inline void put_len(std::string& out, size_t n) {
+    for (; n >= 255; n -= 255) out.push_back(static_cast<char>(255));
+    out.push_back(static_cast<char>(n));
+}
+
+static inline bool get_len(const uint8_t* in, size_t n, size_t& ip, size_t& len) {
+    for (;;) {
+        if (ip >= n) return false;
+        const uint8_t c = in[ip++];
+        len += c;
+        if (c != 255) return true;
+    }
+}
+
+// ===== Codec =====
+namespace {
+constexpr int    kHashLog   = 14;
+constexpr size_t kMinMatch  = 4;
+constexpr size_t kLastLits  = 5;    // a match never ends closer than this to the end
+constexpr size_t kMatchFrom = 12;   // nor starts closer than this
+constexpr size_t kMaxOffset = 65535;
+
+inline uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - kHashLog); }
+
+void put_sequence(std::string& out, const uint8_t* lit, size_t nlit, size_t offset, size_t match) {
+    const size_t ml = match - kMinMatch;
+    out.push_back(static_cast<char>((std::min<size_t>(nlit, 15) << 4) | std::min<size_t>(ml, 15)));
+    if (nlit >= 15) put_len(out, nlit - 15);
+    out.append(reinterpret_cast<const char*>(lit), nlit);
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15) put_len(out, ml - 15);
+}
+
+void put_last(std::string& out, const uint8_t* lit, size_t nlit) {
+    out.push_back(static_cast<char>(std::min<size_t>(nlit, 15) << 4));
+    if (nlit >= 15) put_len(out, nlit - 15);
+    out.append(reinterpret_cast<const char*>(lit), nlit);
+}
+} // namespace
+
+void Txtz::compress(std::string_view raw, std::string& out) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(raw.data());
+    const size_t n = raw.size();
+    size_t anchor = 0;
+    if (n > kMatchFrom) {
+        std::vector<uint32_t> table(size_t(1) << kHashLog, 0);
+        const size_t limit = n - kMatchFrom;
+        size_t ip = 1;
+        while (ip < limit) {
+            const uint32_t h = hash4(read32(src + ip));
+            const size_t cand = table[h];
+            table[h] = (uint32_t)ip;
+            if (cand >= ip || ip - cand > kMaxOffset || read32(src + cand) != read32(src + ip)) {
+                ip += 1 + ((ip - anchor) >> 6);   // skip faster through incompressible runs
+                continue;
+            }
+            size_t len = kMinMatch;
+            while (ip + len < n - kLastLits && src[cand + len] == src[ip + len]) ++len;
+            put_sequence(out, src + anchor, ip - anchor, ip - cand, len);
+            ip += len;
+            anchor = ip;
+            if (ip < limit) table[hash4(read32(src + ip - 2))] = (uint32_t)(ip - 2);
+        }
+    }
+    put_last(out, src + anchor, n - anchor);
+}
+
+bool Txtz::decompress(std::string_view stored, size_t raw_size, std::string& out) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(stored.data());
+    const size_t n = stored.size();
+    out.resize(raw_size);
+    char* dst = out.data();
+    size_t ip = 0, op = 0;
+    for (;;) {
+        if (ip >= n) return false;
+        const uint8_t token = in[ip++];
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_len(in, n, ip, lit)) return false;
+        if (lit > n - ip || lit > raw_size - op) return false;
+        std::memcpy(dst + op, in + ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == n) return op == raw_size;
+
+        if (n - ip < 2) return false;
+        const size_t offset = size_t(in[ip]) | size_t(in[ip + 1]) << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !get_len(in, n, ip, match)) return false;
+        match += kMinMatch;
+        if (offset == 0 || offset > op || match > raw_size - op) return false;
+        if (offset >= match) {
+            std::memcpy(dst + op, dst + op - offset, match);
+        } else {
+            for (size_t k = 0; k < match; ++k) dst[op + k] = dst[op + k - offset];   // overlapping run
+        }
+        op += match;
+    }
+}
+
+uint32_t Txtz::checksum(std::string_view raw) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ raw.size();
+    size_t i = 0;
+    for (; i + 8 <= raw.size(); i += 8) {
+        uint64_t w;
+        std::memcpy(&w, raw.data() + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    uint64_t w = 0;
+    std::memcpy(&w, raw.data() + i, raw.size() - i);
+    h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 29;
+    return static_cast<uint32_t>(h);
+}
+
+// ===== Blocks =====
+bool Txtz::isTxtz(std::string_view data) {
+    return data.size() >= kHeaderSize && std::memcmp(data.data(), kMagic, 4) == 0;
+}
+
+bool Txtz::isTxtzFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char h[kHeaderSize];
+    return in.read(h, kHeaderSize) && isTxtz(std::string_view(h, kHeaderSize));
+}
+
+std::string Txtz::header(uint32_t block_bytes) {
+    std::string h(kMagic, 4);
+    put_u32(h, kVersion);
+    put_u32(h, block_bytes);
+    put_u32(h, 0);
+    return h;
+}
+
+void Txtz::encodeBlock(std::string_view raw, std::string& out) {
+    const size_t at = out.size();
+    out.append(kBlockHeaderSize, '\0');
+    compress(raw, out);
+    size_t stored = out.size() - at - kBlockHeaderSize;
+    if (stored >= raw.size()) {
+        out.resize(at + kBlockHeaderSize);
+        out.append(raw);
+        stored = raw.size();
+    }
+    std::string h;
+    put_u32(h, (uint32_t)raw.size());
+    put_u32(h, (uint32_t)stored);
+    put_u32(h, (uint32_t)std::count(raw.begin(), raw.end(), '\n'));
+    put_u32(h, checksum(raw));
+    out.replace(at, kBlockHeaderSize, h);
+}
+
+bool Txtz::parseBlockHeader(const char* p, uint64_t pos, Block& b) {
+    b.offset = pos;
+    b.raw = get_u32(p);
+    b.stored = get_u32(p + 4);
+    b.lines = get_u32(p + 8);
+    b.checksum = get_u32(p + 12);
+    return b.stored <= b.raw;
+}
+
+bool Txtz::readBlock(std::string_view data, uint64_t pos, Block& b) {
+    if (pos > data.size() || data.size() - pos < kBlockHeaderSize) return false;
+    return parseBlockHeader(data.data() + pos, pos, b) && data.size() - pos - kBlockHeaderSize >= b.stored;
+}
+
+static bool decode_payload(std::string_view stored, const Txtz::Block& b, std::string& out) {
+    if (b.stored == b.raw) out.assign(stored.data(), stored.size());
+    else if (!Txtz::decompress(stored, b.raw, out)) return false;
+    return Txtz::checksum(out) == b.checksum;
+}
+
+bool Txtz::decodeBlock(std::string_view data, const Block& b, std::string& out) {
+    return decode_payload(data.substr((size_t)b.offset + kBlockHeaderSize, b.stored), b, out);
+}
+
+// ===== Writer =====
+TxtzWriter::~TxtzWriter() { close(); }
+
+bool TxtzWriter::open(const std::string& path, bool append, uint32_t block_bytes) {
+    close();
+    block_bytes_ = std::max<uint32_t>(block_bytes, 4096);
+    raw_ = stored_ = 0;
+    ok_ = true;
+
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    const bool fresh = !append || ec || size == 0;
+    if (!fresh && !Txtz::isTxtzFile(path)) return false;
+
+    out_.open(path, std::ios::binary | (fresh ? std::ios::trunc : std::ios::app));
+    if (!out_) return false;
+    if (fresh) {
+        const std::string h = Txtz::header(block_bytes_);
+        out_.write(h.data(), (std::streamsize)h.size());
+        stored_ += h.size();
+    }
+    return out_.good();
+}
+
+void TxtzWriter::emit(std::string_view raw) {
+    if (raw.empty()) return;
+    block_.clear();
+    Txtz::encodeBlock(raw, block_);
+    out_.write(block_.data(), (std::streamsize)block_.size());
+    raw_ += raw.size();
+    stored_ += block_.size();
+    ok_ = ok_ && out_.good();
+}
+
+bool TxtzWriter::write(std::string_view text) {
+    if (!out_.is_open()) return false;
+    pending_.append(text);
+    // Full blocks, each cut after the last line end that fits (or after the first one
+    // if a line is longer than a block)
+    size_t from = 0;
+    while (pending_.size() - from >= block_bytes_) {
+        size_t nl = pending_.rfind('\n', from + block_bytes_ - 1);
+        if (nl == std::string::npos || nl < from) nl = pending_.find('\n', from + block_bytes_);
+        if (nl == std::string::npos) break;
+        emit(std::string_view(pending_).substr(from, nl + 1 - from));
+        from = nl + 1;
+    }
+    pending_.erase(0, from);
+    return ok_;
+}
+
+bool TxtzWriter::close() {
+    if (!out_.is_open()) return ok_;
+    emit(pending_);
+    pending_.clear();
+    out_.close();
+    ok_ = ok_ && !out_.fail();
+    return ok_;
+}
+
+// ===== Line reader =====
+bool TxtzLineReader::open(const std::string& path) {
+    in_.open(path, std::ios::binary);
+    if (!in_) return false;
+    char h[Txtz::kHeaderSize];
+    compressed_ = in_.read(h, Txtz::kHeaderSize) && Txtz::isTxtz(std::string_view(h, Txtz::kHeaderSize));
+    if (!compressed_) {
+        in_.clear();
+        in_.seekg(0);
+    }
+    return true;
+}
+
+bool TxtzLineReader::nextBlock() {
+    char h[Txtz::kBlockHeaderSize];
+    if (!in_.read(h, Txtz::kBlockHeaderSize)) return false;
+    Txtz::Block b;
+    stored_.resize(Txtz::parseBlockHeader(h, 0, b) ? b.stored : 0);
+    if (stored_.size() != b.stored || !in_.read(stored_.data(), b.stored) || !decode_payload(stored_, b, block_)) {
+        ok_ = false;
+        return false;
+    }
+    pos_ = 0;
+    return true;
+}
+
+bool TxtzLineReader::getline(std::string& line) {
+    if (!compressed_) return (bool)std::getline(in_, line);
+    while (pos_ >= block_.size()) {
+        if (!nextBlock()) return false;
+    }
+    size_t nl = block_.find('\n', pos_);
+    if (nl == std::string::npos) nl = block_.size();
+    line.assign(block_, pos_, nl - pos_);
+    pos_ = nl + 1;
+    return true;
+}
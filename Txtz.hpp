@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Block-compressed text (.txtz): line-compact files, IF text outputs, any line-oriented text
+//
+// Layout (little-endian):
+//   header : "TXZ1" | u32 version | u32 block_bytes | u32 reserved              (16 bytes)
+//   blocks : u32 raw_size | u32 stored_size | u32 lines | u32 checksum | stored bytes
+//
+// Every block holds whole lines (it ends with '\n', except possibly the last block of the
+// file) and is compressed on its own, so blocks decode independently and in parallel, and
+// a reader knows the first line number of each block from the line counts alone. A block
+// whose stored_size equals raw_size is stored uncompressed. The checksum covers the raw
+// bytes. Files can be appended to: new blocks simply follow the old ones.
+//
+// The codec is byte-oriented LZ77 in the LZ4 style: sequences of a token (literal count,
+// match length - 4, one nibble each, 15 continuing in 255-runs), the literals, and a u16
+// match offset; the last sequence has literals only. No entropy coding: repetitive ASCII
+// compresses several times over at memory-bandwidth-like speeds.
+
+class Txtz {
+public:
+    static constexpr char     kMagic[4]          = {'T','X','Z','1'};
+    static constexpr uint32_t kVersion           = 1;
+    static constexpr size_t   kHeaderSize        = 16;
+    static constexpr size_t   kBlockHeaderSize   = 16;
+    static constexpr uint32_t kDefaultBlockBytes = 1u << 20;
+
+    static bool isTxtz(std::string_view data);
+    static bool isTxtzFile(const std::string& path);
+
+    // LZ codec; decompress fails (false) unless the input decodes to exactly raw_size bytes
+    static void compress(std::string_view raw, std::string& out);
+    static bool decompress(std::string_view stored, size_t raw_size, std::string& out);
+    static uint32_t checksum(std::string_view raw);
+
+    // Appends raw (whole lines) to out as one block, compressed if that is smaller
+    static void encodeBlock(std::string_view raw, std::string& out);
+
+    struct Block {
+        uint64_t offset = 0;    // of the block header in the file
+        uint32_t raw = 0, stored = 0, lines = 0, checksum = 0;
+        uint64_t end() const { return offset + kBlockHeaderSize + stored; }
+    };
+    // Block at data[pos]; false at the end of data or on a truncated header / payload
+    static bool readBlock(std::string_view data, uint64_t pos, Block& b);
+    // The kBlockHeaderSize bytes at p, for a block at file offset pos; false if malformed
+    static bool parseBlockHeader(const char* p, uint64_t pos, Block& b);
+    // Decodes a block into out (replaced); false on corruption or a checksum mismatch
+    static bool decodeBlock(std::string_view data, const Block& b, std::string& out);
+
+    static std::string header(uint32_t block_bytes = kDefaultBlockBytes);
+};
+
+// Streaming writer: text is cut into blocks of about block_bytes at line ends. Opening an
+// existing .txtz with append continues it; close() writes the last partial block.
+class TxtzWriter {
+public:
+    TxtzWriter() = default;
+    ~TxtzWriter();
+    TxtzWriter(const TxtzWriter&) = delete;
+    TxtzWriter& operator=(const TxtzWriter&) = delete;
+
+    bool open(const std::string& path, bool append = false, uint32_t block_bytes = Txtz::kDefaultBlockBytes);
+    bool write(std::string_view text);
+    bool close();
+    bool isOpen() const { return out_.is_open(); }
+
+    uint64_t rawBytes() const { return raw_; }
+    uint64_t storedBytes() const { return stored_; }
+
+private:
+    std::ofstream out_;
+    std::string pending_, block_;
+    uint32_t block_bytes_ = Txtz::kDefaultBlockBytes;
+    uint64_t raw_ = 0, stored_ = 0;
+    bool ok_ = true;
+
+    void emit(std::string_view raw);
+};
+
+// getline over a plain text file or a .txtz, decoding one block at a time
+class TxtzLineReader {
+public:
+    bool open(const std::string& path);
+    bool getline(std::string& line);
+    bool ok() const { return ok_; }   // false once a corrupt block was met
+
+private:
+    std::ifstream in_;
+    bool compressed_ = false, ok_ = true;
+    std::string block_, stored_;
+    size_t pos_ = 0;
+
+    bool nextBlock();
+};
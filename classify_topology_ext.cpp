@@ -15,12 +15,20 @@
 #include <numeric>
 #include <cmath>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 #include <Eigen/Dense>
 #include "Topology_enhanced.h"
 #include "TopologyDB_enhanced.hpp"
 #include "TopoLineCompact_enhanced.hpp"
 #include "Theory_enhanced.h"
+#include "IFBinary.hpp"
+#include "IFCanonical.hpp"
+#include "LineIngest.hpp"
+#include "Txtz.hpp"
 
 // ===== Utility Functions =====
 static inline void ensure_linear_chain(const Topology_enhanced& T,
@@ -32,18 +40,6 @@ static inline void ensure_linear_chain(const Topology_enhanced& T,
     for (int i=1; i<n; ++i) out_chain.push_back({i-1, i});
 }
 
-static inline void append_matrix_txt_batch(std::string& buf, const Eigen::MatrixXi& M){
-    const int R = M.rows(), C = M.cols();
-    for (int i=0;i<R;++i){
-        for (int j=0;j<C;++j){
-            if (j) buf.push_back(' ');
-            buf += std::to_string(M(i,j));
-        }
-        buf.push_back('\n');
-    }
-    buf.push_back('\n');
-}
-
 static inline void flush_to_file(const std::string& path, const std::string& buf){
     if (buf.empty()) return;
     std::filesystem::create_directories(std::filesystem::path(path).parent_path());
@@ -52,9 +48,29 @@ static inline void flush_to_file(const std::string& path, const std::string& buf
     out.write(buf.data(), (std::streamsize)buf.size());
 }
 
+// Line-compact text, base+delta variants (TopoDelta.hpp) or compressed text (Txtz.hpp),
+// all read by LineIngest
+static inline bool is_line_file(const std::filesystem::path& p){
+    return p.extension()==".txt" || p.extension()==".txd" || p.extension()==".txtz";
+}
+
+// File name without its extension, except that .txd and .txtz keep theirs
+// (x.txd -> x_txd): next to x.txt (topo_txtz c keeps the source) they would otherwise
+// share, and append to, the same outputs
+static inline std::string drop_extension(std::string name){
+    const auto pos = name.find_last_of('.');
+    if (pos == std::string::npos || pos == 0) return name;
+    if (name.compare(pos, std::string::npos, ".txd") == 0 ||
+        name.compare(pos, std::string::npos, ".txtz") == 0){
+        name[pos] = '_';
+        return name;
+    }
+    return name.substr(0, pos);
+}
+
 static inline std::string get_base_filename(const std::string& path){
     std::filesystem::path p(path);
-    return p.stem().string();
+    return drop_extension(p.filename().string());
 }
 
 static inline std::string get_safe_output_name(const std::string& fullPath, 
@@ -75,12 +91,7 @@ static inline std::string get_safe_output_name(const std::string& fullPath,
     std::replace(safe_name.begin(), safe_name.end(), '\\', '_');
     std::replace(safe_name.begin(), safe_name.end(), ' ', '_');
     
-    auto ext_pos = safe_name.find_last_of('.');
-    if (ext_pos != std::string::npos) {
-        safe_name = safe_name.substr(0, ext_pos);
-    }
-    
-    return safe_name;
+    return drop_extension(safe_name);
 }
 
 // ===== Topology -> TheoryGraph (Extended for External curves) =====
@@ -101,7 +112,7 @@ static GraphBuildResult build_graph_from_topology(const Topology_enhanced& T){
             case LKind::L: sp = Spec{Kind::InteriorLink, b.param}; break;
             case LKind::S: sp = Spec{Kind::SideLink,     b.param}; break;
             case LKind::I: sp = Spec{Kind::SideLink,     b.param}; break;
-            case LKind::E: sp = Spec{Kind::ExternalCurve, b.param}; break;
+            case LKind::E: sp = Spec{Kind::External,      b.param}; break;
         }
         nodeIdx_block[i] = R.G.add(sp).id;
     }
@@ -119,7 +130,7 @@ static GraphBuildResult build_graph_from_topology(const Topology_enhanced& T){
     // 4) External curve nodes
     std::vector<int> nodeIdx_E(T.externals.size(), -1);
     for (size_t i=0; i<T.externals.size(); ++i)
-        nodeIdx_E[i] = R.G.add(Spec{Kind::ExternalCurve, T.externals[i].param}).id;
+        nodeIdx_E[i] = R.G.add(Spec{Kind::External, T.externals[i].param}).id;
 
     // 5) Interior connections (Right-to-Left default)
     std::vector<InteriorStructure> chain;
@@ -141,26 +152,26 @@ static GraphBuildResult build_graph_from_topology(const Topology_enhanced& T){
         if (conn.external_id < 0 || conn.external_id >= (int)nodeIdx_E.size()) 
             continue;
         
-        NodeRef* parentRef = nullptr;
+        int parent_node_id = -1;
         switch (conn.parent_type) {
             case 0:  // Block
                 if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_block.size())
-                    parentRef = &NodeRef{nodeIdx_block[conn.parent_id]};
+                    parent_node_id = nodeIdx_block[conn.parent_id];
                 break;
             case 1:  // SideLink
                 if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_S.size())
-                    parentRef = &NodeRef{nodeIdx_S[conn.parent_id]};
+                    parent_node_id = nodeIdx_S[conn.parent_id];
                 break;
             case 2:  // Instanton
                 if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_I.size())
-                    parentRef = &NodeRef{nodeIdx_I[conn.parent_id]};
+                    parent_node_id = nodeIdx_I[conn.parent_id];
                 break;
         }
         
-        if (parentRef) {
+        if (parent_node_id >= 0) {
             AttachmentPoint ap(conn.port_idx);
             R.G.connect(NodeRef{nodeIdx_E[conn.external_id]}, AttachmentPoint(-1), 
-                       *parentRef, ap);
+                       NodeRef{parent_node_id}, ap);
         }
     }
 
@@ -223,115 +234,363 @@ static InFmt parse_infmt(const std::string& s){
     return InFmt::Auto;
 }
 
-static long long process_line_file(const std::string& path,
-                                   const std::string& outDir,
-                                   const std::string& base_name){
-    std::ifstream fin(path);
-    if (!fin){ std::cerr << "[skip] cannot open " << path << "\n"; return 0; }
-    
+// ===== Output =====
+enum class OutFmt { Txt, Bin, Txtz };
+static OutFmt parse_outfmt(const std::string& s){
+    if (s=="bin") return OutFmt::Bin;
+    if (s=="txtz") return OutFmt::Txtz;
+    return OutFmt::Txt;
+}
+
+static inline const char* output_ext(OutFmt fmt){
+    switch (fmt){
+        case OutFmt::Bin:  return ".ifb";
+        case OutFmt::Txtz: return ".txtz";
+        case OutFmt::Txt:  break;
+    }
+    return ".txt";
+}
+
+static inline std::string output_path(const std::string& outDir, const std::string& base_name,
+                                      const char* cls, OutFmt fmt){
+    return outDir + "/" + base_name + "_IF_" + cls + output_ext(fmt);
+}
+
+// Encoded matrices of one class plus the byte length of every record.
+// With keep set (--unique) the matrices themselves are kept for deduplication.
+struct IFBatch {
+    std::string bytes;
+    std::vector<uint32_t> lengths;
+    std::vector<Eigen::MatrixXi> mats;
+    bool keep = false;
+
+    void add(const Eigen::MatrixXi& M, OutFmt fmt){
+        const size_t before = bytes.size();
+        if (fmt==OutFmt::Bin) IFBinary::appendRecord(bytes, M);
+        else                  IFBinary::appendMatrixText(bytes, M);
+        lengths.push_back((uint32_t)(bytes.size() - before));
+        if (keep) mats.push_back(M);
+    }
+    void clear(){ bytes.clear(); lengths.clear(); mats.clear(); }
+};
+
+// One output file; binary and compressed files stay open until close() writes their
+// index / last block.
+// In unique mode only the first form of every isomorphism class is written and
+// close() stores the class multiplicities, one per written record, in <path>.mult.
+// The classes are this run's, so a unique sink replaces an existing output and its
+// .mult on its first write instead of appending to them (outputs are otherwise
+// appended to across runs).
+struct IFSink {
+    std::string path;
+    OutFmt fmt = OutFmt::Txt;
+    IFBinaryWriter bin;
+    TxtzWriter txtz;
+
+    bool unique = false;
+    IFDedup dedup;
+    std::vector<long long> mult;
+    bool started = false;   // unique mode: the old output was removed
+
+    void write(const IFBatch& b){
+        if (b.bytes.empty()) return;
+        if (unique) { write_unique(b); return; }
+        write_raw(b.bytes, b.lengths);
+    }
+    void close(){
+        if (!bin.close() || !txtz.close()) std::cerr << "[Error] cannot finalize " << path << "\n";
+        if (unique && !mult.empty()){
+            std::string s;
+            for (long long m : mult) { s += std::to_string(m); s.push_back('\n'); }
+            std::ofstream out(path + ".mult", std::ios::trunc);
+            out << s;
+        }
+    }
+
+private:
+    void write_raw(const std::string& bytes, const std::vector<uint32_t>& lengths){
+        if (bytes.empty()) return;
+        if (unique && !started){
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            std::filesystem::remove(path + ".mult", ec);
+            started = true;
+        }
+        if (fmt==OutFmt::Txt) { flush_to_file(path, bytes); return; }
+        if (fmt==OutFmt::Txtz){
+            if (!txtz.isOpen()){
+                std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+                if (!txtz.open(path, true)) throw std::runtime_error("cannot open " + path);
+            }
+            if (!txtz.write(bytes)) throw std::runtime_error("write failed " + path);
+            return;
+        }
+        if (!bin.isOpen() && !bin.open(path)) throw std::runtime_error("cannot open " + path);
+        if (!bin.appendEncoded(bytes, lengths)) throw std::runtime_error("write failed " + path);
+    }
+    void write_unique(const IFBatch& b){
+        std::string bytes;
+        std::vector<uint32_t> lengths;
+        size_t off = 0;
+        for (size_t k=0; k<b.lengths.size(); ++k){
+            size_t rep;
+            if (dedup.insert(b.mats[k], rep)){
+                bytes.append(b.bytes, off, b.lengths[k]);
+                lengths.push_back(b.lengths[k]);
+                mult.push_back(1);
+            } else {
+                ++mult[rep];
+            }
+            off += b.lengths[k];
+        }
+        write_raw(bytes, lengths);
+    }
+};
+
+struct RunOptions {
+    int threads = 1;
+    std::uintmax_t chunk_bytes = 8u << 20;  // files above this are split into line ranges
+    OutFmt fmt = OutFmt::Txt;
+    bool unique = false;                    // isomorphism-canonical dedupe per output file
+};
+
+static inline std::string unique_summary(const IFSink& s, const IFSink& l){
+    if (!s.unique) return "";
+    return " | unique SCFT: " + std::to_string(s.dedup.classes())
+         + " | unique LST: " + std::to_string(l.dedup.classes());
+}
+
+// Classification result of one contiguous piece of input (a chunk or a whole DB)
+struct ClassifyResult {
+    IFBatch scft;
+    IFBatch lst;
     long long Nproc=0, Nscft=0, Nlst=0;
-    
-    const std::string out_scft = outDir + "/" + base_name + "_IF_SCFT.txt";
-    const std::string out_lst  = outDir + "/" + base_name + "_IF_LST.txt";
-    
-    std::string buf_scft; buf_scft.reserve(1<<22);
-    std::string buf_lst;  buf_lst .reserve(1<<22);
-    
-    auto flush_all = [&](){
-        flush_to_file(out_scft, buf_scft); buf_scft.clear();
-        flush_to_file(out_lst,  buf_lst);  buf_lst.clear();
-    };
-    
-    std::string line;
-    while (std::getline(fin, line)){
-        if (line.empty()) continue;
-        Topology_enhanced T;
-        if (!TopoLineCompact_enhanced::deserialize(line, T)) continue;
-        
-        try{
-            auto R  = build_graph_from_topology(T);
-            Eigen::MatrixXi IF = R.G.ComposeIF_Gluing();
+};
+
+static inline void classify_one(const Topology_enhanced& T, ClassifyResult& res, OutFmt fmt){
+    try{
+        auto R  = build_graph_from_topology(T);
+        Eigen::MatrixXi IF = R.G.ComposeIF_Gluing();
+
+        if (is_scft_accurate(IF)) { res.scft.add(IF, fmt); ++res.Nscft; }
+        else if (is_lst_accurate(IF)) { res.lst.add(IF, fmt); ++res.Nlst; }
+
+        ++res.Nproc;
+    } catch (const std::exception& e){
+        std::cerr << "[Error] " << e.what() << " on topology " << T.name << "\n";
+    }
+}
+
+// ===== Parallel line-file processing =====
+// Every input file owns its <name>_IF_SCFT.txt / _IF_LST.txt pair, so files are
+// independent units of work. Large files are additionally cut into newline-aligned
+// chunks of the memory-mapped file (LineIngest.hpp); chunk results are committed
+// strictly in chunk order, so the output is byte-identical to a serial run
+// regardless of the thread count.
+struct FileJob {
+    std::string path;
+    std::string base_name;
+    IFSink out_scft, out_lst;
+    std::uintmax_t size = 0;
+    LineIngest ingest;
+
+    std::mutex mtx;
+    std::vector<std::unique_ptr<ClassifyResult>> done;  // finished, not yet written
+    size_t next_to_write = 0;
+    long long Nproc=0, Nscft=0, Nlst=0;
+};
+
+struct ChunkTask {
+    FileJob* job;
+    size_t idx;
+};
+
+static std::mutex g_console_mtx;
+
+static void classify_range(const FileJob& job, size_t idx, ClassifyResult& res, const RunOptions& opt){
+    res.scft.bytes.reserve(1<<20);
+    res.lst .bytes.reserve(1<<20);
+    res.scft.keep = res.lst.keep = opt.unique;
+
+    IngestBatch batch;
+    job.ingest.parseChunk(idx, batch);
+    for (const auto& rec : batch){
+        if (rec.status) classify_one(rec.topo, res, opt.fmt);
+    }
+}
+
+// Append every finished chunk that is next in line; called with job.mtx held
+static void commit_ready_chunks(FileJob& job){
+    while (job.next_to_write < job.ingest.chunks().size() && job.done[job.next_to_write]){
+        auto& r = *job.done[job.next_to_write];
+        job.out_scft.write(r.scft);
+        job.out_lst .write(r.lst);
+        job.Nproc += r.Nproc; job.Nscft += r.Nscft; job.Nlst += r.Nlst;
+        job.done[job.next_to_write].reset();
+        ++job.next_to_write;
+    }
+}
 
-            if (is_scft_accurate(IF)) { append_matrix_txt_batch(buf_scft, IF); ++Nscft; }
-            else if (is_lst_accurate(IF)) { append_matrix_txt_batch(buf_lst, IF); ++Nlst; }
+static long long run_line_jobs(std::vector<std::unique_ptr<FileJob>>& jobs,
+                               const RunOptions& opt){
+    // Largest files first: long tails are what limits wall time
+    std::sort(jobs.begin(), jobs.end(),
+              [](const auto& a, const auto& b){ return a->size > b->size; });
 
-            if ((++Nproc % 2000)==0) flush_all();
-        } catch (const std::exception& e){
-            std::cerr << "[Error] " << e.what() << " on topology " << T.name << "\n";
+    std::vector<ChunkTask> tasks;
+    for (auto& j : jobs){
+        if (!j->ingest.open(j->path, opt.chunk_bytes)){
+            std::cerr << "[skip] cannot open " << j->path << "\n";
+            continue;
         }
+        const size_t nchunks = j->ingest.chunks().size();
+        j->done.resize(nchunks);
+        for (size_t k=0; k<nchunks; ++k) tasks.push_back({j.get(), k});
     }
-    
-    flush_all();
-    
-    std::cout << "File: " << base_name << " | Processed: " << Nproc
-              << " | SCFT: " << Nscft << " | LST: " << Nlst << "\n";
-    
-    return Nproc;
+
+    std::atomic<size_t> next{0};
+    std::atomic<long long> total{0};
+
+    auto worker = [&](){
+        for (;;){
+            const size_t t = next.fetch_add(1);
+            if (t >= tasks.size()) return;
+            FileJob& job = *tasks[t].job;
+
+            auto res = std::make_unique<ClassifyResult>();
+            classify_range(job, tasks[t].idx, *res, opt);
+
+            std::lock_guard<std::mutex> lk(job.mtx);
+            job.done[tasks[t].idx] = std::move(res);
+            commit_ready_chunks(job);
+
+            if (job.next_to_write == job.ingest.chunks().size()){
+                job.out_scft.close();
+                job.out_lst .close();
+                job.ingest.close();
+                total += job.Nproc;
+                std::lock_guard<std::mutex> lk2(g_console_mtx);
+                std::cout << "File: " << job.base_name << " | Processed: " << job.Nproc
+                          << " | SCFT: " << job.Nscft << " | LST: " << job.Nlst
+                          << unique_summary(job.out_scft, job.out_lst) << "\n";
+            }
+        }
+    };
+
+    const int nthreads = std::max(1, std::min<int>(opt.threads, (int)tasks.size()));
+    std::vector<std::thread> pool;
+    for (int i=1; i<nthreads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    return total.load();
+}
+
+static std::unique_ptr<FileJob> make_line_job(const std::string& path,
+                                              const std::string& outDir,
+                                              const std::string& base_name,
+                                              const RunOptions& opt){
+    auto job = std::make_unique<FileJob>();
+    job->path      = path;
+    job->base_name = base_name;
+    job->out_scft.path = output_path(outDir, base_name, "SCFT", opt.fmt);
+    job->out_lst .path = output_path(outDir, base_name, "LST",  opt.fmt);
+    job->out_scft.fmt  = job->out_lst.fmt = opt.fmt;
+    job->out_scft.unique = job->out_lst.unique = opt.unique;
+    std::error_code ec;
+    job->size = std::filesystem::file_size(path, ec);
+    if (ec) job->size = 0;
+    return job;
 }
 
 static long long process_line_path(const std::string& inPath,
-                                   const std::string& outDir){
-    long long total=0;
+                                   const std::string& outDir,
+                                   const RunOptions& opt){
+    std::vector<std::unique_ptr<FileJob>> jobs;
     if (std::filesystem::is_directory(inPath)){
+        std::vector<std::string> paths;
         for (auto& e : std::filesystem::recursive_directory_iterator(inPath)){
-            if (e.is_regular_file() && e.path().extension()==".txt"){
-                std::string safe_name = get_safe_output_name(e.path().string(), inPath);
-                total += process_line_file(e.path().string(), outDir, safe_name);
+            if (e.is_regular_file() && is_line_file(e.path())) paths.push_back(e.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        // Two inputs on one output pair would interleave their records (and, with -j,
+        // two writers would append to one file at once)
+        std::map<std::string, std::string> owner;   // output name -> input
+        for (const auto& path : paths){
+            std::string safe_name = get_safe_output_name(path, inPath);
+            auto [it, fresh] = owner.emplace(safe_name, path);
+            if (!fresh){
+                std::cerr << "[Error] " << path << " and " << it->second << " both map to "
+                          << safe_name << "_IF_*; skipping " << path << "\n";
+                continue;
             }
+            jobs.push_back(make_line_job(path, outDir, safe_name, opt));
         }
     } else {
-        std::string base_name = get_base_filename(inPath);
-        total += process_line_file(inPath, outDir, base_name);
+        std::ifstream probe(inPath);
+        if (!probe){ std::cerr << "[skip] cannot open " << inPath << "\n"; return 0; }
+        jobs.push_back(make_line_job(inPath, outDir, get_base_filename(inPath), opt));
     }
-    return total;
+    return run_line_jobs(jobs, opt);
 }
 
 static long long process_db_file(const std::string& dbPath,
                                 const std::string& outDir,
-                                const std::string& base_name){
+                                const std::string& base_name,
+                                const RunOptions& opt){
     TopologyDB_enhanced db(dbPath);
     
-    long long Nproc=0, Nscft=0, Nlst=0;
+    IFSink out_scft, out_lst;
+    out_scft.path = output_path(outDir, base_name, "SCFT", opt.fmt);
+    out_lst .path = output_path(outDir, base_name, "LST",  opt.fmt);
+    out_scft.fmt  = out_lst.fmt = opt.fmt;
+    out_scft.unique = out_lst.unique = opt.unique;
     
-    const std::string out_scft = outDir + "/" + base_name + "_IF_SCFT.txt";
-    const std::string out_lst  = outDir + "/" + base_name + "_IF_LST.txt";
-    
-    std::string buf_scft; buf_scft.reserve(1<<22);
-    std::string buf_lst;  buf_lst .reserve(1<<22);
+    ClassifyResult res;
+    res.scft.bytes.reserve(1<<22);
+    res.lst .bytes.reserve(1<<22);
+    res.scft.keep = res.lst.keep = opt.unique;
     
     auto flush_all = [&](){
-        flush_to_file(out_scft, buf_scft); buf_scft.clear();
-        flush_to_file(out_lst,  buf_lst);  buf_lst.clear();
+        out_scft.write(res.scft); res.scft.clear();
+        out_lst .write(res.lst);  res.lst.clear();
     };
     
-    for (auto& rec : db.loadAll()){
-        try{
-            auto R  = build_graph_from_topology(rec.topo);
-            Eigen::MatrixXi IF = R.G.ComposeIF_Gluing();
-
-            if (is_scft_accurate(IF)) { append_matrix_txt_batch(buf_scft, IF); ++Nscft; }
-            else if (is_lst_accurate(IF)) { append_matrix_txt_batch(buf_lst, IF); ++Nlst; }
-
-            if ((++Nproc % 2000)==0) flush_all();
-        } catch (const std::exception& e){
-            std::cerr << "[Error] " << e.what() << " on topology " << rec.topo.name << "\n";
-        }
-    }
+    db.forEach([&](TopologyDB_enhanced::Record& rec){
+        const long long before = res.Nproc;
+        classify_one(rec.topo, res, opt.fmt);
+        if (res.Nproc != before && (res.Nproc % 2000)==0) flush_all();
+    });
     
     flush_all();
+    out_scft.close();
+    out_lst .close();
     
-    std::cout << "File: " << base_name << " | Processed: " << Nproc
-              << " | SCFT: " << Nscft << " | LST: " << Nlst << "\n";
+    std::cout << "File: " << base_name << " | Processed: " << res.Nproc
+              << " | SCFT: " << res.Nscft << " | LST: " << res.Nlst
+              << unique_summary(out_scft, out_lst) << "\n";
     
-    return Nproc;
+    return res.Nproc;
 }
 
 // ===== Main =====
 int main(int argc, char** argv){
     if (argc < 3){
-        std::cerr << "usage: " << argv[0] << " <input_path_or_dir> <out_dir> [--in line|db|auto]\n";
+        std::cerr << "usage: " << argv[0] << " <input_path_or_dir> <out_dir> [--in line|db|auto]"
+                  << " [-j N] [--chunk-mb N] [--out-format txt|bin|txtz] [--unique]\n";
         std::cerr << "  Extended version supporting External curves (LKind::E)\n";
         std::cerr << "  Output files: <input_basename>_IF_SCFT.txt and <input_basename>_IF_LST.txt\n";
+        std::cerr << "                (.txd / .txtz inputs keep their extension: x.txtz -> x_txtz_IF_*)\n";
+        std::cerr << "  Line input: line-compact .txt, base+delta .txd (external_generator --delta) or\n";
+        std::cerr << "              compressed .txtz (topo_txtz c)\n";
+        std::cerr << "  -j N          worker threads (default: hardware concurrency)\n";
+        std::cerr << "  --chunk-mb N  split line files larger than N MiB into chunks (default: 8)\n";
+        std::cerr << "  --out-format  txt (default) or bin: indexed binary <name>_IF_*.ifb,\n";
+        std::cerr << "                convert back with if_bin2txt; or txtz: the text output block-compressed\n";
+        std::cerr << "                (<name>_IF_*.txtz, expand with topo_txtz d)\n";
+        std::cerr << "  --unique      keep one intersection form per isomorphism class (relabelled\n";
+        std::cerr << "                curves) in each output file; <output>.mult lists the class sizes.\n";
+        std::cerr << "                Existing outputs are replaced, not appended to as without it\n";
         return 1;
     }
     const std::string inPath = argv[1];
@@ -339,9 +598,20 @@ int main(int argc, char** argv){
     std::filesystem::create_directories(outDir);
 
     InFmt inFmt = InFmt::Auto;
+    RunOptions opt;
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
     for (int i=3; i<argc; ++i){
-        if (std::string(argv[i])=="--in" && i+1<argc){
+        const std::string a = argv[i];
+        if (a=="--in" && i+1<argc){
             inFmt = parse_infmt(argv[++i]);
+        } else if ((a=="-j" || a=="--threads") && i+1<argc){
+            opt.threads = std::max(1, std::stoi(argv[++i]));
+        } else if (a=="--chunk-mb" && i+1<argc){
+            opt.chunk_bytes = (std::uintmax_t)std::max(1, std::stoi(argv[++i])) << 20;
+        } else if (a=="--out-format" && i+1<argc){
+            opt.fmt = parse_outfmt(argv[++i]);
+        } else if (a=="--unique"){
+            opt.unique = true;
         }
     }
 
@@ -349,17 +619,17 @@ int main(int argc, char** argv){
 
     if (inFmt==InFmt::DB) {
         std::string base_name = get_base_filename(inPath);
-        total = process_db_file(inPath, outDir, base_name);
+        total = process_db_file(inPath, outDir, base_name, opt);
     } else if (inFmt==InFmt::Line || std::filesystem::is_directory(inPath)
-               || std::filesystem::path(inPath).extension()==".txt") {
-        total = process_line_path(inPath, outDir);
+               || is_line_file(inPath)) {
+        total = process_line_path(inPath, outDir, opt);
     } else {
         try { 
             std::string base_name = get_base_filename(inPath);
-            total = process_db_file(inPath, outDir, base_name); 
+            total = process_db_file(inPath, outDir, base_name, opt); 
         }
         catch (...) { 
-            total = process_line_path(inPath, outDir); 
+            total = process_line_path(inPath, outDir, opt); 
         }
     }
 
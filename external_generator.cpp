@@ -4,6 +4,10 @@
 #include "Topology_enhanced.h"
 #include "TopologyDB_enhanced.hpp"
 #include "TopoLineCompact_enhanced.hpp"
+#include "TopoDelta.hpp"
+#include "Txtz.hpp"
+#include "TopologyKey.hpp"
+#include "TopologyOverlay.hpp"
 // ❌ REMOVED: TopoLineCompact.hpp - it includes Topology.h which conflicts with Topology_enhanced.h
 #include "Tensor.h"
 #include "Theory_enhanced.h"
@@ -14,8 +18,10 @@
 #include <filesystem>
 #include <map>
 #include <set>
+#include <unordered_set>
 #include <algorithm>
 #include <sstream>
+#include <memory>
 
 namespace fs = std::filesystem;
 
@@ -42,6 +48,7 @@ struct GeneratorConfig {
     int max_port_index = 2;               // 0, 1, 2 for left/middle/right
     bool check_sugra = true;
     bool verbose = false;
+    bool delta = false;                   // Output is a base+delta .txd file (TopoDelta.hpp)
 };
 
 // ============================================================================
@@ -202,11 +209,11 @@ std::vector<ExternalCombination> generateExternalCombinations(
 bool constructTopologyWithExternals(
     const Topology_enhanced& base,
     const ExternalCombination& combo,
-    Topology_enhanced& result,
+    TopologyOverlay& result,
     const GeneratorConfig& config
 ) {
-    // Deep copy base topology
-    result = base;
+    // Externals go on top of the base, which is not copied
+    result.reset(base);
     
     // Add external curves
     for (size_t i = 0; i < combo.assignments.size(); ++i) {
@@ -243,10 +250,11 @@ bool constructTopologyWithExternals(
 // ============================================================================
 
 bool checkSupergravityConditions(
-    const Topology_enhanced& T,
+    const TopologyOverlay& O,
     const GeneratorConfig& config
 ) {
     if (!config.check_sugra) return true;
+    const Topology_enhanced& T = O.base();
     
     try {
         // Build TheoryGraph
@@ -275,8 +283,8 @@ bool checkSupergravityConditions(
         
         // Add nodes for externals
         std::vector<NodeRef> extNodes;
-        for (size_t idx = 0; idx < T.externals.size(); ++idx) {
-            auto node_ref = G.add(e(T.externals[idx].param));
+        for (size_t idx = 0; idx < O.externalCount(); ++idx) {
+            auto node_ref = G.add(e(O.external(idx).param));
             extNodes.push_back(node_ref);
         }
         
@@ -308,7 +316,8 @@ bool checkSupergravityConditions(
         }
         
         // Connect externals with port-aware attachment using AttachmentPoint
-        for (const auto& conn : T.e_connection) {
+        for (size_t idx = 0; idx < O.eConnectionCount(); ++idx) {
+            const auto& conn = O.eConnection(idx);
             if (conn.external_id >= static_cast<int>(extNodes.size())) continue;
             
             NodeRef* parentNodeRef = nullptr;
@@ -368,6 +377,7 @@ struct GenerationStats {
     int failed_construction = 0;
     int failed_validation = 0;
     int failed_sugra = 0;
+    int duplicates = 0;
     
     void print() const {
         std::cout << "\n=== Generation Statistics ===\n";
@@ -377,6 +387,7 @@ struct GenerationStats {
         std::cout << "Failed construction: " << failed_construction << "\n";
         std::cout << "Failed validation:   " << failed_validation << "\n";
         std::cout << "Failed SUGRA:        " << failed_sugra << "\n";
+        std::cout << "Duplicates skipped:  " << duplicates << "\n";
         std::cout << "Success rate:        " 
                   << (attempted > 0 ? (100.0 * successful / attempted) : 0.0) 
                   << "%\n";
@@ -384,22 +395,49 @@ struct GenerationStats {
 };
 
 void processDatabase(const GeneratorConfig& config, GenerationStats& stats) {
-    // Open input database
-    std::ifstream infile(config.input_db_path);
-    if (!infile) {
+    // Open input database (plain or block-compressed line-compact text)
+    TxtzLineReader infile;
+    if (!infile.open(config.input_db_path)) {
         throw std::runtime_error("Cannot open input database: " + config.input_db_path);
     }
     
-    // Open output database
+    // Open output database; records are buffered and written in batches. In delta mode
+    // the variants of a base are encoded against it and appended to a .txd file instead.
     TopologyDB_enhanced outDB(config.output_db_path);
+    std::unique_ptr<TopologyDB_enhanced::Writer> writer;
+    TopoDeltaEncoder delta;
+    std::string groups;
+    if (!config.delta) {
+        writer = std::make_unique<TopologyDB_enhanced::Writer>(outDB);
+        if (!writer->isOpen()) {
+            throw std::runtime_error("Cannot open output database: " + config.output_db_path);
+        }
+    }
+    auto flush_delta = [&](bool all) {
+        delta.drain(groups, all);
+        if (groups.empty() && !all) return;   // the last flush creates the file regardless
+        if (!TopoDelta::appendToFile(config.output_db_path, groups)) {
+            throw std::runtime_error("Cannot append to delta file: " + config.output_db_path);
+        }
+        groups.clear();
+    };
+    
+    // Variants met so far, SUGRA failures included: a base seen again yields them again
+    std::unordered_set<TopologyKey> seen;
+    Topology_enhanced variant;   // materialized for the DB writer, capacity reused
     
     std::string line;
-    while (std::getline(infile, line)) {
+    while (infile.getline(line)) {
         if (line.empty()) continue;
         
-        // Try to deserialize as enhanced topology first
+        // Try to deserialize as enhanced topology first. Bases that already have
+        // externals are skipped below, so look at E=/ep= before decoding the rest.
         Topology_enhanced base;
-        bool is_enhanced = TopoLineCompact_enhanced::deserialize(line, base);
+        bool is_enhanced = TopoLineCompact_enhanced::deserialize(
+            line, base, TopoLineCompact_enhanced::EConn | TopoLineCompact_enhanced::EParams);
+        if (is_enhanced && !base.hasExternalCurves()) {
+            is_enhanced = TopoLineCompact_enhanced::deserialize(line, base);
+        }
         
         if (!is_enhanced) {
             // Try basic Topology format (forward compatibility)
@@ -425,12 +463,18 @@ void processDatabase(const GeneratorConfig& config, GenerationStats& stats) {
             for (const auto& combo : combinations) {
                 stats.attempted++;
                 
-                Topology_enhanced result;
+                TopologyOverlay result(base);
                 if (!constructTopologyWithExternals(base, combo, result, config)) {
                     stats.failed_construction++;
                     continue;
                 }
                 
+                // Drop in-run duplicates before the SUGRA check
+                if (!seen.insert(TopologyKey::of(result)).second) {
+                    stats.duplicates++;
+                    continue;
+                }
+                
                 if (!TopoLineCompact_enhanced::validate(result)) {
                     stats.failed_validation++;
                     continue;
@@ -444,22 +488,40 @@ void processDatabase(const GeneratorConfig& config, GenerationStats& stats) {
                 // Generate unique name
                 std::ostringstream name;
                 name << base.name << "_ext" << n_ext << "_" << stats.successful;
-                result.name = name.str();
                 
-                // Save to database
-                if (!outDB.append(result)) {
-                    std::cerr << "Warning: Failed to append to database\n";
+                // Save to database; only the DB writer needs the full topology (names
+                // are not stored in delta files)
+                if (config.delta) {
+                    delta.add(result);
+                    if (delta.bufferedBytes() >= (1u << 22)) flush_delta(false);
+                } else {
+                    result.materializeInto(variant);
+                    variant.name = name.str();
+                    if (!writer->append(variant)) {
+                        std::cerr << "Warning: Failed to append to database\n";
+                    }
                 }
                 
                 stats.successful++;
                 
                 if (config.verbose) {
-                    std::cout << "Generated: " << result.name 
+                    std::cout << "Generated: " << name.str() 
                               << " - " << combo.describe() << "\n";
                 }
             }
         }
     }
+
+    if (!infile.ok()) {
+        std::cerr << "Warning: Corrupt compressed block in " << config.input_db_path
+                  << "; input read up to it\n";
+    }
+
+    if (config.delta) {
+        flush_delta(true);
+    } else if (!writer->close()) {
+        std::cerr << "Warning: Failed to write the output database\n";
+    }
 }
 
 // ============================================================================
@@ -477,6 +539,8 @@ void printUsage(const char* prog) {
               << "  --no-sides    Disable sidelink port attachments\n"
               << "  --no-interior Disable interior port attachments\n"
               << "  --no-sugra    Disable SUGRA checking\n"
+              << "  --delta       Write the output as a base+delta .txd file: each base once,\n"
+              << "                then only the externals of its variants (names are not kept)\n"
               << "  -v            Verbose output\n"
               << "  -h            Show this help\n";
 }
@@ -507,6 +571,8 @@ int main(int argc, char* argv[]) {
             config.enable_interior_ports = false;
         } else if (arg == "--no-sugra") {
             config.check_sugra = false;
+        } else if (arg == "--delta") {
+            config.delta = true;
         } else if (arg == "-v") {
             config.verbose = true;
         } else {
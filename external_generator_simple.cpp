@@ -16,6 +16,10 @@
 #include "Topology_enhanced.h"
 #include "TopologyDB_enhanced.hpp"
 #include "TopoLineCompact_enhanced.hpp"
+#include "TopoDelta.hpp"
+#include "Txtz.hpp"
+#include "TopologyKey.hpp"
+#include "TopologyOverlay.hpp"
 #include "Theory_enhanced.h"
 #include "Tensor.h"
 #include <sstream>
@@ -105,6 +109,7 @@ struct Config {
     int num_threads = std::thread::hardware_concurrency();
     bool verbose = false;
     bool classify_only = false;     // If true, only classify without adding externals
+    bool delta = false;             // Write base+delta .txd files (TopoDelta.hpp)
 };
 
 // ============================================================================
@@ -128,7 +133,8 @@ const char* category_name(TopoCategory cat) {
     return "Unknown";
 }
 
-TopoCategory classify_topology(const Topology_enhanced& T) {
+TopoCategory classify_topology(const TopologyOverlay& O) {
+    const Topology_enhanced& T = O.base();
     try {
         // Build TheoryGraph
         TheoryGraph G;
@@ -158,8 +164,8 @@ TopoCategory classify_topology(const Topology_enhanced& T) {
         }
         
         std::vector<NodeRef> extNodes;
-        for (const auto& ext : T.externals) {
-            extNodes.push_back(G.add(e(ext.param)));
+        for (size_t idx = 0; idx < O.externalCount(); ++idx) {
+            extNodes.push_back(G.add(e(O.external(idx).param)));
         }
         
         // Connect interior links (Right-to-Left by default)
@@ -190,7 +196,8 @@ TopoCategory classify_topology(const Topology_enhanced& T) {
         }
         
         // Connect externals with AttachmentPoint
-        for (const auto& conn : T.e_connection) {
+        for (size_t idx = 0; idx < O.eConnectionCount(); ++idx) {
+            const auto& conn = O.eConnection(idx);
             if (conn.external_id < 0 || conn.external_id >= (int)extNodes.size()) 
                 continue;
             
@@ -413,7 +420,7 @@ std::vector<PortInfo> get_possible_ports(const Topology_enhanced& T, const Attac
     return ports;
 }
 
-bool add_external_at_port(Topology_enhanced& T, const PortInfo& port, int ext_param) {
+bool add_external_at_port(TopologyOverlay& T, const PortInfo& port, int ext_param) {
     // Add one External curve with specified parameter
     int ext_id = T.addExternal(ext_param);
     
@@ -425,17 +432,46 @@ bool add_external_at_port(Topology_enhanced& T, const PortInfo& port, int ext_pa
 // Output Management
 // ============================================================================
 
+// In delta mode every file gets an encoder; variants of one base that land in the same
+// file follow each other, so they share its group
 struct OutputBuffer {
     std::unordered_map<std::string, std::string> buffers;
+    std::unordered_map<std::string, TopoDeltaEncoder> encoders;
+    std::unordered_set<TopologyKey> seen;   // everything classified so far
+    bool delta = false;
     std::mutex mtx;
     
-    void append(const std::string& path, const std::string& line) {
+    // False if T was met before in this run (overlapping specs, repeated bases)
+    bool first_time(const TopologyOverlay& T) {
+        const TopologyKey key = TopologyKey::of(T);
         std::lock_guard<std::mutex> lock(mtx);
-        buffers[path] += line + '\n';
+        return seen.insert(key).second;
+    }
+    
+    void append(const std::string& path, const TopologyOverlay& T) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (delta) {
+            encoders[path].add(T);
+            return;
+        }
+        std::string& buf = buffers[path];
+        TopoLineCompact_enhanced::serializeInto(buf, T);
+        buf.push_back('\n');
     }
     
     void flush_to_disk() {
         std::lock_guard<std::mutex> lock(mtx);
+        for (auto& [path, enc] : encoders) {
+            std::string groups;
+            enc.drain(groups, true);
+            if (groups.empty()) continue;
+            
+            fs::create_directories(fs::path(path).parent_path());
+            if (!TopoDelta::appendToFile(path, groups)) {
+                std::cerr << "[Error] Cannot append to " << path << " (not a delta file?)\n";
+            }
+        }
+        encoders.clear();
         for (const auto& [path, content] : buffers) {
             if (content.empty()) continue;
             
@@ -450,8 +486,8 @@ struct OutputBuffer {
 };
 
 std::string get_output_path(const std::string& output_dir, TopoCategory category, 
-                            const Topology_enhanced& T) {
-    // Create path: output_dir/CATEGORY/len-N/prefix.txt
+                            const Topology_enhanced& T, bool delta) {
+    // Create path: output_dir/CATEGORY/len-N/prefix.txt (.txd in delta mode)
     std::string cat_str = category_name(category);
     int len = (int)T.block.size();
     
@@ -470,7 +506,7 @@ std::string get_output_path(const std::string& output_dir, TopoCategory category
     
     std::string dir = output_dir + "/" + cat_str + "/len-" + std::to_string(len);
     fs::create_directories(dir);
-    return dir + "/" + prefix + ".txt";
+    return dir + "/" + prefix + (delta ? ".txd" : ".txt");
 }
 
 // ============================================================================
@@ -484,6 +520,7 @@ struct Stats {
     std::atomic<int> scft_count{0};
     std::atomic<int> neither_count{0};
     std::atomic<int> error_count{0};
+    std::atomic<int> duplicates{0};
     
     void print() const {
         std::cout << "\n=== Statistics ===\n";
@@ -493,6 +530,7 @@ struct Stats {
         std::cout << "  SCFT:               " << scft_count << "\n";
         std::cout << "  Neither:            " << neither_count << "\n";
         std::cout << "  Errors:             " << error_count << "\n";
+        std::cout << "Duplicates skipped:   " << duplicates << "\n";
     }
 };
 
@@ -502,7 +540,12 @@ void process_topology(const Topology_enhanced& base, const Config& config,
     
     // If no attachment specs, just classify the base topology
     if (config.attachment_specs.empty() || config.classify_only) {
-        TopoCategory cat = classify_topology(base);
+        const TopologyOverlay bare(base);
+        if (!output.first_time(bare)) {
+            stats.duplicates++;
+            return;
+        }
+        TopoCategory cat = classify_topology(bare);
         
         switch (cat) {
             case TopoCategory::LST: stats.lst_count++; break;
@@ -511,9 +554,8 @@ void process_topology(const Topology_enhanced& base, const Config& config,
             case TopoCategory::Error: stats.error_count++; return;
         }
         
-        std::string path = get_output_path(config.output_dir, cat, base);
-        std::string line = TopoLineCompact_enhanced::serialize(base);
-        output.append(path, line);
+        std::string path = get_output_path(config.output_dir, cat, base, config.delta);
+        output.append(path, bare);
         stats.total_output++;
         return;
     }
@@ -549,11 +591,15 @@ void process_topology(const Topology_enhanced& base, const Config& config,
             
             // Try each allowed external parameter
             for (int ext_param : allowed_ext_params) {
-                Topology_enhanced T = base;  // Copy
+                TopologyOverlay T(base);  // the base itself is not copied
                 
                 if (!add_external_at_port(T, port, ext_param)) {
                     continue;
                 }
+                if (!output.first_time(T)) {
+                    stats.duplicates++;
+                    continue;
+                }
                 
                 // Classify
                 TopoCategory cat = classify_topology(T);
@@ -567,9 +613,8 @@ void process_topology(const Topology_enhanced& base, const Config& config,
                 
                 // Only output LST or SCFT
                 if (cat == TopoCategory::LST || cat == TopoCategory::SCFT) {
-                    std::string path = get_output_path(config.output_dir, cat, T);
-                    std::string line = TopoLineCompact_enhanced::serialize(T);
-                    output.append(path, line);
+                    std::string path = get_output_path(config.output_dir, cat, base, config.delta);
+                    output.append(path, T);
                     stats.total_output++;
                 }
             }
@@ -577,19 +622,53 @@ void process_topology(const Topology_enhanced& base, const Config& config,
     }
 }
 
+// True if some spec names an object T has (needs only kinds, sp and ip)
+bool has_attachment_target(const Topology_enhanced& T, const std::vector<AttachmentSpec>& specs) {
+    for (const auto& spec : specs) {
+        switch (spec.type) {
+            case AttachmentSpec::Block:     if (spec.index < (int)T.block.size()) return true; break;
+            case AttachmentSpec::SideLink:  if (spec.index < (int)T.side_links.size()) return true; break;
+            case AttachmentSpec::Instanton: if (spec.index < (int)T.instantons.size()) return true; break;
+        }
+    }
+    return false;
+}
+
 void process_file(const std::string& filepath, const Config& config,
                  OutputBuffer& output, Stats& stats) {
-    std::ifstream infile(filepath);
-    if (!infile) {
+    TxtzLineReader infile;
+    if (!infile.open(filepath)) {
         std::cerr << "Cannot open: " << filepath << "\n";
         return;
     }
     
+    // With attachment specs, a topology lacking every target produces nothing:
+    // decide that from the object counts before decoding connections
+    const bool attaching = !config.attachment_specs.empty() && !config.classify_only;
+    constexpr uint32_t kCountFields = TopoLineCompact_enhanced::Kinds
+                                    | TopoLineCompact_enhanced::SParams
+                                    | TopoLineCompact_enhanced::IParams;
+    std::vector<AttachmentSpec> specs;
+    for (const auto& spec_str : config.attachment_specs) {
+        AttachmentSpec spec;
+        if (parse_attachment_spec(spec_str, spec)) specs.push_back(spec);
+    }
+    
     std::string line;
-    while (std::getline(infile, line)) {
+    Topology_enhanced T;
+    while (infile.getline(line)) {
         if (line.empty()) continue;
         
-        Topology_enhanced T;
+        if (attaching) {
+            if (!TopoLineCompact_enhanced::deserialize(line, T, kCountFields)) {
+                continue;
+            }
+            if (!has_attachment_target(T, specs)) {
+                stats.total_input++;
+                continue;
+            }
+        }
+        
         if (!TopoLineCompact_enhanced::deserialize(line, T)) {
             continue;
         }
@@ -600,6 +679,9 @@ void process_file(const std::string& filepath, const Config& config,
             std::cout << "Processed " << stats.total_input << " topologies...\r" << std::flush;
         }
     }
+    if (!infile.ok()) {
+        std::cerr << "Warning: Corrupt compressed block in " << filepath << "; file read up to it\n";
+    }
 }
 
 // ============================================================================
@@ -615,6 +697,9 @@ void print_usage(const char* prog) {
               << "                  Can be specified multiple times\n"
               << "                  If omitted, only classifies without adding externals\n"
               << "  --classify-only Only classify existing topologies\n"
+              << "  --delta         Write base+delta .txd files: each base once, then only the\n"
+              << "                  externals of its variants (read directly by classify_topology_ext\n"
+              << "                  and filter_P_type_LST)\n"
               << "  -v              Verbose output\n"
               << "  -h              Show this help\n"
               << "\nAttachment Specifications:\n"
@@ -657,6 +742,8 @@ int main(int argc, char* argv[]) {
             config.attachment_specs.push_back(argv[++i]);
         } else if (arg == "--classify-only") {
             config.classify_only = true;
+        } else if (arg == "--delta") {
+            config.delta = true;
         } else if (arg == "-v") {
             config.verbose = true;
         } else {
@@ -689,13 +776,15 @@ int main(int argc, char* argv[]) {
     std::cout << "\n";
     
     OutputBuffer output;
+    output.delta = config.delta;
     Stats stats;
     
     // Process input
     if (fs::is_directory(config.input_path)) {
-        // Process all .txt files in directory
+        // Process all .txt / .txtz files in directory
         for (const auto& entry : fs::recursive_directory_iterator(config.input_path)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            const auto ext = entry.path().extension();
+            if (entry.is_regular_file() && (ext == ".txt" || ext == ".txtz")) {
                 if (config.verbose) {
                     std::cout << "Processing: " << entry.path().filename() << "\n";
                 }
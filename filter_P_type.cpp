@@ -14,6 +14,7 @@
 #include "Tensor.h"
 #include "Topology_enhanced.h"
 #include "TopologyDB_enhanced.hpp"
+#include "TopoColumnar.hpp"
 #include "TopoLineCompact_enhanced.hpp"
 #include "Theory_enhanced.h"
 
@@ -403,49 +404,6 @@ int main(int argc, char** argv) {
         if (arg == "--quiet" || arg == "-q") quiet = true;
     }
     
-    // Load topologies
-    std::vector<TopologyDB_enhanced::Record> records;
-    
-    // Try as line-compact file first
-    std::ifstream fin(input_path);
-    if (fin) {
-        std::string line;
-        int line_num = 0;
-        while (std::getline(fin, line)) {
-            line_num++;
-            if (line.empty()) continue;
-            
-            Topology_enhanced T;
-            if (TopoLineCompact_enhanced::deserialize(line, T)) {
-                if (T.name.empty()) {
-                    T.name = "line_" + std::to_string(line_num);
-                }
-                records.push_back({T.name, std::move(T)});
-            } else {
-                std::cerr << "[Warning] Failed to parse line " << line_num << "\n";
-            }
-        }
-        fin.close();
-        std::cout << "Loaded " << records.size() << " topologies from line-compact file\n";
-    }
-    
-    // If no records, try as DB
-    if (records.empty()) {
-        try {
-            TopologyDB_enhanced in_db(input_path);
-            records = in_db.loadAll();
-            std::cout << "Loaded " << records.size() << " topologies from DB\n";
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load: " << e.what() << "\n";
-            return 1;
-        }
-    }
-    
-    if (records.empty()) {
-        std::cerr << "No topologies loaded!\n";
-        return 1;
-    }
-    
     // Filter and collect statistics
     std::ofstream out_file(output_path);
     if (!out_file) {
@@ -464,22 +422,22 @@ int main(int argc, char** argv) {
         std::cout << "\n";
     }
     
-    for (auto& rec : records) {
+    // Records are filtered as they are read, one in memory at a time
+    std::string line;   // reused output line
+    auto process = [&](TopologyDB_enhanced::Record& rec) {
         total++;
         
         // Progress display
         if (!quiet) {
             if (verbose) {
                 // Verbose: show each topology
-                std::cout << "[" << total << "/" << records.size() << "] " 
+                std::cout << "[" << total << "] " 
                           << "Processing: " << rec.topo.name << "...";
                 std::cout.flush();
             } else {
                 // Normal: show every 100 or key milestones
-                if (total % 100 == 0 || total == 1 || total == records.size()) {
-                    std::cout << "Processed " << total << " / " << records.size() 
-                              << " (" << (100.0 * total / records.size()) << "%)...\r" 
-                              << std::flush;
+                if (total % 100 == 0 || total == 1) {
+                    std::cout << "Processed " << total << "...\r" << std::flush;
                 }
             }
         }
@@ -504,8 +462,10 @@ int main(int argc, char** argv) {
             // Check if P-type only
             if (has_only_P_type_endpoints(rec.topo)) {
                 // Write in line-compact format
-                std::string line = TopoLineCompact_enhanced::serialize(rec.topo);
-                out_file << line << "\n";
+                line.clear();
+                TopoLineCompact_enhanced::serializeInto(line, rec.topo);
+                line.push_back('\n');
+                out_file << line;
                 p_type_count++;
                 
                 if (verbose) {
@@ -527,15 +487,55 @@ int main(int argc, char** argv) {
                 std::cerr << "\n[Error] " << rec.topo.name << ": " << e.what() << "\n";
             }
         }
+    };
+    
+    // Try as line-compact file first (a columnar store goes straight to the DB path)
+    std::ifstream fin(input_path);
+    if (fin && !TopoColumnar::isColumnarFile(input_path)) {
+        std::string in_line;
+        int line_num = 0;
+        TopologyDB_enhanced::Record rec;
+        while (std::getline(fin, in_line)) {
+            line_num++;
+            if (in_line.empty()) continue;
+            
+            if (TopoLineCompact_enhanced::deserialize(in_line, rec.topo)) {
+                rec.topo.name = "line_" + std::to_string(line_num);   // lines carry no name
+                rec.name = rec.topo.name;
+                process(rec);
+            } else {
+                std::cerr << "[Warning] Failed to parse line " << line_num << "\n";
+            }
+        }
+        fin.close();
+        if (!quiet && !verbose && total > 0) std::cout << "\n";
+        std::cout << "Loaded " << total << " topologies from line-compact file\n";
     }
     
-    // Close output file
-    out_file.close();
+    // If no records, try as DB, streamed through a cursor
+    if (total == 0) {
+        try {
+            TopologyDB_enhanced in_db(input_path);
+            if (!in_db.forEach(process)) {
+                std::cerr << "Failed to load: cannot open " << input_path << "\n";
+                return 1;
+            }
+            if (!quiet && !verbose && total > 0) std::cout << "\n";
+            std::cout << "Loaded " << total << " topologies from DB\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load: " << e.what() << "\n";
+            return 1;
+        }
+    }
     
-    if (!quiet && !verbose) {
-        std::cout << "\n";  // Final newline after progress
+    if (total == 0) {
+        std::cerr << "No topologies loaded!\n";
+        return 1;
     }
     
+    // Close output file
+    out_file.close();
+    
     if (!quiet) {
         std::cout << "\n";
         std::cout << "========================================\n";
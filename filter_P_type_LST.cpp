@@ -9,359 +9,271 @@
 #include <map>
 #include <algorithm>
 #include <sstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
 #include <Eigen/Dense>
 
-#include "Tensor.h"
 #include "Topology_enhanced.h"
 #include "TopologyDB_enhanced.hpp"
 #include "TopoLineCompact_enhanced.hpp"
-#include "Theory_enhanced.h"
+#include "EndpointAnalysis.hpp"
+#include "LineIngest.hpp"
+#include "TopoColumnar.hpp"
 
-// ===== Build TheoryGraph from Topology =====
-struct GraphBuildResult {
-    TheoryGraph G;
+// ===== Streaming pipeline =====
+// The input is memory-mapped and cut into newline-aligned chunks of kChunkBytes
+// (LineIngest.hpp); a DB input is read through a cursor into chunks of kChunkLines
+// records. Workers parse and filter whole chunks. At most 2 x threads chunks are in
+// flight (queued, running, or waiting in the reorder buffer), so memory stays bounded
+// for any input size. Finished chunks are written strictly in input order; histograms
+// are kept per worker and merged at the end.
+static constexpr std::uintmax_t kChunkBytes = 256u << 10;
+static constexpr size_t kChunkLines = 2048;
+
+struct FilterOptions {
+    int threads = 1;
+    bool verbose = false;
+    bool quiet = false;
+    bool memo = true;       // memoized decoration blowdown (BlowdownMemo.hpp)
+    bool verify = false;    // also run the plain ForcedBlowdown and compare
+    EndpointCache* cache = nullptr;
 };
 
-static inline void ensure_linear_chain(const Topology_enhanced& T,
-                                       std::vector<InteriorStructure>& out_chain){
-    if (!T.l_connection.empty()) { out_chain = T.l_connection; return; }
-    const int n = (int)T.block.size();
-    if (n <= 1) return;
-    out_chain.reserve(n-1);
-    for (int i=1; i<n; ++i) out_chain.push_back({i-1, i});
-}
+struct FilterChunk {
+    size_t seq = 0;
+    const LineIngest* ingest = nullptr;                   // line-compact input: chunk `index`
+    size_t index = 0;
+    std::vector<TopologyDB_enhanced::Record> records;     // DB input
+    std::uintmax_t end_offset = 0;                        // progress position after this chunk
+};
+
+struct FilterChunkResult {
+    std::string out;      // P-type lines
+    std::string log;      // verbose stdout text
+    std::string err;      // stderr text
+    long long loaded = 0, total = 0, p_type = 0, mismatches = 0;
+    std::uintmax_t end_offset = 0;
+};
 
-static GraphBuildResult build_graph_from_topology(const Topology_enhanced& T){
-    GraphBuildResult R;
+using EndpointHistogram = std::map<std::vector<int>, int>;
 
-    // DEBUG: Print topology info
+static void filter_record(const Topology_enhanced& T, const FilterOptions& opt,
+                          FilterChunkResult& res, EndpointHistogram& hist) {
+    res.total++;
+    if (opt.verbose) res.log += "Processing: " + T.name + "...";
     
-
-    // 1) Main block nodes
-    std::vector<int> nodeIdx_block(T.block.size(), -1);
-    for (size_t i=0; i<T.block.size(); ++i){
-        const auto& b = T.block[i];
-        Spec sp;
-        switch (b.kind){
-            case LKind::g: sp = Spec{Kind::Node,         b.param}; break;
-            case LKind::L: sp = Spec{Kind::InteriorLink, b.param}; break;
-            case LKind::S: sp = Spec{Kind::SideLink,     b.param}; break;
-            case LKind::I: sp = Spec{Kind::SideLink,     b.param}; break;
-            case LKind::E: sp = Spec{Kind::External,     b.param}; break;  // ✅ External
+    try {
+        // One blowdown per topology: histogram and P-type check share the report
+        const EndpointReport report = opt.cache ? opt.cache->get(T, opt.memo)
+                                                : analyzeEndpoints(T, opt.memo);
+        if (!report.error.empty()) {
+            res.err += "[Error] Exception in " + T.name + ": " + report.error + "\n";
         }
         
-        nodeIdx_block[i] = R.G.add(sp).id;
+        if (opt.verify) {
+            const EndpointReport full = analyzeEndpoints(T, false);
+            // Eigen's != asserts on a size difference, which is itself a mismatch
+            const bool same_form = full.reduced.rows() == report.reduced.rows() &&
+                                   full.reduced.cols() == report.reduced.cols() &&
+                                   full.reduced == report.reduced;
+            if (full.ok != report.ok || !same_form) {
+                res.err += "[Verify] Mismatch in " + T.name + "\n";
+                res.mismatches++;
+            }
+        }
         
-    }
-
-    // 2) Decoration nodes (SideLinks)
-    std::vector<int> nodeIdx_S(T.side_links.size(), -1);
-    for (size_t i=0; i<T.side_links.size(); ++i) {
+        auto ep_types = report.histogramKey();
+        if (!ep_types.empty()) {
+            hist[ep_types]++;
+            
+            if (opt.verbose) {
+                res.log += " Endpoints: [";
+                for (size_t i = 0; i < ep_types.size(); ++i) {
+                    if (i > 0) res.log += ", ";
+                    res.log += std::to_string(ep_types[i]);
+                }
+                res.log += "]";
+            }
+        }
         
-        nodeIdx_S[i] = R.G.add(Spec{Kind::SideLink, T.side_links[i].param}).id;
+        // Check if P-type only
+        if (report.isPTypeOnly()) {
+            // Write in line-compact format
+            TopoLineCompact_enhanced::serializeInto(res.out, T);
+            res.out += '\n';
+            res.p_type++;
+            if (opt.verbose) res.log += " ✓ P-TYPE!\n";
+        } else if (opt.verbose) {
+            res.log += " (filtered)\n";
+        }
         
+    } catch (const std::exception& e) {
+        if (opt.verbose) res.log += std::string(" ERROR: ") + e.what() + "\n";
+        else res.err += "\n[Error] " + T.name + ": " + e.what() + "\n";
     }
+}
 
-    // 3) Decoration nodes (Instantons)
-    std::vector<int> nodeIdx_I(T.instantons.size(), -1);
-    for (size_t i=0; i<T.instantons.size(); ++i) {
-        
-        nodeIdx_I[i] = R.G.add(Spec{Kind::SideLink, T.instantons[i].param}).id;
-        
+static void filter_chunk(FilterChunk& chunk, const FilterOptions& opt, IngestBatch& batch,
+                         FilterChunkResult& res, EndpointHistogram& hist) {
+    res.end_offset = chunk.end_offset;
+    if (chunk.ingest) {
+        chunk.ingest->parseChunk(chunk.index, batch);
+        for (const auto& rec : batch) {
+            if (rec.status) {
+                res.loaded++;
+                filter_record(rec.topo, opt, res, hist);
+            } else {
+                res.err += "[Warning] Failed to parse line " + std::to_string(rec.line) + " ("
+                         + TopoLineCompact_enhanced::errorString(rec.status.code) + " at column "
+                         + std::to_string(rec.status.pos + 1) + ")\n";
+            }
+        }
     }
-
-    // 4) External curve nodes
-    std::vector<int> nodeIdx_E(T.externals.size(), -1);
-    for (size_t i=0; i<T.externals.size(); ++i) {
-        
-        nodeIdx_E[i] = R.G.add(Spec{Kind::External, T.externals[i].param}).id;
-        
+    for (auto& rec : chunk.records) {
+        res.loaded++;
+        filter_record(rec.topo, opt, res, hist);
     }
+}
 
-    // 5) Interior connections
-    std::vector<InteriorStructure> chain;
-    ensure_linear_chain(T, chain);
-    for (auto e : chain)
-        R.G.connect(NodeRef{nodeIdx_block.at(e.u)}, NodeRef{nodeIdx_block.at(e.v)});
+class FilterPipeline {
+public:
+    long long loaded = 0, total = 0, p_type = 0, mismatches = 0;
+    EndpointHistogram histogram;
+    std::uintmax_t input_bytes = 0;   // progress denominator in bytes, 0 if unknown
 
-    // 6) SideLink connections
-    for (auto e : T.s_connection)
-        R.G.connect(NodeRef{nodeIdx_S.at(e.v)}, NodeRef{nodeIdx_block.at(e.u)});
+    FilterPipeline(std::ofstream& out, const FilterOptions& opt) : out_(out), opt_(opt) { start(); }
+    ~FilterPipeline() { finish(); }
 
-    // 7) Instanton connections
-    for (auto e : T.i_connection)
-        R.G.connect(NodeRef{nodeIdx_I.at(e.v)}, NodeRef{nodeIdx_block.at(e.u)});
+    // Blocks while the in-flight window is full
+    void submit(FilterChunk&& chunk) {
+        std::unique_lock<std::mutex> lk(mtx_);
+        space_cv_.wait(lk, [&]{ return submitted_ - next_commit_ < window_; });
+        chunk.seq = submitted_++;
+        queue_.push_back(std::move(chunk));
+        work_cv_.notify_one();
+    }
 
-    // 8) External connections with AttachmentPoint support
-    
-    for (size_t idx = 0; idx < T.e_connection.size(); ++idx) {
-        const auto& conn = T.e_connection[idx];
-        
-        
-        if (conn.external_id < 0 || conn.external_id >= (int)nodeIdx_E.size()) {
-            
-            continue;
-        }
-        
-        int parent_node_id = -1;
-        switch (conn.parent_type) {
-            case 0:  // Block
-                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_block.size()) {
-                    parent_node_id = nodeIdx_block[conn.parent_id];
-                    
-                } else {
-                    
-                }
-                break;
-            case 1:  // SideLink
-                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_S.size()) {
-                    parent_node_id = nodeIdx_S[conn.parent_id];
-                    
-                } else {
-                    
-                }
-                break;
-            case 2:  // Instanton
-                if (conn.parent_id >= 0 && conn.parent_id < (int)nodeIdx_I.size()) {
-                    parent_node_id = nodeIdx_I[conn.parent_id];
-                    
-                } else {
-                    
-                }
-                break;
-            default:
-                
-                break;
-        }
-        
-        if (parent_node_id >= 0) {
-            
-            // External.Left -> Parent.port_idx with AttachmentPoint
-            AttachmentPoint ap(conn.port_idx);
-            try {
-                R.G.connect(NodeRef{nodeIdx_E[conn.external_id]}, AttachmentPoint(-1), 
-                           NodeRef{parent_node_id}, ap);
-                
-            } catch (const std::exception& e) {
-                
-            }
+    // Drain all chunks and join the workers
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (workers_.empty()) return;
+            closed_ = true;
         }
+        work_cv_.notify_all();
+        for (auto& th : workers_) th.join();
+        workers_.clear();
+        if (!opt_.quiet && !opt_.verbose && progress_shown_) std::cerr << "\n";
     }
 
-    return R;
-}
+    // Reuse the pipeline for a second input (DB fallback)
+    void restart() {
+        finish();
+        start();
+    }
 
-// ===== Check if all endpoints are P-type =====
-bool has_only_P_type_endpoints(const Topology_enhanced& T) {
-    try {
-        
-        
-        // 1. Build TheoryGraph (External 포함)
-        auto R = build_graph_from_topology(T);
-        
-        
-        
-        
-        // Print each node's tensor size
-        for (int i = 0; i < R.G.nodeCount(); ++i) {
-            try {
-                auto IF_node = R.G.IF(i);
-                
-            } catch (const std::exception& e) {
-                
-            }
-        }
-        
-        
-        
-        // 2. Get Intersection Form
-        Eigen::MatrixXi IF;
-        try {
-            IF = R.G.ComposeIF_Gluing();
-            
-        } catch (const std::exception& e) {
-            
-            throw;
-        }
-        
-        
-        
-        if (IF.rows() == 0 || IF.cols() == 0) {
-            std::cerr << "[Debug] Empty IF for " << T.name << "\n";
-            return false;
-        }
-        
-        if (IF.rows() != IF.cols()) {
-            std::cerr << "[Debug] Non-square IF for " << T.name 
-                      << ": " << IF.rows() << "x" << IF.cols() << "\n";
-            return false;
-        }
-        
-        // 3. Create Tensor and perform full blowdown
-        Tensor tensor;
-        
-        // CRITICAL: Validate matrix before SetIF
-        for (int i = 0; i < IF.rows(); ++i) {
-            if (IF(i, i) > 0) {
-                std::cerr << "[Debug] Positive diagonal element at " << i 
-                          << " in " << T.name << "\n";
-                // This might be valid, but unusual for LST
-            }
-        }
-        
-        tensor.SetIF(IF);
-        tensor.Setb0Q();  // ✅ Initialize b0 before blowdown
-        
-        // SAFETY: Check after SetIF
-        if (tensor.GetT() <= 0) {
-            std::cerr << "[Debug] Invalid tensor size after SetIF: " 
-                      << tensor.GetT() << "\n";
-            return false;
-        }
-        
-        // Check GetIntersectionForm is valid
-        Eigen::MatrixXi IF_check = tensor.GetIntersectionForm();
-        if (IF_check.rows() != IF.rows()) {
-            std::cerr << "[Debug] Tensor IF size mismatch: " 
-                      << IF_check.rows() << " vs " << IF.rows() << "\n";
-            return false;
-        }
-        
-        tensor.ForcedBlowdown();
-        
-        // 4. Get final (endpoint geometry)
-        Eigen::MatrixXi IF_final = tensor.GetIntersectionForm();
-        
-        // SAFETY: Check after blowdown
-        if (IF_final.rows() == 0 || IF_final.cols() == 0) {
-            return false;
-        }
-        
-        // SAFETY: Check matrix is square
-        if (IF_final.rows() != IF_final.cols()) {
-            std::cerr << "[Warning] Non-square matrix after blowdown: " 
-                      << IF_final.rows() << "x" << IF_final.cols() << "\n";
-            return false;
-        }
-        
-        // 5. Check endpoints in final configuration
-        const int n = IF_final.rows();
-        
-        // Special case: 1x1 matrix (single curve remaining)
-        if (n == 1) {
-            return (IF_final(0, 0) == 0);  // P-type if value is 0
-        }
-        
-        // General case: Find endpoints (degree 1 in adjacency graph)
-        std::vector<int> endpoints;
-        for (int i = 0; i < n; ++i) {
-            int degree = 0;
-            for (int j = 0; j < n; ++j) {
-                if (i != j && IF_final(i, j) != 0) {
-                    degree++;
-                }
-            }
-            
-            if (degree == 1) {
-                endpoints.push_back(i);
-            }
-        }
-        
-        if (endpoints.empty()) {
-            return false;
-        }
-        
-        // 6. Check all endpoints have self-intersection = 0 (P-type)
-        for (int ep : endpoints) {
-            // SAFETY: Check bounds
-            if (ep < 0 || ep >= IF_final.rows()) {
-                std::cerr << "[Warning] Endpoint index out of bounds: " << ep << "\n";
-                return false;
-            }
-            if (IF_final(ep, ep) != 0) {
-                return false;
+private:
+    std::ofstream& out_;
+    const FilterOptions& opt_;
+
+    std::mutex mtx_;
+    std::condition_variable work_cv_, space_cv_;
+    std::deque<FilterChunk> queue_;
+    std::map<size_t, FilterChunkResult> reorder_;
+    size_t submitted_ = 0, next_commit_ = 0, window_ = 2;
+    bool closed_ = false;
+    std::vector<std::thread> workers_;
+
+    std::chrono::steady_clock::time_point last_progress_;
+    bool progress_shown_ = false;
+
+    void start() {
+        closed_ = false;
+        submitted_ = next_commit_ = 0;
+        window_ = 2 * (size_t)std::max(1, opt_.threads);
+        for (int i = 0; i < std::max(1, opt_.threads); ++i) workers_.emplace_back([this]{ work(); });
+    }
+
+    void work() {
+        EndpointHistogram local;
+        IngestBatch batch;
+        for (;;) {
+            FilterChunk chunk;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                work_cv_.wait(lk, [&]{ return closed_ || !queue_.empty(); });
+                if (queue_.empty()) break;
+                chunk = std::move(queue_.front());
+                queue_.pop_front();
             }
+
+            FilterChunkResult res;
+            filter_chunk(chunk, opt_, batch, res, local);
+
+            std::lock_guard<std::mutex> lk(mtx_);
+            reorder_.emplace(chunk.seq, std::move(res));
+            commit_ready();
         }
-        
-        return true;
-        
-    } catch (const std::out_of_range& e) {
-        std::cerr << "[Error] Out of range in " << T.name << ": " << e.what() << "\n";
-        return false;
-    } catch (const std::exception& e) {
-        std::cerr << "[Error] Exception in " << T.name << ": " << e.what() << "\n";
-        return false;
-    } catch (...) {
-        std::cerr << "[Error] Unknown exception in " << T.name << "\n";
-        return false;
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const auto& [key, count] : local) histogram[key] += count;
     }
-}
 
-// ===== Get endpoint types for statistics =====
-std::vector<int> get_endpoint_types(const Topology_enhanced& T) {
-    std::vector<int> types;
-    
-    try {
-        auto R = build_graph_from_topology(T);
-        Eigen::MatrixXi IF = R.G.ComposeIF_Gluing();
-        
-        if (IF.rows() == 0 || IF.cols() == 0) return types;
-        
-        Tensor tensor;
-        tensor.SetIF(IF);
-        tensor.Setb0Q();  // ✅ Initialize b0 before blowdown
-        
-        if (tensor.GetT() == 0) return types;
-        
-        tensor.ForcedBlowdown();
-        
-        Eigen::MatrixXi IF_final = tensor.GetIntersectionForm();
-        
-        if (IF_final.rows() == 0 || IF_final.cols() == 0) return types;
-        if (IF_final.rows() != IF_final.cols()) return types;
-        
-        const int n = IF_final.rows();
-        
-        if (n == 1) {
-            types.push_back(IF_final(0, 0));
-            return types;
-        }
-        
-        // Find endpoints
-        for (int i = 0; i < n; ++i) {
-            int degree = 0;
-            for (int j = 0; j < n; ++j) {
-                if (i != j && IF_final(i, j) != 0) degree++;
-            }
-            
-            if (degree == 1) {
-                if (i >= 0 && i < IF_final.rows()) {
-                    types.push_back(IF_final(i, i));
-                }
-            }
+    // Write every finished chunk that is next in input order; called with mtx_ held
+    void commit_ready() {
+        bool advanced = false;
+        for (auto it = reorder_.find(next_commit_); it != reorder_.end(); it = reorder_.find(next_commit_)) {
+            auto& r = it->second;
+            out_ << r.out;
+            if (!r.err.empty()) std::cerr << r.err;
+            if (opt_.verbose && !opt_.quiet) std::cout << r.log << std::flush;
+            loaded += r.loaded; total += r.total; p_type += r.p_type; mismatches += r.mismatches;
+            const std::uintmax_t pos = r.end_offset;
+            reorder_.erase(it);
+            ++next_commit_;
+            advanced = true;
+            show_progress(pos);
         }
-        
-    } catch (...) {
-        // Silently fail for statistics
+        if (advanced) space_cv_.notify_all();
     }
-    
-    return types;
-}
+
+    // Throttled to a few updates per second, on stderr so stdout stays clean
+    void show_progress(std::uintmax_t pos) {
+        if (opt_.quiet || opt_.verbose) return;
+        const auto now = std::chrono::steady_clock::now();
+        if (progress_shown_ && now - last_progress_ < std::chrono::milliseconds(250)) return;
+        last_progress_ = now;
+        progress_shown_ = true;
+        std::cerr << "Processed " << total;
+        if (input_bytes > 0) std::cerr << " (" << (100.0 * pos / input_bytes) << "%)";
+        std::cerr << " | P-type: " << p_type << "...\r" << std::flush;
+    }
+};
 
 // ===== Main =====
 int main(int argc, char** argv) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> [--verbose]\n";
+        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> [--verbose] [-j N]\n";
         std::cerr << "\n";
         std::cerr << "Filters LST topologies to only those with P-type endpoints.\n";
         std::cerr << "P-type endpoint = self-intersection becomes 0 after full blowdown.\n";
         std::cerr << "\n";
         std::cerr << "Input/Output formats:\n";
         std::cerr << "  - Line-compact text file (.txt)\n";
+        std::cerr << "  - Base+delta variants (.txd, external_generator --delta), input only\n";
+        std::cerr << "  - Block-compressed line-compact (.txtz, topo_txtz c), input only\n";
         std::cerr << "\n";
         std::cerr << "Options:\n";
         std::cerr << "  --verbose    Show detailed progress for each topology\n";
         std::cerr << "  --quiet      Show minimal output\n";
+        std::cerr << "  --cache PATH Reuse endpoint reports stored in PATH (created/updated)\n";
+        std::cerr << "  -j N         Worker threads (default: hardware concurrency)\n";
+        std::cerr << "  --no-memo    Blow down the whole glued form (no memoized side links)\n";
+        std::cerr << "  --verify     Check every memoized result against the plain blowdown\n";
         std::cerr << "\n";
         std::cerr << "Example:\n";
         std::cerr << "  " << argv[0] << " g.txt P_type_output.txt\n";
@@ -375,55 +287,29 @@ int main(int argc, char** argv) {
     // Parse options
     bool verbose = false;
     bool quiet = false;
+    std::string cache_path;
+    FilterOptions opt;
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
     for (int i = 3; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--verbose" || arg == "-v") verbose = true;
         if (arg == "--quiet" || arg == "-q") quiet = true;
+        if (arg == "--cache" && i + 1 < argc) cache_path = argv[++i];
+        if ((arg == "-j" || arg == "--threads") && i + 1 < argc) opt.threads = std::max(1, std::atoi(argv[++i]));
+        if (arg == "--no-memo") opt.memo = false;
+        if (arg == "--verify") opt.verify = true;
     }
+    opt.verbose = verbose;
+    opt.quiet = quiet;
     
-    // Load topologies
-    std::vector<TopologyDB_enhanced::Record> records;
-    
-    // Try as line-compact file first
-    std::ifstream fin(input_path);
-    if (fin) {
-        std::string line;
-        int line_num = 0;
-        while (std::getline(fin, line)) {
-            line_num++;
-            if (line.empty()) continue;
-            
-            Topology_enhanced T;
-            if (TopoLineCompact_enhanced::deserialize(line, T)) {
-                if (T.name.empty()) {
-                    T.name = "line_" + std::to_string(line_num);
-                }
-                records.push_back({T.name, std::move(T)});
-            } else {
-                std::cerr << "[Warning] Failed to parse line " << line_num << "\n";
-            }
-        }
-        fin.close();
-        std::cout << "Loaded " << records.size() << " topologies from line-compact file\n";
-    }
-    
-    // If no records, try as DB
-    if (records.empty()) {
-        try {
-            TopologyDB_enhanced in_db(input_path);
-            records = in_db.loadAll();
-            std::cout << "Loaded " << records.size() << " topologies from DB\n";
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load: " << e.what() << "\n";
-            return 1;
+    EndpointCache cache;
+    if (!cache_path.empty()) {
+        opt.cache = &cache;
+        if (cache.load(cache_path) && !quiet) {
+            std::cout << "Loaded " << cache.size() << " cached endpoint reports\n";
         }
     }
     
-    if (records.empty()) {
-        std::cerr << "No topologies loaded!\n";
-        return 1;
-    }
-    
     // Filter and collect statistics
     std::ofstream out_file(output_path);
     if (!out_file) {
@@ -431,9 +317,6 @@ int main(int argc, char** argv) {
         return 1;
     }
     
-    int total = 0, p_type_count = 0;
-    std::map<std::vector<int>, int> endpoint_histogram;
-    
     if (!quiet) {
         std::cout << "\nProcessing topologies...\n";
         if (verbose) {
@@ -442,76 +325,81 @@ int main(int argc, char** argv) {
         std::cout << "\n";
     }
     
-    for (auto& rec : records) {
-        total++;
-        
-        // Progress display
-        if (!quiet) {
-            if (verbose) {
-                // Verbose: show each topology
-                std::cout << "[" << total << "/" << records.size() << "] " 
-                          << "Processing: " << rec.topo.name << "...";
-                std::cout.flush();
-            } else {
-                // Normal: show every 100 or key milestones
-                if (total % 100 == 0 || total == 1 || total == records.size()) {
-                    std::cout << "Processed " << total << " / " << records.size() 
-                              << " (" << (100.0 * total / records.size()) << "%)...\r" 
-                              << std::flush;
-                }
-            }
+    FilterPipeline pipe(out_file, opt);
+    
+    // Stream as line-compact file first (a columnar store goes straight to the DB path)
+    LineIngest ingest;
+    if (!TopoColumnar::isColumnarFile(input_path) && ingest.open(input_path, kChunkBytes, opt.threads)) {
+        pipe.input_bytes = ingest.size();
+        for (size_t i = 0; i < ingest.chunks().size(); ++i) {
+            FilterChunk chunk;
+            chunk.ingest = &ingest;
+            chunk.index = i;
+            chunk.end_offset = ingest.chunks()[i].end;
+            pipe.submit(std::move(chunk));
         }
-        
+        pipe.finish();
+        ingest.close();
+        std::cout << "Loaded " << pipe.loaded << " topologies from line-compact file\n";
+    }
+    
+    // If no records, try as DB: streamed through a cursor, kChunkLines records per chunk
+    if (pipe.loaded == 0) {
         try {
-            // Get endpoint types for statistics
-            auto ep_types = get_endpoint_types(rec.topo);
-            if (!ep_types.empty()) {
-                std::sort(ep_types.begin(), ep_types.end());
-                endpoint_histogram[ep_types]++;
-                
-                if (verbose) {
-                    std::cout << " Endpoints: [";
-                    for (size_t i = 0; i < ep_types.size(); ++i) {
-                        if (i > 0) std::cout << ", ";
-                        std::cout << ep_types[i];
-                    }
-                    std::cout << "]";
-                }
+            TopologyDB_enhanced in_db(input_path);
+            TopologyDB_enhanced::Cursor cur(in_db);
+            if (!cur.isOpen()) {
+                std::cerr << "Failed to load: cannot open " << input_path << "\n";
+                return 1;
             }
-            
-            // Check if P-type only
-            if (has_only_P_type_endpoints(rec.topo)) {
-                // Write in line-compact format
-                std::string line = TopoLineCompact_enhanced::serialize(rec.topo);
-                out_file << line << "\n";
-                p_type_count++;
-                
-                if (verbose) {
-                    std::cout << " ✓ P-TYPE!\n";
-                } else if (!quiet && p_type_count % 50 == 0) {
-                    // Show milestone in normal mode
-                    std::cout << "\n  → Found " << p_type_count << " P-type topologies so far...\n";
-                }
-            } else {
-                if (verbose) {
-                    std::cout << " (filtered)\n";
+            pipe.restart();
+            // Cursor positions are byte offsets only in a text DB
+            std::error_code ec;
+            pipe.input_bytes = (in_db.isColumnar() || in_db.isLogStructured())
+                             ? 0 : std::filesystem::file_size(input_path, ec);
+            if (ec) pipe.input_bytes = 0;
+
+            FilterChunk chunk;
+            TopologyDB_enhanced::Record rec;
+            while (cur.next(rec)) {
+                chunk.records.push_back(std::move(rec));
+                if (chunk.records.size() == kChunkLines) {
+                    chunk.end_offset = cur.position();
+                    pipe.submit(std::move(chunk));
+                    chunk = FilterChunk();
                 }
             }
-            
-        } catch (const std::exception& e) {
-            if (verbose) {
-                std::cout << " ERROR: " << e.what() << "\n";
-            } else {
-                std::cerr << "\n[Error] " << rec.topo.name << ": " << e.what() << "\n";
+            if (!chunk.records.empty()) {
+                chunk.end_offset = cur.position();
+                pipe.submit(std::move(chunk));
             }
+            pipe.finish();
+            std::cout << "Loaded " << pipe.loaded << " topologies from DB\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load: " << e.what() << "\n";
+            return 1;
         }
     }
     
+    if (pipe.loaded == 0) {
+        std::cerr << "No topologies loaded!\n";
+        return 1;
+    }
+    
+    const long long total = pipe.total;
+    const long long p_type_count = pipe.p_type;
+    const auto& endpoint_histogram = pipe.histogram;
+    
     // Close output file
     out_file.close();
     
-    if (!quiet && !verbose) {
-        std::cout << "\n";  // Final newline after progress
+    if (!cache_path.empty()) {
+        if (!cache.save(cache_path)) {
+            std::cerr << "[Error] cannot write cache " << cache_path << "\n";
+        } else if (!quiet) {
+            std::cout << "\nEndpoint cache: " << cache.hits() << " hits, " << cache.misses()
+                      << " misses, " << cache.size() << " entries\n";
+        }
     }
     
     if (!quiet) {
@@ -524,6 +412,9 @@ int main(int argc, char** argv) {
     std::cout << "P-type endpoints only:   " << p_type_count 
               << " (" << (total > 0 ? 100.0 * p_type_count / total : 0) << "%)\n";
     std::cout << "Output saved to:         " << output_path << "\n";
+    if (opt.verify) {
+        std::cout << "Verify (memo vs full):   " << pipe.mismatches << " mismatches\n";
+    }
     if (!quiet) {
         std::cout << "========================================\n\n";
     }
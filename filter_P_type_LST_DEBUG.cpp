@@ -432,6 +432,7 @@ int main(int argc, char** argv) {
     std::cout << "Processing " << (limit > 0 ? std::min(limit, (int)records.size()) : records.size()) 
               << " topologies...\n\n";
     
+    std::string line;   // reused output line
     for (auto& rec : records) {
         total++;
         
@@ -446,8 +447,10 @@ int main(int argc, char** argv) {
         
         try {
             if (has_only_P_type_endpoints(rec.topo)) {
-                std::string line = TopoLineCompact_enhanced::serialize(rec.topo);
-                out_file << line << "\n";
+                line.clear();
+                TopoLineCompact_enhanced::serializeInto(line, rec.topo);
+                line.push_back('\n');
+                out_file << line;
                 p_type_count++;
                 std::cout << "[RESULT] ✓ P-TYPE - Added to output\n";
             } else {
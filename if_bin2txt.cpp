@@ -0,0 +1,77 @@
+// if_bin2txt.cpp
+// Converts binary intersection-form files (.ifb) back to the classifier text format
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "IFBinary.hpp"
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " <input.ifb> [output.txt] [-r N] [--count]\n";
+    std::cerr << "  Writes every matrix in the original text format (stdout if no output)\n";
+    std::cerr << "  -r N      only record N (0-based), random access through the index\n";
+    std::cerr << "  --count   print the number of records and exit\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){ usage(argv[0]); return 1; }
+
+    std::string inPath, outPath;
+    long long only = -1;
+    bool count_only = false;
+    for (int i=1; i<argc; ++i){
+        const std::string a = argv[i];
+        if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+        else if (a=="-r" && i+1<argc) only = std::stoll(argv[++i]);
+        else if (a=="--count") count_only = true;
+        else if (inPath.empty()) inPath = a;
+        else if (outPath.empty()) outPath = a;
+        else { usage(argv[0]); return 1; }
+    }
+
+    IFBinaryReader rd;
+    if (!rd.open(inPath)){
+        std::cerr << "cannot open " << inPath << " (not an .ifb file?)\n";
+        return 1;
+    }
+    if (count_only){
+        std::cout << rd.size() << "\n";
+        return 0;
+    }
+
+    std::ofstream fout;
+    if (!outPath.empty()){
+        fout.open(outPath, std::ios::binary | std::ios::trunc);
+        if (!fout){ std::cerr << "cannot open " << outPath << "\n"; return 1; }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : fout;
+
+    size_t first = 0, last = rd.size();
+    if (only >= 0){
+        if ((size_t)only >= rd.size()){
+            std::cerr << "record " << only << " out of range (" << rd.size() << " records)\n";
+            return 1;
+        }
+        first = (size_t)only;
+        last  = first + 1;
+    }
+
+    std::string buf;
+    buf.reserve(1<<22);
+    Eigen::MatrixXi M;
+    for (size_t i=first; i<last; ++i){
+        if (!rd.get(i, M)){
+            std::cerr << "corrupt record " << i << "\n";
+            return 1;
+        }
+        IFBinary::appendMatrixText(buf, M);
+        if (buf.size() >= (1u<<22)){
+            out.write(buf.data(), (std::streamsize)buf.size());
+            buf.clear();
+        }
+    }
+    out.write(buf.data(), (std::streamsize)buf.size());
+    return out.good() ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+// motif_query.cpp
+// Substructure search over a TopologyDB_enhanced (text DB or .tcol): every topology with a
+// block of a given param carrying the requested neighbours, side links, instantons and
+// externals. Candidates come from intersecting the motif posting lists of the attribute
+// index (TopologyAttrIndex.hpp); only they are decoded and checked.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+
+#include "Topology_enhanced.h"
+#include "TopologyDB_enhanced.hpp"
+#include "TopoLineCompact_enhanced.hpp"
+
+using Attr = TopologyAttrIndex::Attr;
+
+// Something attached to the centre block, optionally with an external on one of its ports
+struct Attached {
+    int param;
+    int port = -1;   // -1: no external required
+};
+
+struct Pattern {
+    int node = 0;
+    char kind = 0;                  // 0: any block kind
+    std::vector<int> nbrs;          // params of blocks joined by an l_connection
+    std::vector<Attached> sides;    // side links on the centre
+    std::vector<Attached> insts;    // instantons on the centre
+    std::vector<int> ports;         // externals on the centre
+};
+
+static char kind_char(LKind k){
+    switch (k){
+        case LKind::g: return 'g';
+        case LKind::L: return 'L';
+        case LKind::S: return 'S';
+        case LKind::I: return 'I';
+        case LKind::E: return 'E';
+    }
+    return '?';
+}
+
+// "P" or "P@PORT"
+static bool parse_attached(const std::string& s, Attached& a){
+    try {
+        const size_t at = s.find('@');
+        a.param = std::stoi(s.substr(0, at));
+        a.port = at==std::string::npos ? -1 : std::stoi(s.substr(at+1));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// ===== Verification =====
+// Each requirement needs its own component; with at most a handful of requirements a
+// backtracking assignment is cheap
+static bool assign(const std::vector<Attached>& req, size_t k, const std::vector<int>& cands,
+                   const std::function<bool(int, const Attached&)>& fits, std::vector<char>& used){
+    if (k == req.size()) return true;
+    for (size_t c=0; c<cands.size(); ++c){
+        if (used[c] || !fits(cands[c], req[k])) continue;
+        used[c] = 1;
+        if (assign(req, k+1, cands, fits, used)) return true;
+        used[c] = 0;
+    }
+    return false;
+}
+
+static bool has_external(const Topology_enhanced& T, int parent_type, int parent_id, int port){
+    for (const auto& ec : T.e_connection)
+        if (ec.parent_type==parent_type && ec.parent_id==parent_id && ec.port_idx==port) return true;
+    return false;
+}
+
+static bool matches_at(const Topology_enhanced& T, int b, const Pattern& P){
+    const int nb = (int)T.block.size();
+    if (T.block[b].param != P.node) return false;
+    if (P.kind && kind_char(T.block[b].kind) != P.kind) return false;
+
+    std::vector<int> nbrs, sides, insts;
+    for (const auto& e : T.l_connection){
+        if (e.u==b && e.v>=0 && e.v<nb) nbrs.push_back(e.v);
+        else if (e.v==b && e.u>=0 && e.u<nb) nbrs.push_back(e.u);
+    }
+    for (const auto& e : T.s_connection)
+        if (e.u==b && e.v>=0 && e.v<(int)T.side_links.size()) sides.push_back(e.v);
+    for (const auto& e : T.i_connection)
+        if (e.u==b && e.v>=0 && e.v<(int)T.instantons.size()) insts.push_back(e.v);
+
+    std::vector<Attached> nreq;
+    for (int p : P.nbrs) nreq.push_back({p, -1});
+    std::vector<char> used(nbrs.size(), 0);
+    if (!assign(nreq, 0, nbrs, [&](int c, const Attached& a){ return T.block[c].param==a.param; }, used))
+        return false;
+
+    used.assign(sides.size(), 0);
+    if (!assign(P.sides, 0, sides, [&](int c, const Attached& a){
+            return T.side_links[c].param==a.param && (a.port<0 || has_external(T, 1, c, a.port)); }, used))
+        return false;
+
+    used.assign(insts.size(), 0);
+    if (!assign(P.insts, 0, insts, [&](int c, const Attached& a){
+            return T.instantons[c].param==a.param && (a.port<0 || has_external(T, 2, c, a.port)); }, used))
+        return false;
+
+    // Externals on the centre, one e_connection per requested port
+    std::vector<int> eports;
+    for (const auto& ec : T.e_connection)
+        if (ec.parent_type==0 && ec.parent_id==b) eports.push_back(ec.port_idx);
+    std::vector<Attached> preq;
+    for (int p : P.ports) preq.push_back({p, -1});
+    used.assign(eports.size(), 0);
+    return assign(preq, 0, eports, [](int c, const Attached& a){ return c==a.param; }, used);
+}
+
+static bool matches(const Topology_enhanced& T, const Pattern& P){
+    for (int b=0; b<(int)T.block.size(); ++b)
+        if (matches_at(T, b, P)) return true;
+    return false;
+}
+
+// ===== Candidates =====
+static TopologyDB_enhanced::Selection candidates(const TopologyDB_enhanced& db, const Pattern& P){
+    auto sel = db.where(Attr::BlockParam, P.node);
+    for (int n : P.nbrs)
+        sel &= db.where(Attr::BlockPair, std::min(P.node, n), std::max(P.node, n));
+    for (const auto& s : P.sides){
+        sel &= db.where(Attr::BlockSideLink, P.node, s.param);
+        if (s.port >= 0) sel &= db.where(Attr::ExternalOnSideLink, s.param, s.port);
+    }
+    for (const auto& i : P.insts){
+        sel &= db.where(Attr::BlockInstanton, P.node, i.param);
+        if (i.port >= 0) sel &= db.where(Attr::ExternalOnInstanton, i.param, i.port);
+    }
+    for (int p : P.ports) sel &= db.where(Attr::ExternalOnBlock, P.node, p);
+    return sel;
+}
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " <db> --node P [--kind g|L|S|I|E] [--nbr P]... [--side P[@PORT]]...\n"
+              << "                 [--inst P[@PORT]]... [--ext PORT]... [--count] [-o out.txt] [--scan]\n";
+    std::cerr << "  Finds topologies with a block of param P (and kind) that has, on that same block:\n";
+    std::cerr << "    --nbr P          an l_connection to a block of param P\n";
+    std::cerr << "    --side P[@PORT]  a side link of param P (carrying an external on PORT)\n";
+    std::cerr << "    --inst P[@PORT]  an instanton of param P (carrying an external on PORT)\n";
+    std::cerr << "    --ext PORT       an external on port PORT of the block itself\n";
+    std::cerr << "  Repeated options need distinct components. Matches are printed as name<TAB>line-compact,\n";
+    std::cerr << "  or written to -o as line-compact lines.\n";
+    std::cerr << "  --count   print only the number of matches\n";
+    std::cerr << "  --scan    check every record instead of using the index (for comparison)\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 4){ usage(argv[0]); return 1; }
+
+    std::string dbPath, outPath;
+    Pattern P;
+    bool have_node = false, count_only = false, scan = false;
+    for (int i=1; i<argc; ++i){
+        const std::string a = argv[i];
+        const bool has_val = i+1 < argc;
+        Attached att;
+        try {
+            if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+            else if (a=="--node" && has_val) { P.node = std::stoi(argv[++i]); have_node = true; }
+            else if (a=="--kind" && has_val) P.kind = argv[++i][0];
+            else if (a=="--nbr" && has_val) P.nbrs.push_back(std::stoi(argv[++i]));
+            else if (a=="--side" && has_val && parse_attached(argv[++i], att)) P.sides.push_back(att);
+            else if (a=="--inst" && has_val && parse_attached(argv[++i], att)) P.insts.push_back(att);
+            else if (a=="--ext" && has_val) P.ports.push_back(std::stoi(argv[++i]));
+            else if (a=="-o" && has_val) outPath = argv[++i];
+            else if (a=="--count") count_only = true;
+            else if (a=="--scan") scan = true;
+            else if (dbPath.empty() && a[0] != '-') dbPath = a;
+            else { usage(argv[0]); return 1; }
+        } catch (const std::exception&) {
+            std::cerr << "[Error] Bad value for " << a << "\n";
+            return 1;
+        }
+    }
+    if (dbPath.empty() || !have_node){ usage(argv[0]); return 1; }
+
+    TopologyDB_enhanced db(dbPath);
+    std::ofstream out;
+    if (!outPath.empty()){
+        out.open(outPath, std::ios::binary | std::ios::trunc);
+        if (!out){ std::cerr << "[Error] Cannot open " << outPath << "\n"; return 1; }
+    }
+
+    size_t hits = 0, checked = 0;
+    std::string line;
+    auto report = [&](TopologyDB_enhanced::Record& r){
+        ++checked;
+        if (!matches(r.topo, P)) return;
+        ++hits;
+        if (count_only) return;
+        line.clear();
+        if (outPath.empty()){
+            line = r.topo.name;
+            line.push_back('\t');
+        }
+        TopoLineCompact_enhanced::serializeInto(line, r.topo);
+        line.push_back('\n');
+        (outPath.empty() ? std::cout : out) << line;
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    bool ok;
+    size_t total = 0;
+    if (scan){
+        ok = db.forEach(report);
+        total = checked;
+    } else {
+        const auto sel = candidates(db, P);
+        total = sel.size();
+        ok = db.forEach(sel, report);
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok){
+        std::cerr << "[Error] Cannot read " << dbPath << "\n";
+        return 1;
+    }
+
+    if (count_only) std::cout << hits << "\n";
+    std::cerr << "Matched " << hits << " of " << total << " topologies (" << checked
+              << " decoded) in " << secs << " s\n";
+    return 0;
+}
@@ -0,0 +1,132 @@
+// shard_db.cpp
+// Maintenance and queries for a sharded TopologyDB_enhanced (TopologyShards.hpp): import
+// of deco_X/<CATEGORY>/len-N/*.txt trees, shard listing, parallel counting scans,
+// export of a key range and per-shard dedupe.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "Topology_enhanced.h"
+#include "TopologyDB_enhanced.hpp"
+#include "TopologyShards.hpp"
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " <root> import <tree>... [-j N]\n";
+    std::cerr << "       " << prog << " <root> ls     [filter]\n";
+    std::cerr << "       " << prog << " <root> count  [filter] [--scan] [-j N]\n";
+    std::cerr << "       " << prog << " <root> export <out.db> [filter]\n";
+    std::cerr << "       " << prog << " <root> dedupe [-j N]\n";
+    std::cerr << "       " << prog << " <root> recount [-j N]\n";
+    std::cerr << "  filter: [--category C] [--blocks N] [--kinds PREFIX]\n";
+    std::cerr << "  Shards are keyed by (category, block count, block kinds), e.g. LST/len-3/gLg.db;\n";
+    std::cerr << "  import takes the category from the directory above len-N.\n";
+    std::cerr << "  count reports SHARDS; --scan reads the matching shards in parallel instead.\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){ usage(argv[0]); return 1; }
+    const std::string root = argv[1], cmd = argv[2];
+
+    TopologyShards::Filter filter;
+    std::vector<std::string> args;
+    int threads = 0;
+    bool scan = false;
+    for (int i=3; i<argc; ++i){
+        const std::string a = argv[i];
+        const bool has_val = i+1 < argc;
+        try {
+            if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+            else if (a=="--category" && has_val) filter.category = argv[++i];
+            else if (a=="--blocks" && has_val) filter.blocks = std::stoi(argv[++i]);
+            else if (a=="--kinds" && has_val) filter.kinds = argv[++i];
+            else if ((a=="-j" || a=="--threads") && has_val) threads = std::max(1, std::stoi(argv[++i]));
+            else if (a=="--scan") scan = true;
+            else if (a[0] != '-') args.push_back(a);
+            else { usage(argv[0]); return 1; }
+        } catch (const std::exception&) {
+            std::cerr << "[Error] Bad value for " << a << "\n";
+            return 1;
+        }
+    }
+
+    TopologyShards db(root);
+    if (!db.open()) return 1;
+    const auto t0 = std::chrono::steady_clock::now();
+    auto secs = [&]{ return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); };
+
+    if (cmd == "import"){
+        if (args.empty()){ usage(argv[0]); return 1; }
+        long long total = 0;
+        for (const auto& tree : args){
+            const long long n = db.importTree(tree, threads);
+            if (n < 0){ std::cerr << "[Error] Import of " << tree << " failed\n"; return 1; }
+            std::cout << "Imported " << n << " topologies from " << tree << "\n";
+            total += n;
+        }
+        db.open();
+        std::cout << total << " topologies in " << db.shards().size() << " shards (" << secs() << " s)\n";
+        return 0;
+    }
+
+    if (cmd == "ls"){
+        for (const auto* s : db.select(filter))
+            std::cout << s->records << "\t" << s->path << "\n";
+        return 0;
+    }
+
+    if (cmd == "count"){
+        if (!scan){
+            std::cout << db.count(filter) << "\n";
+            return 0;
+        }
+        // Per-worker counters, summed after the scan
+        const int n = db.workers(filter, threads);
+        std::vector<uint64_t> records(n, 0), externals(n, 0);
+        const bool ok = db.forEach(filter, [&](int w, const TopologyShards::Shard&, TopologyDB_enhanced::Record& r){
+            ++records[w];
+            externals[w] += r.topo.externals.size();
+        }, threads);
+        if (!ok) return 1;
+        uint64_t nr = 0, ne = 0;
+        for (int w=0; w<n; ++w){ nr += records[w]; ne += externals[w]; }
+        std::cout << nr << "\n";
+        std::cerr << "Scanned " << db.select(filter).size() << " of " << db.shards().size() << " shards on "
+                  << n << " workers: " << nr << " topologies, " << ne << " externals (" << secs() << " s)\n";
+        return 0;
+    }
+
+    if (cmd == "export"){
+        if (args.size() != 1){ usage(argv[0]); return 1; }
+        TopologyDB_enhanced out(args[0]);
+        TopologyDB_enhanced::Writer w(out);
+        if (!w.isOpen()) return 1;
+        // One worker keeps the output in key order
+        bool written = true;
+        const bool ok = db.forEach(filter, [&](int, const TopologyShards::Shard&, TopologyDB_enhanced::Record& r){
+            written = w.append(r.topo) && written;
+        }, 1);
+        if (!w.close() || !ok || !written) return 1;
+        std::cout << "Exported " << w.appended() << " topologies to " << args[0] << "\n";
+        return 0;
+    }
+
+    if (cmd == "dedupe"){
+        const int removed = db.dedupeByContentHash(threads);
+        std::cout << "Removed " << removed << " duplicates (" << secs() << " s)\n";
+        return 0;
+    }
+
+    if (cmd == "recount"){
+        if (!db.recount(threads)) return 1;
+        std::cout << db.count() << " topologies in " << db.shards().size() << " shards\n";
+        return 0;
+    }
+
+    usage(argv[0]);
+    return 1;
+}
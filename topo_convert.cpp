@@ -0,0 +1,228 @@
+// topo_convert.cpp
+// Converts topology files between the line-compact text format, the TopologyDB_enhanced
+// text DB, the columnar .tcol store (TopoColumnar.hpp) and the log-structured DB directory
+// (TopologyLog.hpp)
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <filesystem>
+
+#include "Topology_enhanced.h"
+#include "TopologyDB_enhanced.hpp"
+#include "TopoLineCompact_enhanced.hpp"
+#include "TopoColumnar.hpp"
+#include "LineIngest.hpp"
+#include "TopoDelta.hpp"
+#include "Txtz.hpp"
+
+enum class Fmt { Auto, Line, DB, Columnar, Log };
+
+static Fmt parse_fmt(const std::string& s){
+    if (s=="line" || s=="txt") return Fmt::Line;
+    if (s=="db")               return Fmt::DB;
+    if (s=="tcol")             return Fmt::Columnar;
+    if (s=="log")              return Fmt::Log;
+    return Fmt::Auto;
+}
+
+static const char* fmt_name(Fmt f){
+    switch (f){
+        case Fmt::Line:     return "line-compact";
+        case Fmt::DB:       return "text DB";
+        case Fmt::Columnar: return "columnar";
+        case Fmt::Log:      return "log-structured DB";
+        case Fmt::Auto:     break;
+    }
+    return "auto";
+}
+
+// Input: the magic decides, then the extension; output: the extension, or a directory
+static Fmt detect_input(const std::string& path){
+    if (TopologyLog::isLogDir(path)) return Fmt::Log;
+    if (TopoColumnar::isColumnarFile(path)) return Fmt::Columnar;
+    if (TopoDelta::isDeltaFile(path) || Txtz::isTxtzFile(path)) return Fmt::Line;
+    return std::filesystem::path(path).extension()==".txt" ? Fmt::Line : Fmt::DB;
+}
+
+static Fmt detect_output(const std::string& path){
+    const auto ext = std::filesystem::path(path).extension();
+    if (TopologyLog::isLogDir(path) || (!path.empty() && path.back()=='/')) return Fmt::Log;
+    if (ext==".tcol") return Fmt::Columnar;
+    if (ext==".txt" || ext==".txtz") return Fmt::Line;
+    return Fmt::DB;
+}
+
+using Visitor = std::function<void(const Topology_enhanced&)>;
+
+// Calls visit for every topology of the input, in file order; returns false if unreadable
+static bool read_input(const std::string& path, Fmt fmt, int threads, const Visitor& visit){
+    switch (fmt){
+        case Fmt::Line: {
+            LineIngest ingest;
+            if (!ingest.open(path, LineIngest::kDefaultChunkBytes, threads)) return false;
+            ingest.run(threads, [&](IngestBatch& batch){
+                for (const auto& rec : batch){
+                    if (rec.status) { visit(rec.topo); continue; }
+                    std::cerr << "[Warning] Failed to parse line " << rec.line << " ("
+                              << TopoLineCompact_enhanced::errorString(rec.status.code)
+                              << " at column " << rec.status.pos + 1 << ")\n";
+                }
+            });
+            return true;
+        }
+        case Fmt::Columnar: {
+            TopoColumnarReader rd;
+            if (!rd.open(path)) return false;
+            Topology_enhanced T;
+            for (size_t i=0; i<rd.size(); ++i){
+                if (!rd.get(i, T)) return false;
+                visit(T);
+            }
+            return true;
+        }
+        case Fmt::DB:
+        case Fmt::Log:
+            return TopologyDB_enhanced(path).forEach([&](TopologyDB_enhanced::Record& rec){ visit(rec.topo); });
+        case Fmt::Auto: break;
+    }
+    return false;
+}
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " <input> <output> [--from line|db|tcol|log] [--to line|db|tcol|log] [-j N]\n";
+    std::cerr << "       " << prog << " <input.tcol> -r N     print record N as a line-compact line\n";
+    std::cerr << "       " << prog << " <input> --count       print the number of topologies\n";
+    std::cerr << "  Formats are detected from the input contents / output extension:\n";
+    std::cerr << "    .tcol  columnar store (mmap, O(1) record access)\n";
+    std::cerr << "    .txt   line-compact (names are dropped; line input is named line_N)\n";
+    std::cerr << "    .txd   base+delta variants (input only, read as line-compact)\n";
+    std::cerr << "    .txtz  block-compressed line-compact (see topo_txtz)\n";
+    std::cerr << "    dir/   log-structured DB directory (appended to, then compacted)\n";
+    std::cerr << "    other  TopologyDB_enhanced text DB\n";
+    std::cerr << "  -j N      parser threads for line-compact input (default: hardware concurrency)\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){ usage(argv[0]); return 1; }
+
+    std::string inPath, outPath;
+    Fmt from = Fmt::Auto, to = Fmt::Auto;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    long long only = -1;
+    bool count_only = false;
+    for (int i=1; i<argc; ++i){
+        const std::string a = argv[i];
+        if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+        else if (a=="--from" && i+1<argc) from = parse_fmt(argv[++i]);
+        else if (a=="--to" && i+1<argc)   to = parse_fmt(argv[++i]);
+        else if ((a=="-j" || a=="--threads") && i+1<argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (a=="-r" && i+1<argc) only = std::stoll(argv[++i]);
+        else if (a=="--count") count_only = true;
+        else if (inPath.empty()) inPath = a;
+        else if (outPath.empty()) outPath = a;
+        else { usage(argv[0]); return 1; }
+    }
+    if (from==Fmt::Auto) from = detect_input(inPath);
+
+    if (only >= 0){
+        TopoColumnarReader rd;
+        if (!rd.open(inPath)){ std::cerr << "cannot open " << inPath << " (not a .tcol file?)\n"; return 1; }
+        Topology_enhanced T;
+        if (!rd.get((size_t)only, T)){
+            std::cerr << "record " << only << " out of range (" << rd.size() << " records)\n";
+            return 1;
+        }
+        std::cout << T.name << "\t" << TopoLineCompact_enhanced::serialize(T) << "\n";
+        return 0;
+    }
+
+    if (count_only){
+        if (from==Fmt::Columnar){
+            TopoColumnarReader rd;
+            if (!rd.open(inPath)){ std::cerr << "cannot open " << inPath << "\n"; return 1; }
+            std::cout << rd.size() << "\n";
+            return 0;
+        }
+        size_t n = 0;
+        if (!read_input(inPath, from, threads, [&](const Topology_enhanced&){ ++n; })){
+            std::cerr << "cannot open " << inPath << "\n";
+            return 1;
+        }
+        std::cout << n << "\n";
+        return 0;
+    }
+
+    if (outPath.empty()){ usage(argv[0]); return 1; }
+    if (to==Fmt::Auto) to = detect_output(outPath);
+
+    size_t n = 0;
+    bool ok = true;
+    if (to==Fmt::Columnar){
+        TopoColumnarWriter w;
+        ok = read_input(inPath, from, threads, [&](const Topology_enhanced& T){ w.add(T); });
+        n = w.size();
+        ok = ok && w.write(outPath);
+    } else if (to==Fmt::Log){
+        if (!TopologyDB_enhanced::createLogStructured(outPath)) return 1;
+        TopologyDB_enhanced db(outPath);
+        {
+            TopologyDB_enhanced::Writer w(db);
+            if (!w.isOpen()) return 1;
+            bool written = true;
+            ok = read_input(inPath, from, threads, [&](const Topology_enhanced& T){ written = w.append(T) && written; });
+            n = w.appended();
+            ok = w.close() && written && ok;
+        }
+        // Into a segment, everything converted kept
+        ok = ok && db.compact(false, false) >= 0;
+    } else if (to==Fmt::Line && std::filesystem::path(outPath).extension()==".txtz"){
+        TxtzWriter out;
+        if (!out.open(outPath)){ std::cerr << "cannot open " << outPath << "\n"; return 1; }
+        std::string buf;
+        bool written = true;
+        ok = read_input(inPath, from, threads, [&](const Topology_enhanced& T){
+            TopoLineCompact_enhanced::serializeInto(buf, T);
+            buf.push_back('\n');
+            ++n;
+            if (buf.size() >= (1u<<22)){
+                written = out.write(buf) && written;
+                buf.clear();
+            }
+        });
+        written = out.write(buf) && written;
+        ok = out.close() && written && ok;
+        std::cerr << "Compressed " << out.rawBytes() << " -> " << out.storedBytes() << " bytes\n";
+    } else {
+        std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+        if (!out){ std::cerr << "cannot open " << outPath << "\n"; return 1; }
+        std::string buf;
+        buf.reserve(1<<22);
+        ok = read_input(inPath, from, threads, [&](const Topology_enhanced& T){
+            if (to==Fmt::Line){
+                TopoLineCompact_enhanced::serializeInto(buf, T);
+                buf.push_back('\n');
+            } else {
+                TopologyDB_enhanced::serializeCanonicalInto(buf, T, true);
+            }
+            ++n;
+            if (buf.size() >= (1u<<22)){
+                out.write(buf.data(), (std::streamsize)buf.size());
+                buf.clear();
+            }
+        });
+        out.write(buf.data(), (std::streamsize)buf.size());
+        ok = ok && out.good();
+    }
+    if (!ok){
+        std::cerr << "conversion failed: " << inPath << " -> " << outPath << "\n";
+        return 1;
+    }
+    std::cout << "Converted " << n << " topologies: " << fmt_name(from) << " -> " << fmt_name(to)
+              << " (" << outPath << ")\n";
+    return 0;
+}
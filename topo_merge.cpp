@@ -0,0 +1,448 @@
+// topo_merge.cpp
+// Merges topology files (or whole deco_X/<CATEGORY>/len-N trees) from several runs into
+// one sorted, duplicate-free output, in bounded memory.
+//
+// Every record is re-serialized to its line-compact line, which is the sort and dedupe key
+// (names are not part of it). Records are gathered into runs of about half the memory
+// budget, sorted, collapsed and spilled to <output>.merge.d/ as "<line>\t<count>" lines,
+// the next run filling while the previous one is sorted and written. The runs are then
+// merged through a heap, kMaxFanIn at a time (extra passes only for very large inputs),
+// equal lines collapsing into one record whose multiplicity is the sum of theirs. The
+// result streams to a line-compact .txt or is assembled into a .tcol store.
+//
+// Multiplicities follow the classify_topology_ext convention: <file>.mult lists one count
+// per record. An input with a .mult contributes those counts (1 otherwise); --count writes
+// the merged counts next to the output.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <functional>
+#include <filesystem>
+
+#include "Topology_enhanced.h"
+#include "TopologyDB_enhanced.hpp"
+#include "TopoLineCompact_enhanced.hpp"
+#include "TopoColumnar.hpp"
+#include "LineIngest.hpp"
+#include "TopoDelta.hpp"
+#include "Txtz.hpp"
+
+namespace fs = std::filesystem;
+
+static constexpr size_t kMaxFanIn = 64;                // runs merged at once
+static constexpr size_t kDefaultMemoryBytes = size_t(256) << 20;
+
+struct MergeOptions {
+    int threads = 1;
+    size_t memory_bytes = kDefaultMemoryBytes;
+    bool count = false;          // write <output>.mult
+    std::string tmp;             // spill directory; default <output>.merge.d
+};
+
+struct MergeStats {
+    uint64_t read = 0, written = 0, runs = 0;
+};
+
+// ===== Input =====
+// Calls visit(T, multiplicity) for every topology of a file, in file order
+using Visitor = std::function<void(const Topology_enhanced&, uint64_t)>;
+
+// <path>.mult, one count per record; records past its end count once
+class MultReader {
+public:
+    explicit MultReader(const std::string& path) : in_(path + ".mult") {}
+    uint64_t next(){
+        unsigned long long m;
+        if (in_ && (in_ >> m)) return m;
+        return 1;
+    }
+private:
+    std::ifstream in_;
+};
+
+static bool read_input(const std::string& path, int threads, const Visitor& visit){
+    MultReader mult(path);
+    if (TopoColumnar::isColumnarFile(path)){
+        TopoColumnarReader rd;
+        if (!rd.open(path)) return false;
+        Topology_enhanced T;
+        for (size_t i=0; i<rd.size(); ++i){
+            if (!rd.get(i, T)) return false;
+            visit(T, mult.next());
+        }
+        return true;
+    }
+    const auto ext = fs::path(path).extension();
+    if (TopologyLog::isLogDir(path)
+        || (ext != ".txt" && !TopoDelta::isDeltaFile(path) && !Txtz::isTxtzFile(path)))
+        return TopologyDB_enhanced(path).forEach([&](TopologyDB_enhanced::Record& rec){ visit(rec.topo, mult.next()); });
+
+    LineIngest ingest;
+    if (!ingest.open(path, LineIngest::kDefaultChunkBytes, threads)) return false;
+    ingest.run(threads, [&](IngestBatch& batch){
+        for (const auto& rec : batch){
+            const uint64_t m = mult.next();
+            if (rec.status) { visit(rec.topo, m); continue; }
+            std::cerr << "[Warning] " << path << ": failed to parse line " << rec.line << " ("
+                      << TopoLineCompact_enhanced::errorString(rec.status.code) << ")\n";
+        }
+    });
+    return true;
+}
+
+// ===== Runs =====
+// In-memory run: lines packed into one arena, sorted through an index
+class RunBuffer {
+public:
+    void add(const Topology_enhanced& T, uint64_t count){
+        const size_t off = arena_.size();
+        TopoLineCompact_enhanced::serializeInto(arena_, T);
+        items_.push_back(Item{off, arena_.size() - off, count});
+    }
+    size_t bytes() const { return arena_.size() + items_.size() * sizeof(Item); }
+    bool empty() const { return items_.empty(); }
+
+    // Sorts, collapses equal lines and writes "<line>\t<count>" lines
+    bool spill(const std::string& path){
+        std::sort(items_.begin(), items_.end(), [&](const Item& a, const Item& b){ return line(a) < line(b); });
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::string buf;
+        buf.reserve(1<<22);
+        for (size_t i=0; i<items_.size();){
+            uint64_t count = 0;
+            size_t j = i;
+            for (; j<items_.size() && line(items_[j]) == line(items_[i]); ++j) count += items_[j].count;
+            buf.append(line(items_[i]));
+            buf.push_back('\t');
+            buf += std::to_string(count);
+            buf.push_back('\n');
+            if (buf.size() >= (1u<<22)){
+                out.write(buf.data(), (std::streamsize)buf.size());
+                buf.clear();
+            }
+            i = j;
+        }
+        out.write(buf.data(), (std::streamsize)buf.size());
+        arena_.clear();
+        items_.clear();
+        return out.good();
+    }
+
+private:
+    struct Item {
+        size_t off, len;
+        uint64_t count;
+    };
+    std::string arena_;
+    std::vector<Item> items_;
+
+    std::string_view line(const Item& it) const { return std::string_view(arena_).substr(it.off, it.len); }
+};
+
+// Sequential reader of one spilled run
+class RunReader {
+public:
+    bool open(const std::string& path, size_t buffer_bytes){
+        buf_.resize(buffer_bytes);
+        in_.rdbuf()->pubsetbuf(buf_.data(), (std::streamsize)buf_.size());
+        in_.open(path, std::ios::binary);
+        return (bool)in_;
+    }
+    bool next(){
+        if (!std::getline(in_, row_)) return false;
+        const size_t tab = row_.rfind('\t');
+        if (tab == std::string::npos) return false;
+        count_ = std::stoull(row_.substr(tab + 1));
+        row_.resize(tab);
+        return true;
+    }
+    const std::string& line() const { return row_; }
+    uint64_t count() const { return count_; }
+
+private:
+    std::vector<char> buf_;
+    std::ifstream in_;
+    std::string row_;
+    uint64_t count_ = 0;
+};
+
+using Emit = std::function<bool(std::string_view line, uint64_t count)>;
+
+// Heap merge of sorted runs; equal lines reach emit once, with their counts summed
+static bool merge_runs(const std::vector<std::string>& runs, size_t memory_bytes, const Emit& emit){
+    const size_t buffer = std::clamp<size_t>(memory_bytes / std::max<size_t>(1, runs.size()), 64u<<10, 4u<<20);
+    std::vector<RunReader> rd(runs.size());
+    auto greater = [&](size_t a, size_t b){
+        const int c = rd[a].line().compare(rd[b].line());
+        return c != 0 ? c > 0 : a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+    for (size_t i=0; i<runs.size(); ++i){
+        if (!rd[i].open(runs[i], buffer)){
+            std::cerr << "[Error] Cannot read run " << runs[i] << "\n";
+            return false;
+        }
+        if (rd[i].next()) heap.push(i);
+    }
+
+    std::string cur;
+    uint64_t count = 0;
+    bool have = false;
+    while (!heap.empty()){
+        const size_t i = heap.top();
+        heap.pop();
+        if (have && rd[i].line() == cur){
+            count += rd[i].count();
+        } else {
+            if (have && !emit(cur, count)) return false;
+            cur = rd[i].line();
+            count = rd[i].count();
+            have = true;
+        }
+        if (rd[i].next()) heap.push(i);
+    }
+    return !have || emit(cur, count);
+}
+
+// ===== Output =====
+// Line-compact text, or a .tcol built from the merged lines; names are line_<N>
+class MergeOutput {
+public:
+    MergeOutput(std::string path, bool count) : path_(std::move(path)), count_(count) {
+        columnar_ = fs::path(path_).extension() == ".tcol";
+        compressed_ = fs::path(path_).extension() == ".txtz";
+        if (compressed_) txtz_.open(path_);
+        else if (!columnar_) out_.open(path_, std::ios::binary | std::ios::trunc);
+        if (count_) mult_.open(path_ + ".mult", std::ios::trunc);
+        buf_.reserve(1<<22);
+    }
+    bool isOpen() const {
+        return (columnar_ || out_.is_open() || txtz_.isOpen()) && (!count_ || mult_.is_open());
+    }
+
+    bool add(std::string_view line, uint64_t count){
+        ++n_;
+        if (count_) mult_ << count << '\n';
+        if (columnar_){
+            if (!TopoLineCompact_enhanced::parse(line, T_)) return false;
+            T_.name = "line_" + std::to_string(n_);
+            col_.add(T_);
+            return true;
+        }
+        buf_.append(line);
+        buf_.push_back('\n');
+        if (buf_.size() >= (1u<<22)) flush();
+        return compressed_ ? ok_ : out_.good();
+    }
+    bool close(){
+        if (columnar_) return col_.write(path_) && mult_.good();
+        flush();
+        if (compressed_) return txtz_.close() && ok_ && mult_.good();
+        out_.close();
+        return out_.good() && mult_.good();
+    }
+    uint64_t size() const { return n_; }
+
+private:
+    std::string path_;
+    bool count_, columnar_, compressed_, ok_ = true;
+    std::ofstream out_, mult_;
+    TxtzWriter txtz_;
+    std::string buf_;
+    TopoColumnarWriter col_;
+    Topology_enhanced T_;
+    uint64_t n_ = 0;
+
+    void flush(){
+        if (compressed_) ok_ = txtz_.write(buf_) && ok_;
+        else out_.write(buf_.data(), (std::streamsize)buf_.size());
+        buf_.clear();
+    }
+};
+
+// ===== Merge =====
+// Merges `inputs` into `output`; false on failure (the spill directory is removed either way)
+static bool merge_files(const std::vector<std::string>& inputs, const std::string& output,
+                        const MergeOptions& opt, MergeStats& st){
+    const std::string dir = opt.tmp.empty() ? output + ".merge.d"
+                                            : opt.tmp + "/" + fs::path(output).filename().string() + ".merge.d";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec){
+        std::cerr << "[Error] Cannot create spill directory " << dir << "\n";
+        return false;
+    }
+    struct Cleanup {
+        std::string dir;
+        ~Cleanup(){ std::error_code e; fs::remove_all(dir, e); }
+    } cleanup{dir};
+
+    // Phase 1: sorted runs, one filling while the other is spilled
+    std::vector<std::string> runs;
+    auto run_path = [&]{ return dir + "/run-" + std::to_string(runs.size()) + ".txt"; };
+    RunBuffer buffers[2];
+    int active = 0;
+    std::future<bool> pending;
+    bool ok = true;
+    auto spill = [&]{
+        if (buffers[active].empty()) return;
+        if (pending.valid()) ok = pending.get() && ok;
+        runs.push_back(run_path());
+        pending = std::async(std::launch::async, [b = &buffers[active], path = runs.back()]{ return b->spill(path); });
+        active ^= 1;
+    };
+
+    const size_t run_bytes = std::max<size_t>(opt.memory_bytes / 2, 1u<<20);
+    for (const auto& in : inputs){
+        const bool read = read_input(in, opt.threads, [&](const Topology_enhanced& T, uint64_t m){
+            buffers[active].add(T, m);
+            ++st.read;
+            if (buffers[active].bytes() >= run_bytes) spill();
+        });
+        if (!read){
+            std::cerr << "[Error] Cannot read " << in << "\n";
+            ok = false;
+        }
+    }
+    spill();
+    if (pending.valid()) ok = pending.get() && ok;
+    if (!ok){
+        std::cerr << "[Error] Cannot write runs to " << dir << "\n";
+        return false;
+    }
+    st.runs += runs.size();
+
+    // Phase 2: extra passes while there are more runs than the fan-in
+    for (size_t pass = 0; runs.size() > kMaxFanIn; ++pass){
+        std::vector<std::string> next;
+        for (size_t i=0; i<runs.size(); i+=kMaxFanIn){
+            const std::vector<std::string> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + kMaxFanIn));
+            const std::string path = dir + "/pass-" + std::to_string(pass) + "-" + std::to_string(next.size()) + ".txt";
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            std::string buf;
+            const bool merged = merge_runs(group, opt.memory_bytes, [&](std::string_view line, uint64_t count){
+                buf.append(line);
+                buf.push_back('\t');
+                buf += std::to_string(count);
+                buf.push_back('\n');
+                if (buf.size() >= (1u<<22)){
+                    out.write(buf.data(), (std::streamsize)buf.size());
+                    buf.clear();
+                }
+                return true;
+            });
+            out.write(buf.data(), (std::streamsize)buf.size());
+            if (!merged || !out.good()) return false;
+            for (const auto& r : group) fs::remove(r, ec);
+            next.push_back(path);
+        }
+        runs.swap(next);
+    }
+
+    MergeOutput out(output, opt.count);
+    if (!out.isOpen()){
+        std::cerr << "[Error] Cannot open " << output << "\n";
+        return false;
+    }
+    if (!merge_runs(runs, opt.memory_bytes, [&](std::string_view line, uint64_t count){ return out.add(line, count); })){
+        std::cerr << "[Error] Merge into " << output << " failed\n";
+        return false;
+    }
+    st.written += out.size();
+    return out.close();
+}
+
+// Line-compact files under a tree, relative to it
+static std::vector<std::string> tree_files(const std::string& tree){
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(tree, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)){
+        const auto ext = it->path().extension();
+        if (it->is_regular_file() && (ext == ".txt" || ext == ".txtz"))
+            files.push_back(fs::relative(it->path(), tree, ec).generic_string());
+    }
+    return files;
+}
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " <output> <input>... [-j N] [--memory-mb N] [--tmp DIR] [--count]\n";
+    std::cerr << "  Merges the inputs into one sorted output without duplicate topologies; the sort key\n";
+    std::cerr << "  is the line-compact line, names are dropped (a .tcol output names them line_N).\n";
+    std::cerr << "  output     .txt (line-compact), .txtz (block-compressed) or .tcol; a directory when\n";
+    std::cerr << "             the inputs are directories\n";
+    std::cerr << "  inputs     line-compact .txt / .txtz, base+delta .txd, .tcol, text DBs, log-structured DB\n";
+    std::cerr << "             directories, or\n";
+    std::cerr << "             trees: every <rel>.txt under them merges into <output>/<rel>.txt\n";
+    std::cerr << "  -j N         parser threads for line-compact input (default: hardware concurrency)\n";
+    std::cerr << "  --memory-mb  sort memory per merge (default " << (kDefaultMemoryBytes >> 20) << ")\n";
+    std::cerr << "  --tmp DIR    where sorted runs are spilled (default: next to the output)\n";
+    std::cerr << "  --count      write <output>.mult, the multiplicity of every output record; inputs\n";
+    std::cerr << "               with a <input>.mult contribute those counts\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){ usage(argv[0]); return 1; }
+
+    MergeOptions opt;
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+    for (int i=1; i<argc; ++i){
+        const std::string a = argv[i];
+        const bool has_val = i+1 < argc;
+        try {
+            if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+            else if ((a=="-j" || a=="--threads") && has_val) opt.threads = std::max(1, std::stoi(argv[++i]));
+            else if (a=="--memory-mb" && has_val) opt.memory_bytes = size_t(std::max(1, std::stoi(argv[++i]))) << 20;
+            else if (a=="--tmp" && has_val) opt.tmp = argv[++i];
+            else if (a=="--count") opt.count = true;
+            else if (a[0] != '-') paths.push_back(a);
+            else { usage(argv[0]); return 1; }
+        } catch (const std::exception&) {
+            std::cerr << "[Error] Bad value for " << a << "\n";
+            return 1;
+        }
+    }
+    if (paths.size() < 2){ usage(argv[0]); return 1; }
+    const std::string output = paths[0];
+    const std::vector<std::string> inputs(paths.begin() + 1, paths.end());
+
+    const auto t0 = std::chrono::steady_clock::now();
+    MergeStats st;
+    bool ok = true;
+
+    auto is_tree = [](const std::string& p){ return fs::is_directory(p) && !TopologyLog::isLogDir(p); };
+    if (std::all_of(inputs.begin(), inputs.end(), is_tree)){
+        // Trees: merge file by file, by relative path
+        std::map<std::string, std::vector<std::string>> groups;
+        for (const auto& tree : inputs)
+            for (const auto& rel : tree_files(tree)) groups[rel].push_back(tree + "/" + rel);
+        for (const auto& [rel, files] : groups){
+            const fs::path out = fs::path(output) / rel;
+            std::error_code ec;
+            fs::create_directories(out.parent_path(), ec);
+            const uint64_t before = st.written;
+            if (!merge_files(files, out.string(), opt, st)) { ok = false; continue; }
+            std::cout << rel << ": " << st.written - before << " topologies from " << files.size() << " files\n";
+        }
+    } else if (std::any_of(inputs.begin(), inputs.end(), is_tree)){
+        std::cerr << "[Error] Inputs must be all trees or all files\n";
+        return 1;
+    } else {
+        ok = merge_files(inputs, output, opt, st);
+    }
+
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Merged " << st.read << " topologies into " << st.written << " (" << st.read - st.written
+              << " duplicates dropped, " << st.runs << " runs, " << secs << " s)\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+// topo_txtz.cpp
+// Block compression of topology files and IF text outputs (Txtz.hpp): compress,
+// decompress and verify .txtz files, blocks coded in parallel, with the compression
+// ratio and throughput reported on stderr
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+#include "Txtz.hpp"
+
+namespace fs = std::filesystem;
+
+// Runs job(i) for i in [0, n) on `workers` threads, the calling thread included
+template <class Job>
+static void run_pool(size_t n, int workers, const Job& job){
+    std::atomic<size_t> next{0};
+    auto work = [&]{
+        for (size_t i; (i = next.fetch_add(1)) < n;) job(i);
+    };
+    std::vector<std::thread> pool;
+    for (int w = 1; w < std::min<int>(workers, (int)n); ++w) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+}
+
+struct Report {
+    uint64_t raw = 0, stored = 0, blocks = 0;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    void print(const std::string& what, const std::string& path) const {
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cerr << what << " " << path << ": " << raw << " -> " << stored << " bytes in " << blocks
+                  << " blocks, ratio " << (stored ? (double)raw / stored : 0.0) << ", "
+                  << (secs > 0 ? raw / secs / (1 << 20) : 0.0) << " MiB/s\n";
+    }
+};
+
+// ===== Compress =====
+// Reads `workers` blocks' worth of text at a time, cuts it at line ends and encodes the
+// blocks in parallel, writing them in order
+static bool compress_file(const std::string& in_path, const std::string& out_path,
+                          uint32_t block_bytes, int workers, Report& rep){
+    std::ifstream in(in_path, std::ios::binary);
+    if (!in){ std::cerr << "[Error] Cannot open " << in_path << "\n"; return false; }
+    const std::string tmp = out_path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out){ std::cerr << "[Error] Cannot write " << tmp << "\n"; return false; }
+    const std::string h = Txtz::header(block_bytes);
+    out.write(h.data(), (std::streamsize)h.size());
+    rep.stored += h.size();
+
+    const size_t batch = (size_t)block_bytes * std::max(1, workers);
+    std::string text, carry;
+    std::vector<std::string_view> blocks;
+    std::vector<std::string> coded;
+    for (bool eof = false; !eof;){
+        text.swap(carry);
+        carry.clear();
+        const size_t have = text.size();
+        text.resize(have + batch);
+        in.read(text.data() + have, (std::streamsize)batch);
+        text.resize(have + (size_t)in.gcount());
+        eof = !in;
+
+        // Whole lines per block; the tail waits for the next batch unless this is the end
+        blocks.clear();
+        size_t from = 0;
+        while (from < text.size()){
+            size_t to = text.size();
+            if (to - from > block_bytes){
+                size_t nl = text.rfind('\n', from + block_bytes - 1);
+                if (nl == std::string::npos || nl < from) nl = text.find('\n', from + block_bytes);
+                if (nl != std::string::npos) to = nl + 1;
+            }
+            if (to == text.size() && !eof) break;
+            blocks.push_back(std::string_view(text).substr(from, to - from));
+            from = to;
+        }
+        carry.assign(text, from, std::string::npos);
+
+        coded.resize(blocks.size());
+        run_pool(blocks.size(), workers, [&](size_t i){
+            coded[i].clear();
+            Txtz::encodeBlock(blocks[i], coded[i]);
+        });
+        for (size_t i = 0; i < blocks.size(); ++i){
+            out.write(coded[i].data(), (std::streamsize)coded[i].size());
+            rep.raw += blocks[i].size();
+            rep.stored += coded[i].size();
+            ++rep.blocks;
+        }
+    }
+    out.close();
+    std::error_code ec;
+    if (out.fail()){ fs::remove(tmp, ec); return false; }
+    fs::rename(tmp, out_path, ec);
+    return !ec;
+}
+
+// ===== Decompress / verify =====
+// Reads up to `workers` x 4 blocks at a time and decodes them in parallel; with out
+// null only the checksums are checked
+static bool decompress_file(const std::string& in_path, std::ostream* out, int workers, Report& rep){
+    std::ifstream in(in_path, std::ios::binary);
+    std::string head(Txtz::kHeaderSize, '\0');
+    if (!in.read(head.data(), (std::streamsize)head.size()) || !Txtz::isTxtz(head)){
+        std::cerr << "[Error] " << in_path << " is not a .txtz file\n";
+        return false;
+    }
+    rep.stored += head.size();
+
+    const size_t batch = 4 * (size_t)std::max(1, workers);
+    std::vector<std::string> stored, raw;
+    std::vector<Txtz::Block> blocks;
+    std::vector<char> bad;
+    for (bool more = true; more;){
+        stored.clear();
+        blocks.clear();
+        // Header, then the payload it announces
+        char bh[Txtz::kBlockHeaderSize];
+        bool truncated = false;
+        while (blocks.size() < batch && in.read(bh, sizeof(bh))){
+            Txtz::Block b;
+            std::string frame(bh, sizeof(bh));
+            const bool framed = Txtz::parseBlockHeader(bh, 0, b);
+            frame.resize(sizeof(bh) + (framed ? b.stored : 0));
+            if (!framed || !in.read(frame.data() + sizeof(bh), (std::streamsize)b.stored)){
+                truncated = true;
+                break;
+            }
+            stored.push_back(std::move(frame));
+            blocks.push_back(b);
+        }
+        if (truncated || (blocks.size() < batch && in.gcount() > 0)){
+            std::cerr << "[Error] " << in_path << ": block " << rep.blocks + blocks.size() << " is truncated\n";
+            return false;
+        }
+        more = blocks.size() == batch;
+
+        raw.resize(blocks.size());
+        bad.assign(blocks.size(), 0);
+        run_pool(blocks.size(), workers, [&](size_t i){
+            bad[i] = !Txtz::decodeBlock(stored[i], blocks[i], raw[i]);
+        });
+        for (size_t i = 0; i < blocks.size(); ++i){
+            if (bad[i]){
+                std::cerr << "[Error] " << in_path << ": block " << rep.blocks << " is corrupt\n";
+                return false;
+            }
+            if (out) out->write(raw[i].data(), (std::streamsize)raw[i].size());
+            rep.raw += raw[i].size();
+            rep.stored += stored[i].size();
+            ++rep.blocks;
+        }
+    }
+    return !out || out->good();
+}
+
+static void usage(const char* prog){
+    std::cerr << "usage: " << prog << " c <input> [output.txtz] [-b KiB] [-j N]   compress\n";
+    std::cerr << "       " << prog << " d <input.txtz> [output] [-j N]           decompress ('-' for stdout)\n";
+    std::cerr << "       " << prog << " t <input.txtz>... [-j N]                 verify every block\n";
+    std::cerr << "  Default names: x.txt <-> x.txtz, otherwise x <-> x.txtz. Every tool reading\n";
+    std::cerr << "  line-compact input (through LineIngest) reads .txtz files directly.\n";
+    std::cerr << "  -b KiB   block size (default " << (Txtz::kDefaultBlockBytes >> 10) << ")\n";
+    std::cerr << "  -j N     coding threads (default: hardware concurrency)\n";
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){ usage(argv[0]); return 1; }
+    const std::string cmd = argv[1];
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t block_bytes = Txtz::kDefaultBlockBytes;
+    std::vector<std::string> args;
+    for (int i=2; i<argc; ++i){
+        const std::string a = argv[i];
+        const bool has_val = i+1 < argc;
+        try {
+            if (a=="-h" || a=="--help") { usage(argv[0]); return 0; }
+            else if ((a=="-j" || a=="--threads") && has_val) threads = std::max(1, std::stoi(argv[++i]));
+            else if (a=="-b" && has_val) block_bytes = (uint32_t)std::clamp(std::stoi(argv[++i]), 4, 1 << 20) << 10;
+            else if (a=="-" || a[0] != '-') args.push_back(a);
+            else { usage(argv[0]); return 1; }
+        } catch (const std::exception&) {
+            std::cerr << "[Error] Bad value for " << a << "\n";
+            return 1;
+        }
+    }
+    if (args.empty()){ usage(argv[0]); return 1; }
+
+    if (cmd == "c"){
+        if (args.size() > 2){ usage(argv[0]); return 1; }
+        const fs::path in = args[0];
+        const std::string out = args.size() > 1 ? args[1]
+                              : in.extension() == ".txt" ? in.string() + "z" : in.string() + ".txtz";
+        Report rep;
+        if (!compress_file(args[0], out, block_bytes, threads, rep)) return 1;
+        rep.print("Compressed", out);
+        return 0;
+    }
+
+    if (cmd == "d"){
+        if (args.size() > 2){ usage(argv[0]); return 1; }
+        const fs::path in = args[0];
+        std::string out = args.size() > 1 ? args[1] : in.string();
+        if (args.size() == 1){
+            if (in.extension() == ".txtz") out.pop_back();
+            else { std::cerr << "[Error] Name the output of " << args[0] << "\n"; return 1; }
+        }
+        Report rep;
+        bool ok;
+        if (out == "-"){
+            ok = decompress_file(args[0], &std::cout, threads, rep);
+        } else {
+            std::ofstream os(out + ".tmp", std::ios::binary | std::ios::trunc);
+            ok = os && decompress_file(args[0], &os, threads, rep);
+            os.close();
+            std::error_code ec;
+            if (ok && !os.fail()) fs::rename(out + ".tmp", out, ec);
+            else fs::remove(out + ".tmp", ec);
+            ok = ok && !ec;
+        }
+        if (!ok) return 1;
+        rep.print("Decompressed", args[0]);
+        return 0;
+    }
+
+    if (cmd == "t"){
+        bool ok = true;
+        for (const auto& path : args){
+            Report rep;
+            if (decompress_file(path, nullptr, threads, rep)) rep.print("OK", path);
+            else ok = false;
+        }
+        return ok ? 0 : 1;
+    }
+
+    usage(argv[0]);
+    return 1;
+}